@@ -10,6 +10,7 @@ namespace AP
         bool enable_debug = true;            // maximum debugging output to the screen
         bool no_aliasing = false;            // assuming aliasing or not
         bool b_unique_indirect_index = true; // assume all arrays used as indirect indices has unique elements(no overlapping)
+        bool enable_early_exit = false;      // parallelize loops exiting by break or return, see canCancelEarlyExits(); untested, so off
         std::vector<std::string> annot_filenames;
 
         static Config &get()
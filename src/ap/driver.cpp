@@ -117,12 +117,13 @@ namespace
 
 namespace AutoParallelization
 {
-    void auto_parallize(SgProject *project, int target_nthreads, AP::ERT_TYPE ert_type, bool enable_debug)
+    void auto_parallize(SgProject *project, int target_nthreads, AP::ERT_TYPE ert_type, bool enable_debug, bool enable_early_exit)
     {
         ROSE_ASSERT(project != nullptr);
 
         {
             AP::Config::get().enable_debug = enable_debug;
+            AP::Config::get().enable_early_exit = enable_early_exit;
         }
 
         // create a block to avoid jump crosses initialization of candidateFuncDefs etc.
@@ -221,6 +222,17 @@ namespace AutoParallelization
                             continue;
                         }
 
+                        // skip loops exiting early, unless allowed to cancel the rest of their session on exit
+                        std::vector<SgBreakStmt *> breaks;
+                        std::vector<SgReturnStmt *> returns;
+                        CollectEarlyExits(current_loop, breaks, returns);
+                        if ((!breaks.empty() || !returns.empty()) && (!AP::Config::get().enable_early_exit || !canCancelEarlyExits(current_loop, breaks, returns)))
+                        {
+                            if (AP::Config::get().enable_debug)
+                                std::cout << "Skipping a loop at line:" << current_loop->get_file_info()->get_line() << " due to an unsupported early exit..." << std::endl;
+                            continue;
+                        }
+
                         SgInitializedName *invarname = getLoopInvariant(current_loop);
                         if (invarname != nullptr)
                         {
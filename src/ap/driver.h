@@ -5,5 +5,6 @@
 
 namespace AutoParallelization
 {
-    void auto_parallize(SgProject *project, int target_nthreads, AP::ERT_TYPE ert_type, bool enable_debug);
+    // enable_early_exit: parallelize loops exiting by break or return, see AP::Config
+    void auto_parallize(SgProject *project, int target_nthreads, AP::ERT_TYPE ert_type, bool enable_debug, bool enable_early_exit = false);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "ert_insertion.h"
 #include "config.hpp"
+#include "loop_analysis.h"
 #include "utils.h"
 
 namespace AP
@@ -63,6 +64,18 @@ namespace AP
             this->ert_pool_type_ = "ERT::SERIAL_POOL";
             break;
         }
+        case ERT_TYPE::WSCL:
+        {
+            this->ert_pool_type_include_header_ = "wscl_pool.hpp";
+            this->ert_pool_type_ = "ERT::WSCL_POOL";
+            break;
+        }
+        case ERT_TYPE::DSS:
+        {
+            this->ert_pool_type_include_header_ = "dss_pool.hpp";
+            this->ert_pool_type_ = "ERT::DSS_POOL";
+            break;
+        }
         default:
         {
             ROSE_ASSERT(false && "Unsupproted ert_type");
@@ -81,18 +94,65 @@ namespace AP
     // http://rosecompiler.org/ROSE_HTML_Reference/namespaceSageBuilder.html#a9c9bb07f0244282e95da666ed3947940
     void SourceFileERTInserter::insertERTIntoForLoop(SgForStatement *for_stmt)
     {
+        // An early exit of the loop cancels the tasks of the later iterations, so all earlier ones still run
+        std::vector<SgBreakStmt *> breaks;
+        std::vector<SgReturnStmt *> returns;
+        AutoParallelization::CollectEarlyExits(for_stmt, breaks, returns);
+        const bool is_exiting_early = !breaks.empty() || !returns.empty();
+        ROSE_ASSERT(!is_exiting_early || (AP::Config::get().enable_early_exit && AutoParallelization::canCancelEarlyExits(for_stmt, breaks, returns)));
+
         SageInterface::attachComment(for_stmt, "================ APERT ================");
         // Create a std::vector<ERT::RAW_TASK>
         SageInterface::addTextForUnparser(for_stmt, "{\n", AstUnparseAttribute::RelativePositionType::e_before);
         SageInterface::addTextForUnparser(for_stmt, "std::vector<ERT::RAW_TASK> " + this->ert_tasks_name_ + ";\n", AstUnparseAttribute::RelativePositionType::e_before);
-        // Execute all tasks
-        SageInterface::addTextForUnparser(for_stmt, "\n" + this->ert_pool_name_ + ".execute(std::move(" + this->ert_tasks_name_ + "));", AstUnparseAttribute::RelativePositionType::e_after);
+        const std::string cancellation_arg = is_exiting_early ? ", " + this->ert_cancellation_name_ : "";
+        if (is_exiting_early)
+        {
+            SageInterface::addTextForUnparser(for_stmt, "ERT::CANCELLATION " + this->ert_cancellation_name_ + ";\n", AstUnparseAttribute::RelativePositionType::e_before);
+        }
+        // Execute all tasks, joining the running session when called from a task
+        SageInterface::addTextForUnparser(for_stmt, "\nERT::execute_shared(" + this->ert_pool_name_ + ", " + this->ert_tasks_name_ + cancellation_arg + ");", AstUnparseAttribute::RelativePositionType::e_after);
+        if (!breaks.empty())
+        {
+            // Leaving the loop variable at the breaking iteration, unless it is declared by the loop and so out of scope
+            SgInitializedName *invarname = nullptr;
+            SgExpression *lower_bound = nullptr;
+            SgExpression *step = nullptr;
+            bool is_incremental = true;
+            const bool is_canonical = SageInterface::isCanonicalForLoop(for_stmt, &invarname, &lower_bound, nullptr, &step, nullptr, &is_incremental);
+            ROSE_ASSERT(is_canonical);
+            if (SageInterface::trans_records.forLoopInitNormalizationTable.count(for_stmt) == 0)
+            {
+                const std::string exit_value = "(" + lower_bound->unparseToString() + (is_incremental ? ") + (" : ") - (") + step->unparseToString() + ") * " +
+                                               this->ert_cancellation_name_ + ".first_cancelled()";
+                SageInterface::addTextForUnparser(for_stmt, "\nif (" + this->ert_cancellation_name_ + ".is_cancelled())\n" + invarname->get_name().getString() + " = " + exit_value + ";",
+                                                  AstUnparseAttribute::RelativePositionType::e_after);
+            }
+        }
+        if (!returns.empty())
+        {
+            // Returning from the function once the loop is done, as the returning iteration would have
+            SageInterface::addTextForUnparser(for_stmt, "\nif (" + this->ert_cancellation_name_ + ".is_cancelled())\nreturn;", AstUnparseAttribute::RelativePositionType::e_after);
+        }
         SageInterface::addTextForUnparser(for_stmt, "\n}", AstUnparseAttribute::RelativePositionType::e_after);
 
         SgStatement *body_stmt = SageInterface::getLoopBody(for_stmt);
-        // Capture the loop body into a lambda task
+        // Capture the loop body into a lambda task, along with its index in the tasks list when it may cancel the later ones
+        const std::string capture = is_exiting_early
+                                        ? "[=, &" + this->ert_cancellation_name_ + ", " + this->ert_task_index_name_ + " = " + this->ert_tasks_name_ + ".size()]"
+                                        : "[=]";
         SageInterface::addTextForUnparser(body_stmt, "{\n", AstUnparseAttribute::RelativePositionType::e_before);
-        SageInterface::addTextForUnparser(body_stmt, "auto " + this->ert_task_name_ + " = [=]()\n", AstUnparseAttribute::RelativePositionType::e_before);
+        SageInterface::addTextForUnparser(body_stmt, "auto " + this->ert_task_name_ + " = " + capture + "()\n", AstUnparseAttribute::RelativePositionType::e_before);
+        // Leave the task instead of the loop or the function
+        const std::string exit_text = "{\n" + this->ert_cancellation_name_ + ".cancel_from(" + this->ert_task_index_name_ + ");\nreturn;\n}";
+        for (SgBreakStmt *break_stmt : breaks)
+        {
+            SageInterface::addTextForUnparser(break_stmt, exit_text, AstUnparseAttribute::RelativePositionType::e_replace);
+        }
+        for (SgReturnStmt *return_stmt : returns)
+        {
+            SageInterface::addTextForUnparser(return_stmt, exit_text, AstUnparseAttribute::RelativePositionType::e_replace);
+        }
         SageInterface::addTextForUnparser(body_stmt, ";", AstUnparseAttribute::RelativePositionType::e_after);
         // Insert the lambda task into the tasks list
         SageInterface::addTextForUnparser(body_stmt, "\n" + this->ert_tasks_name_ + ".emplace_back(std::move(" + this->ert_task_name_ + "));", AstUnparseAttribute::RelativePositionType::e_after);
@@ -107,25 +167,14 @@ namespace AP
 
     void SourceFileERTInserter::insertERTIntoFunction(SgFunctionDefinition *defn, int num_threads)
     {
-        std::string num_threads_str;
-        if (num_threads == -1)
-        {
-            num_threads_str = "std::thread::hardware_concurrency()";
-            this->should_include_thread_header_ = true;
-        }
-        else
-        {
-            num_threads_str = std::to_string(num_threads);
-        }
+        // The default pool sizes itself to the hardware concurrency
+        const std::string num_threads_str = num_threads == -1 ? "" : std::to_string(num_threads);
 
         SgBasicBlock *body = defn->get_body();
-        // Declare and initialize the pool
+        // Refer to the process-wide pool, started by the first call and shared by all calls
         SageInterface::addTextForUnparser(body, "{\n", AstUnparseAttribute::RelativePositionType::e_before);
         SageInterface::addTextForUnparser(body,
-                                          this->ert_pool_type_ + " " + this->ert_pool_name_ + "(" + num_threads_str + ");\n",
-                                          AstUnparseAttribute::RelativePositionType::e_before);
-        SageInterface::addTextForUnparser(body,
-                                          this->ert_pool_name_ + ".start();\n",
+                                          "auto &" + this->ert_pool_name_ + " = ERT::default_pool<" + this->ert_pool_type_ + ">(" + num_threads_str + ");\n",
                                           AstUnparseAttribute::RelativePositionType::e_before);
         SageInterface::addTextForUnparser(body, "\n}", AstUnparseAttribute::RelativePositionType::e_after);
 
@@ -139,9 +188,6 @@ namespace AP
     void SourceFileERTInserter::insertERTHeaderIntoSourceFile()
     {
         SageInterface::insertHeader(this->sfile_, this->ert_pool_type_include_header_, false, true);
-        if (this->should_include_thread_header_)
-        {
-            SageInterface::insertHeader(this->sfile_, "thread", true, true);
-        }
+        SageInterface::insertHeader(this->sfile_, "default_pool.hpp", false, true);
     }
 }
\ No newline at end of file
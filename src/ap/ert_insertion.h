@@ -17,6 +17,7 @@ namespace AP
         ~SourceFileERTInserter();
 
         void insertERTIntoForLoop(SgForStatement *for_stmt);
+        // Binds the function to the process-wide pool, sized by the first call to num_threads.
         // -1 means let generated code decide num_threads at runtime
         void insertERTIntoFunction(SgFunctionDefinition *defn, int num_threads = -1);
 
@@ -32,8 +33,9 @@ namespace AP
         std::string ert_pool_name_ = "__apert_ert_pool";
         std::string ert_tasks_name_ = "__apert_ert_tasks";
         std::string ert_task_name_ = "__apert_ert_task";
+        std::string ert_task_index_name_ = "__apert_ert_itask";
+        std::string ert_cancellation_name_ = "__apert_ert_cancellation";
         bool is_ert_used_ = false;
-        bool should_include_thread_header_ = false;
     };
 
 }
\ No newline at end of file
@@ -1430,6 +1430,50 @@ namespace AutoParallelization
         return false;
     }
 
+    void CollectEarlyExits(SgForStatement *loop, std::vector<SgBreakStmt *> &breaks, std::vector<SgReturnStmt *> &returns)
+    {
+        ROSE_ASSERT(loop != nullptr);
+        // Stops at nested loops and switches, whose breaks stay within the task
+        breaks = SageInterface::findBreakStmts(SageInterface::getLoopBody(loop));
+        returns = SageInterface::querySubTree<SgReturnStmt>(loop, V_SgReturnStmt);
+    }
+
+    bool canCancelEarlyExits(SgForStatement *loop, const std::vector<SgBreakStmt *> &breaks, const std::vector<SgReturnStmt *> &returns)
+    {
+        ROSE_ASSERT(loop != nullptr);
+        if (!breaks.empty() && !returns.empty())
+        {
+            return false;
+        }
+        // The value of the first returning iteration would have to be carried out of the session
+        if (std::any_of(returns.begin(), returns.end(), [](SgReturnStmt *return_stmt)
+                        {
+                            SgExpression *value = return_stmt->get_expression();
+                            return value != nullptr && !isSgNullExpression(value); }))
+        {
+            return false;
+        }
+
+        // Iterations past the exit may have run already, so none of their writes may be seen out of the loop:
+        // no call, and writes only to the variables declared within the body
+        SgStatement *body = SageInterface::getLoopBody(loop);
+        if (!SageInterface::querySubTree<SgFunctionCallExp>(body, V_SgFunctionCallExp).empty())
+        {
+            return false;
+        }
+        std::vector<SgNode *> read_refs;
+        std::vector<SgNode *> write_refs;
+        if (!SageInterface::collectReadWriteRefs(body, read_refs, write_refs))
+        {
+            return false;
+        }
+        return std::all_of(write_refs.begin(), write_refs.end(), [body](SgNode *write_ref)
+                           {
+                               // Anything but a plain variable is written through an array or a pointer
+                               SgVarRefExp *var_ref = isSgVarRefExp(write_ref);
+                               return var_ref != nullptr && SageInterface::isAncestor(body, var_ref->get_symbol()->get_declaration()); });
+    }
+
     // Not in use since we care about top level variables now
     // TODO: move to SageInterface later
     // strip off arrow, dot expressions and get down to smallest data member access expression
@@ -67,4 +67,12 @@ namespace AutoParallelization
     //! Check if a loop has any unsupported language features so we can skip them for now
     bool useUnsupportedLanguageFeatures(SgNode *loop, VariantT *blackConstruct);
 
+    //! Collect the statements exiting a loop early: the breaks of the loop itself, not of nested loops or switches,
+    //! and all returns
+    void CollectEarlyExits(SgForStatement *loop, std::vector<SgBreakStmt *> &breaks, std::vector<SgReturnStmt *> &returns);
+
+    //! Check if the early exits of a loop can be turned into a cancellation of its session:
+    //! breaks, or returns without a value, but not both, in a body writing loop-private variables only
+    bool canCancelEarlyExits(SgForStatement *loop, const std::vector<SgBreakStmt *> &breaks, const std::vector<SgReturnStmt *> &returns);
+
 } // end namespace
@@ -7,6 +7,8 @@ namespace AP
         WSPDR = 0,
         SUAP = 1,
         SERIAL = 2,
+        WSCL = 3,
+        DSS = 4,
         DEFAULT = WSPDR
     };
 }
\ No newline at end of file
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "message.hpp"
+
+/// CPU topology and placement of worker threads
+
+namespace ERT
+{
+    /// A logical CPU and the hardware it shares with other CPUs, -1 when unknown
+    struct CPU_INFO
+    {
+        int cpu = -1;
+        int core = -1;    // SMT siblings share a core
+        int llc = -1;     // Last level cache
+        int package = -1; // Socket
+        int node = -1;    // NUMA node
+    };
+
+    /// The logical CPUs of the machine, as read from sysfs
+    class TOPOLOGY
+    {
+    public:
+        TOPOLOGY() = default;
+        explicit TOPOLOGY(std::vector<CPU_INFO> cpus) : cpus_(std::move(cpus)) {}
+
+        // The online CPUs under root, e.g. /sys/devices/system/cpu; empty if unreadable
+        static TOPOLOGY read(const std::string &root);
+        // The online CPUs the calling thread is allowed to run on, one core per CPU if sysfs is unreadable
+        static TOPOLOGY current();
+
+        const std::vector<CPU_INFO> &cpus() const { return this->cpus_; }
+        size_t size() const { return this->cpus_.size(); }
+        const CPU_INFO *find(int cpu) const;
+        // 0 for the same CPU, then 1 for the same core, 2 for the same last level cache,
+        // 3 for the same package or NUMA node, and 4 for anything further
+        static int distance(const CPU_INFO &a, const CPU_INFO &b);
+        // The workers other than worker_id grouped by the distance from its CPU, nearest first,
+        // or a single group when the workers are not placed, i.e., worker_cpus is empty
+        std::vector<std::vector<int>> group_by_distance(const std::vector<int> &worker_cpus, size_t num_workers, int worker_id) const;
+
+    private:
+        static int read_int(const std::filesystem::path &path); // -1 if unreadable
+        static std::string read_line(const std::filesystem::path &path);
+
+    private:
+        std::vector<CPU_INFO> cpus_;
+    };
+
+    enum class PLACEMENT_KIND
+    {
+        NONE = 0,           // Left to the OS
+        COMPACT = 1,        // Fill a core, then a cache, then a package before the next one
+        SCATTER = 2,        // Spread over packages, then cores, SMT siblings last
+        CPU_LIST = 3,       // Worker i on cpus[i]
+        PHYSICAL_CORES = 4, // One worker per core in compact order, SMT siblings unused
+    };
+
+    /// Where the workers of a pool run, worker i on the i-th CPU of the placement,
+    /// wrapping around when there are more workers than CPUs
+    struct PLACEMENT
+    {
+        PLACEMENT_KIND kind = PLACEMENT_KIND::NONE;
+        std::vector<int> cpus; // For PLACEMENT_KIND::CPU_LIST
+
+        static PLACEMENT none() { return {}; }
+        static PLACEMENT compact() { return {PLACEMENT_KIND::COMPACT, {}}; }
+        static PLACEMENT scatter() { return {PLACEMENT_KIND::SCATTER, {}}; }
+        static PLACEMENT physical_cores() { return {PLACEMENT_KIND::PHYSICAL_CORES, {}}; }
+        static PLACEMENT cpu_list(std::vector<int> cpus) { return {PLACEMENT_KIND::CPU_LIST, std::move(cpus)}; }
+
+        // The CPU of each of num_workers workers, empty for PLACEMENT_KIND::NONE
+        std::vector<int> assign(const TOPOLOGY &topology, size_t num_workers) const;
+    };
+
+    // "0-3,5,7-8" to {0, 1, 2, 3, 5, 7, 8}
+    std::vector<int> parse_cpu_list(const std::string &cpu_list);
+    // Restrict a thread to a single CPU, with a warning on failure
+    bool pin_thread(std::thread::native_handle_type thread, int cpu);
+    bool pin_thread(std::thread &thread, int cpu);
+    bool pin_this_thread(int cpu);
+}
+
+namespace ERT
+{
+    inline int TOPOLOGY::read_int(const std::filesystem::path &path)
+    {
+        std::ifstream file(path);
+        int value = -1;
+        if (!(file >> value))
+        {
+            return -1;
+        }
+        return value;
+    }
+
+    inline std::string TOPOLOGY::read_line(const std::filesystem::path &path)
+    {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return line;
+    }
+
+    inline std::vector<int> parse_cpu_list(const std::string &cpu_list)
+    {
+        std::vector<int> cpus;
+        std::stringstream ss(cpu_list);
+        std::string range;
+        while (std::getline(ss, range, ','))
+        {
+            if (range.empty())
+            {
+                continue;
+            }
+            const size_t dash = range.find('-');
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    inline TOPOLOGY TOPOLOGY::read(const std::string &root)
+    {
+        namespace fs = std::filesystem;
+        std::vector<CPU_INFO> cpus;
+        std::error_code error;
+        if (!fs::exists(fs::path(root) / "online", error))
+        {
+            return TOPOLOGY();
+        }
+        for (int cpu : parse_cpu_list(TOPOLOGY::read_line(fs::path(root) / "online")))
+        {
+            const fs::path cpu_path = fs::path(root) / ("cpu" + std::to_string(cpu));
+            CPU_INFO info;
+            info.cpu = cpu;
+            info.core = TOPOLOGY::read_int(cpu_path / "topology" / "core_id");
+            info.package = TOPOLOGY::read_int(cpu_path / "topology" / "physical_package_id");
+            // The highest cache index is the last level
+            for (int index = 3; index >= 0 && info.llc < 0; index--)
+            {
+                info.llc = TOPOLOGY::read_int(cpu_path / "cache" / ("index" + std::to_string(index)) / "id");
+            }
+            for (const auto &entry : fs::directory_iterator(cpu_path, error))
+            {
+                const std::string name = entry.path().filename().string();
+                if (name.rfind("node", 0) == 0 && name.size() > 4 && std::isdigit(static_cast<unsigned char>(name[4])))
+                {
+                    info.node = std::stoi(name.substr(4));
+                }
+            }
+            cpus.push_back(info);
+        }
+        return TOPOLOGY(std::move(cpus));
+    }
+
+    inline TOPOLOGY TOPOLOGY::current()
+    {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        const bool has_allowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+        std::vector<CPU_INFO> cpus = TOPOLOGY::read("/sys/devices/system/cpu").cpus_;
+        if (cpus.empty())
+        {
+            const int num_cpus = std::max(1u, std::thread::hardware_concurrency());
+            for (int cpu = 0; cpu < num_cpus; cpu++)
+            {
+                cpus.push_back(CPU_INFO{cpu, cpu, -1, 0, -1});
+            }
+        }
+        if (has_allowed)
+        {
+            std::vector<CPU_INFO> allowed_cpus;
+            std::copy_if(cpus.begin(), cpus.end(), std::back_inserter(allowed_cpus), [&allowed](const CPU_INFO &info)
+                         { return info.cpu < CPU_SETSIZE && CPU_ISSET(info.cpu, &allowed); });
+            if (!allowed_cpus.empty())
+            {
+                cpus = std::move(allowed_cpus);
+            }
+        }
+        return TOPOLOGY(std::move(cpus));
+    }
+
+    inline const CPU_INFO *TOPOLOGY::find(int cpu) const
+    {
+        auto it = std::find_if(this->cpus_.begin(), this->cpus_.end(), [cpu](const CPU_INFO &info)
+                               { return info.cpu == cpu; });
+        return it == this->cpus_.end() ? nullptr : &*it;
+    }
+
+    inline int TOPOLOGY::distance(const CPU_INFO &a, const CPU_INFO &b)
+    {
+        auto same = [](int x, int y)
+        { return x >= 0 && x == y; };
+        if (a.cpu == b.cpu)
+        {
+            return 0;
+        }
+        if (same(a.package, b.package) && same(a.core, b.core))
+        {
+            return 1;
+        }
+        if (same(a.llc, b.llc) && (a.package < 0 || a.package == b.package))
+        {
+            return 2;
+        }
+        if (same(a.package, b.package) || same(a.node, b.node))
+        {
+            return 3;
+        }
+        return 4;
+    }
+
+    inline std::vector<std::vector<int>> TOPOLOGY::group_by_distance(const std::vector<int> &worker_cpus, size_t num_workers, int worker_id) const
+    {
+        constexpr int max_distance = 4;
+        std::vector<std::vector<int>> groups(max_distance + 1);
+        for (int other_worker_id = 0; other_worker_id < static_cast<int>(num_workers); other_worker_id++)
+        {
+            if (other_worker_id == worker_id)
+            {
+                continue;
+            }
+            int distance = max_distance;
+            if (!worker_cpus.empty())
+            {
+                const CPU_INFO *cpu = this->find(worker_cpus[worker_id]);
+                const CPU_INFO *other_cpu = this->find(worker_cpus[other_worker_id]);
+                if (cpu && other_cpu)
+                {
+                    distance = TOPOLOGY::distance(*cpu, *other_cpu);
+                }
+            }
+            groups[distance].push_back(other_worker_id);
+        }
+        groups.erase(std::remove_if(groups.begin(), groups.end(), [](const std::vector<int> &group)
+                                    { return group.empty(); }),
+                     groups.end());
+        return groups;
+    }
+
+    inline std::vector<int> PLACEMENT::assign(const TOPOLOGY &topology, size_t num_workers) const
+    {
+        if (this->kind == PLACEMENT_KIND::NONE)
+        {
+            return {};
+        }
+
+        std::vector<int> cpus;
+        if (this->kind == PLACEMENT_KIND::CPU_LIST)
+        {
+            cpus = this->cpus;
+        }
+        else
+        {
+            // Compact order, SMT siblings next to each other
+            std::vector<CPU_INFO> infos = topology.cpus();
+            std::sort(infos.begin(), infos.end(), [](const CPU_INFO &a, const CPU_INFO &b)
+                      { return std::tie(a.node, a.package, a.llc, a.core, a.cpu) < std::tie(b.node, b.package, b.llc, b.core, b.cpu); });
+
+            // Rank of each CPU within its core, and of each core within its package
+            std::vector<std::tuple<size_t, size_t, size_t, int>> ranked; // {smt rank, core rank, package rank, cpu}
+            std::map<std::pair<int, int>, size_t> num_smt_ranks;         // {package, core} to the CPUs seen so far
+            std::map<int, std::map<int, size_t>> core_ranks;             // package to core to rank
+            std::map<int, size_t> package_ranks;
+            for (const CPU_INFO &info : infos)
+            {
+                const size_t smt_rank = num_smt_ranks[{info.package, info.core}]++;
+                auto &package_cores = core_ranks[info.package];
+                const size_t core_rank = package_cores.emplace(info.core, package_cores.size()).first->second;
+                const size_t package_rank = package_ranks.emplace(info.package, package_ranks.size()).first->second;
+                ranked.emplace_back(smt_rank, core_rank, package_rank, info.cpu);
+            }
+
+            if (this->kind == PLACEMENT_KIND::SCATTER)
+            {
+                std::stable_sort(ranked.begin(), ranked.end());
+            }
+            for (const auto &[smt_rank, core_rank, package_rank, cpu] : ranked)
+            {
+                if (this->kind != PLACEMENT_KIND::PHYSICAL_CORES || smt_rank == 0)
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        if (cpus.empty())
+        {
+            return {};
+        }
+
+        std::vector<int> worker_cpus(num_workers);
+        for (size_t worker_id = 0; worker_id < num_workers; worker_id++)
+        {
+            worker_cpus[worker_id] = cpus[worker_id % cpus.size()];
+        }
+        return worker_cpus;
+    }
+
+    inline bool pin_thread(std::thread::native_handle_type thread, int cpu)
+    {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        const int error = pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set);
+        if (error != 0)
+        {
+            warn("[AFFINITY] failed to pin a thread on cpu %d, error=%d\n", cpu, error);
+            return false;
+        }
+        return true;
+    }
+
+    inline bool pin_thread(std::thread &thread, int cpu)
+    {
+        return pin_thread(thread.native_handle(), cpu);
+    }
+
+    inline bool pin_this_thread(int cpu)
+    {
+        return pin_thread(pthread_self(), cpu);
+    }
+}
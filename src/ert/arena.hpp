@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "macros.hpp"
+
+/// Bump allocator for the transient state of a session
+
+namespace ERT
+{
+    /// Allocates by bumping an offset through a list of blocks, deallocation is a no-op.
+    /// reset() rewinds to the first block in O(1), keeping the blocks for the next session,
+    /// so a steady state session does not call malloc.
+    /// Not thread safe, but memory handed out may be read and released by other threads.
+    class ARENA
+    {
+    public:
+        explicit ARENA(size_t block_size = 64 * 1024) : block_size_(block_size) {}
+        ARENA(const ARENA &) = delete;
+        ARENA &operator=(const ARENA &) = delete;
+
+        void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+        template <typename T, typename... ARGS>
+        T *create(ARGS &&...args) { return ::new (this->allocate(sizeof(T), alignof(T))) T(std::forward<ARGS>(args)...); }
+        void reset();
+
+        size_t num_blocks() const { return this->blocks_.size(); }
+
+    private:
+        struct BLOCK
+        {
+            std::unique_ptr<unsigned char[]> data;
+            size_t size;
+        };
+
+    private:
+        size_t block_size_;
+        std::vector<BLOCK> blocks_;
+        size_t iblock_ = 0;
+        size_t offset_ = 0;
+    };
+
+    /// Standard allocator drawing from an ARENA, e.g. for a std::vector of transient state
+    template <typename T>
+    class ARENA_ALLOCATOR
+    {
+    public:
+        using value_type = T;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        ARENA_ALLOCATOR() = default;
+        explicit ARENA_ALLOCATOR(ARENA *arena) : arena_(arena) {}
+        template <typename U>
+        ARENA_ALLOCATOR(const ARENA_ALLOCATOR<U> &other) : arena_(other.arena()) {}
+
+        T *allocate(size_t n)
+        {
+            ASSERT(this->arena_);
+            return static_cast<T *>(this->arena_->allocate(n * sizeof(T), alignof(T)));
+        }
+        void deallocate(T *, size_t) {} // Reclaimed by ARENA::reset()
+
+        ARENA *arena() const { return this->arena_; }
+
+        template <typename U>
+        bool operator==(const ARENA_ALLOCATOR<U> &other) const { return this->arena_ == other.arena(); }
+        template <typename U>
+        bool operator!=(const ARENA_ALLOCATOR<U> &other) const { return this->arena_ != other.arena(); }
+
+    private:
+        ARENA *arena_ = nullptr;
+    };
+
+    /// An ARENA owned by a worker, reset by its owner thread at its first use in a new session.
+    /// When execute() returns, other workers may still be returning from the last tasks of the session,
+    /// so the owner resets lazily once the session clock of the pool has moved on.
+    class SESSION_ARENA
+    {
+    public:
+        void bind(const std::atomic<uint64_t> *session_clock) { this->session_clock_ = session_clock; }
+        ARENA &get();
+
+    private:
+        ARENA arena_;
+        const std::atomic<uint64_t> *session_clock_ = nullptr;
+        uint64_t session_ = 0;
+    };
+}
+
+namespace ERT
+{
+    inline void *ARENA::allocate(size_t size, size_t alignment)
+    {
+        while (this->iblock_ < this->blocks_.size())
+        {
+            BLOCK &block = this->blocks_[this->iblock_];
+            const uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+            const uintptr_t aligned = (base + this->offset_ + alignment - 1) & ~(uintptr_t(alignment) - 1);
+            if (aligned + size <= base + block.size)
+            {
+                this->offset_ = aligned + size - base;
+                return reinterpret_cast<void *>(aligned);
+            }
+            // Move on to the next block kept from a previous session
+            this->iblock_++;
+            this->offset_ = 0;
+        }
+
+        const size_t block_size = std::max(this->block_size_, size + alignment);
+        this->blocks_.push_back(BLOCK{std::make_unique<unsigned char[]>(block_size), block_size});
+        this->iblock_ = this->blocks_.size() - 1;
+        this->offset_ = 0;
+        return this->allocate(size, alignment);
+    }
+
+    inline void ARENA::reset()
+    {
+        this->iblock_ = 0;
+        this->offset_ = 0;
+    }
+
+    inline ARENA &SESSION_ARENA::get()
+    {
+        ASSERT(this->session_clock_);
+        const uint64_t session = this->session_clock_->load();
+        if (session != this->session_)
+        {
+            this->arena_.reset();
+            this->session_ = session;
+        }
+        return this->arena_;
+    }
+}
@@ -0,0 +1,482 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "dss_pool.hpp"
+#include "pool.hpp"
+#include "serial_pool.hpp"
+#include "suap_pool.hpp"
+#include "wscl_pool.hpp"
+#include "wspdr_pool.hpp"
+#include "wspds_pool.hpp"
+
+/// Benchmark harness of the pools: repeated measurements summarized as distributions,
+/// written as CSV or JSON for comparisons across commits and machines.
+
+namespace BENCH
+{
+    /// Distribution of the samples of a measurement, in seconds
+    struct SUMMARY
+    {
+        size_t num_samples = 0;
+        double mean = 0;
+        double stddev = 0; // Of the sample, 0 for a single sample
+        double min = 0;
+        double median = 0;
+        double p95 = 0;
+        double max = 0;
+    };
+    SUMMARY summarize(std::vector<double> samples);
+
+    // Runs run() num_warmups times, then returns the duration of num_repetitions more runs in seconds.
+    // run() may return the seconds it measured itself, to leave its setup out.
+    template <typename F>
+    std::vector<double> sample(size_t num_warmups, size_t num_repetitions, F &&run);
+
+    struct RESULT
+    {
+        std::string benchmark; // e.g. the workload
+        std::string pool;
+        size_t num_workers = 0;
+        size_t num_tasks = 0; // Per sample, 0 if not meaningful
+        SUMMARY summary;
+        double speedup = 0; // Median over the median of the baseline, 0 without baseline
+
+        // Tasks per second at the median
+        double throughput() const { return this->num_tasks > 0 && this->summary.median > 0 ? this->num_tasks / this->summary.median : 0; }
+    };
+
+    class REPORT
+    {
+    public:
+        // Prints a line for the result as well. Results without samples are left out.
+        void add(RESULT result);
+        const std::vector<RESULT> &results() const { return this->results_; }
+        // Speedup of every result over the result of baseline_pool for the same benchmark
+        void compute_speedups(const std::string &baseline_pool = "SERIAL");
+
+        std::string to_csv() const; // A header line, then a line per result
+        std::string to_json() const;
+        // Writes to_csv() or to_json() to path by its extension, false if it cannot be written
+        bool write(const std::string &path) const;
+        // The results of a CSV written by to_csv(), without their speedups, false if it cannot be read or has no result
+        bool read_csv(const std::string &path);
+
+        // Prints the results whose median is more than tolerance slower than the same result in baseline,
+        // returning how many
+        size_t compare(const REPORT &baseline, double tolerance) const;
+
+    private:
+        std::vector<RESULT> results_;
+    };
+
+    /// The pools under benchmark, by name
+    struct POOL_FACTORY
+    {
+        const char *name;
+        std::function<std::unique_ptr<ERT::POOL>(size_t num_workers)> make;
+        bool is_serial; // Runs with a single worker whatever asked
+    };
+    const std::vector<POOL_FACTORY> &pool_factories();
+
+    /// Command line of a benchmark driver, as --name=value
+    struct OPTIONS
+    {
+        std::vector<size_t> workers;           // Thread counts, powers of 2 up to the hardware threads by default
+        std::vector<std::string> pools;        // All by default
+        std::vector<std::string> benchmarks;   // All by default
+        size_t num_warmups = 1;
+        size_t num_repetitions = 5;
+        bool is_quick = false; // Smaller problem sizes, for a smoke test
+        std::vector<std::string> output_paths; // .csv or .json
+        std::string baseline_path;             // A CSV of an earlier run to compare against
+        double tolerance = 0.1;                // Slowdown of a median over the baseline counted as a regression
+
+        // False with a usage message on stderr if the command line is invalid
+        bool parse(int argc, char **argv);
+        bool selects_pool(const std::string &name) const { return is_selected(this->pools, name); }
+        bool selects_benchmark(const std::string &name) const { return is_selected(this->benchmarks, name); }
+        // Writes the report to every output path, false if any cannot be written
+        bool write(const REPORT &report) const;
+        // Compares the report to the baseline if any, false if it cannot be read or if any result regressed
+        bool check_baseline(const REPORT &report) const;
+
+    private:
+        static bool is_selected(const std::vector<std::string> &names, const std::string &name);
+    };
+}
+
+// Implementation
+namespace BENCH
+{
+    inline SUMMARY summarize(std::vector<double> samples)
+    {
+        SUMMARY summary;
+        summary.num_samples = samples.size();
+        if (samples.empty())
+        {
+            return summary;
+        }
+        std::sort(samples.begin(), samples.end());
+        const size_t n = samples.size();
+        double sum = 0;
+        for (double x : samples)
+        {
+            sum += x;
+        }
+        summary.mean = sum / n;
+        double sum_squares = 0;
+        for (double x : samples)
+        {
+            sum_squares += (x - summary.mean) * (x - summary.mean);
+        }
+        summary.stddev = n > 1 ? std::sqrt(sum_squares / (n - 1)) : 0;
+        summary.min = samples.front();
+        summary.max = samples.back();
+        summary.median = n % 2 == 1 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+        // Nearest rank
+        summary.p95 = samples[static_cast<size_t>(std::ceil(0.95 * n)) - 1];
+        return summary;
+    }
+
+    template <typename F>
+    std::vector<double> sample(size_t num_warmups, size_t num_repetitions, F &&run)
+    {
+        auto run_once = [&run]() -> double
+        {
+            const auto start_time = std::chrono::steady_clock::now();
+            if constexpr (std::is_void_v<decltype(run())>)
+            {
+                run();
+                return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+            }
+            else
+            {
+                return run();
+            }
+        };
+
+        for (size_t i = 0; i < num_warmups; i++)
+        {
+            run_once();
+        }
+        std::vector<double> samples;
+        samples.reserve(num_repetitions);
+        for (size_t i = 0; i < num_repetitions; i++)
+        {
+            samples.push_back(run_once());
+        }
+        return samples;
+    }
+
+    inline void REPORT::add(RESULT result)
+    {
+        const SUMMARY &summary = result.summary;
+        if (summary.num_samples == 0)
+        {
+            printf("BENCH: [%s] %s x%lu: no samples\n", result.benchmark.c_str(), result.pool.c_str(), result.num_workers);
+            return;
+        }
+        printf("BENCH: [%s] %s x%lu: median %.9f s, p95 %.9f s, stddev %.9f s (%lu samples)\n",
+               result.benchmark.c_str(), result.pool.c_str(), result.num_workers,
+               summary.median, summary.p95, summary.stddev, summary.num_samples);
+        this->results_.push_back(std::move(result));
+    }
+
+    inline void REPORT::compute_speedups(const std::string &baseline_pool)
+    {
+        for (RESULT &result : this->results_)
+        {
+            auto baseline = std::find_if(this->results_.begin(), this->results_.end(), [&](const RESULT &other)
+                                         { return other.benchmark == result.benchmark && other.pool == baseline_pool; });
+            result.speedup = baseline != this->results_.end() && result.summary.median > 0
+                                 ? baseline->summary.median / result.summary.median
+                                 : 0;
+        }
+    }
+
+    inline std::string REPORT::to_csv() const
+    {
+        char buffer[512];
+        std::string csv = "benchmark,pool,workers,tasks,samples,mean,stddev,min,median,p95,max,speedup,throughput\n";
+        for (const RESULT &result : this->results_)
+        {
+            const SUMMARY &summary = result.summary;
+            snprintf(buffer, sizeof(buffer), "%s,%s,%lu,%lu,%lu,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,",
+                     result.benchmark.c_str(), result.pool.c_str(), result.num_workers, result.num_tasks, summary.num_samples,
+                     summary.mean, summary.stddev, summary.min, summary.median, summary.p95, summary.max);
+            csv += buffer;
+            // Empty when unavailable
+            csv += result.speedup > 0 ? std::to_string(result.speedup) : "";
+            csv += ",";
+            csv += result.throughput() > 0 ? std::to_string(result.throughput()) : "";
+            csv += "\n";
+        }
+        return csv;
+    }
+
+    inline std::string REPORT::to_json() const
+    {
+        char buffer[512];
+        std::string json = "{\"hardware_threads\": " + std::to_string(std::thread::hardware_concurrency()) + ", \"results\": [";
+        for (size_t iresult = 0; iresult < this->results_.size(); iresult++)
+        {
+            const RESULT &result = this->results_[iresult];
+            const SUMMARY &summary = result.summary;
+            snprintf(buffer, sizeof(buffer),
+                     "%s\n{\"benchmark\": \"%s\", \"pool\": \"%s\", \"workers\": %lu, \"tasks\": %lu, \"samples\": %lu, "
+                     "\"mean\": %.9f, \"stddev\": %.9f, \"min\": %.9f, \"median\": %.9f, \"p95\": %.9f, \"max\": %.9f, ",
+                     iresult == 0 ? "" : ",", result.benchmark.c_str(), result.pool.c_str(), result.num_workers, result.num_tasks,
+                     summary.num_samples, summary.mean, summary.stddev, summary.min, summary.median, summary.p95, summary.max);
+            json += buffer;
+            json += "\"speedup\": " + (result.speedup > 0 ? std::to_string(result.speedup) : std::string("null"));
+            json += ", \"throughput\": " + (result.throughput() > 0 ? std::to_string(result.throughput()) : std::string("null"));
+            json += "}";
+        }
+        json += "\n]}\n";
+        return json;
+    }
+
+    inline bool REPORT::write(const std::string &path) const
+    {
+        const bool is_json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+        const std::string content = is_json ? this->to_json() : this->to_csv();
+        FILE *file = fopen(path.c_str(), "w");
+        if (!file)
+        {
+            return false;
+        }
+        const bool is_written = fwrite(content.data(), 1, content.size(), file) == content.size();
+        return fclose(file) == 0 && is_written;
+    }
+
+    inline bool REPORT::read_csv(const std::string &path)
+    {
+        FILE *file = fopen(path.c_str(), "r");
+        if (!file)
+        {
+            return false;
+        }
+        char line[1024];
+        bool is_header = true;
+        size_t num_results = 0;
+        while (fgets(line, sizeof(line), file))
+        {
+            if (is_header)
+            {
+                is_header = false;
+                continue;
+            }
+            char benchmark[256];
+            char pool[64];
+            RESULT result;
+            SUMMARY &summary = result.summary;
+            if (sscanf(line, "%255[^,],%63[^,],%lu,%lu,%lu,%lf,%lf,%lf,%lf,%lf,%lf", benchmark, pool, &result.num_workers, &result.num_tasks,
+                       &summary.num_samples, &summary.mean, &summary.stddev, &summary.min, &summary.median, &summary.p95, &summary.max) == 11)
+            {
+                result.benchmark = benchmark;
+                result.pool = pool;
+                this->results_.push_back(std::move(result));
+                num_results++;
+            }
+        }
+        fclose(file);
+        return num_results != 0;
+    }
+
+    inline size_t REPORT::compare(const REPORT &baseline, double tolerance) const
+    {
+        size_t num_regressions = 0;
+        for (const RESULT &result : this->results_)
+        {
+            auto before = std::find_if(baseline.results_.begin(), baseline.results_.end(), [&](const RESULT &other)
+                                       { return other.benchmark == result.benchmark && other.pool == result.pool && other.num_workers == result.num_workers; });
+            if (before == baseline.results_.end() || before->summary.median <= 0)
+            {
+                continue;
+            }
+            const double slowdown = result.summary.median / before->summary.median - 1;
+            if (slowdown > tolerance)
+            {
+                printf("BENCH: REGRESSION [%s] %s x%lu: median %.9f s -> %.9f s (+%.1f%%)\n", result.benchmark.c_str(), result.pool.c_str(),
+                       result.num_workers, before->summary.median, result.summary.median, 100 * slowdown);
+                num_regressions++;
+            }
+        }
+        return num_regressions;
+    }
+
+    inline const std::vector<POOL_FACTORY> &pool_factories()
+    {
+        static const std::vector<POOL_FACTORY> factories = {
+            {"SERIAL", [](size_t num_workers)
+             { return std::make_unique<ERT::SERIAL_POOL>(num_workers); },
+             true},
+            {"SUAP", [](size_t num_workers)
+             { return std::make_unique<ERT::SUAP_POOL>(num_workers); },
+             false},
+            {"SUAP_CYCLIC", [](size_t num_workers)
+             { return std::make_unique<ERT::SUAP_POOL>(num_workers, ERT::SUAP_PARTITION::CYCLIC); },
+             false},
+            {"DSS", [](size_t num_workers)
+             { return std::make_unique<ERT::DSS_POOL>(num_workers); },
+             false},
+            {"WSPDR", [](size_t num_workers)
+             { return std::make_unique<ERT::WSPDR_POOL>(num_workers); },
+             false},
+            {"WSPDS", [](size_t num_workers)
+             { return std::make_unique<ERT::WSPDS_POOL>(num_workers); },
+             false},
+            {"WSCL", [](size_t num_workers)
+             { return std::make_unique<ERT::WSCL_POOL>(num_workers); },
+             false},
+        };
+        return factories;
+    }
+
+    inline bool OPTIONS::parse(int argc, char **argv)
+    {
+        auto split = [](const std::string &list)
+        {
+            std::vector<std::string> items;
+            size_t begin = 0;
+            while (begin <= list.size())
+            {
+                const size_t end = std::min(list.find(',', begin), list.size());
+                if (end > begin)
+                {
+                    items.push_back(list.substr(begin, end - begin));
+                }
+                begin = end + 1;
+            }
+            return items;
+        };
+        auto to_size = [](const std::string &text, size_t &value)
+        {
+            char *end = nullptr;
+            value = std::strtoul(text.c_str(), &end, 10);
+            return !text.empty() && *end == '\0';
+        };
+
+        bool is_valid = true;
+        for (int iarg = 1; iarg < argc && is_valid; iarg++)
+        {
+            const std::string arg = argv[iarg];
+            const size_t equal = arg.find('=');
+            const std::string name = arg.substr(0, equal);
+            const std::string value = equal == std::string::npos ? "" : arg.substr(equal + 1);
+            if (name == "--workers")
+            {
+                this->workers.clear();
+                for (const std::string &item : split(value))
+                {
+                    size_t num_workers = 0;
+                    is_valid = is_valid && to_size(item, num_workers) && num_workers > 0;
+                    this->workers.push_back(num_workers);
+                }
+            }
+            else if (name == "--pools")
+            {
+                this->pools = split(value);
+            }
+            else if (name == "--benchmarks")
+            {
+                this->benchmarks = split(value);
+            }
+            else if (name == "--warmup")
+            {
+                is_valid = to_size(value, this->num_warmups);
+            }
+            else if (name == "--repetitions")
+            {
+                is_valid = to_size(value, this->num_repetitions) && this->num_repetitions > 0;
+            }
+            else if (name == "--quick")
+            {
+                this->is_quick = true;
+            }
+            else if (name == "--output")
+            {
+                is_valid = !value.empty();
+                this->output_paths.push_back(value);
+            }
+            else if (name == "--baseline")
+            {
+                is_valid = !value.empty();
+                this->baseline_path = value;
+            }
+            else if (name == "--tolerance")
+            {
+                char *end = nullptr;
+                this->tolerance = std::strtod(value.c_str(), &end);
+                is_valid = !value.empty() && *end == '\0' && this->tolerance >= 0;
+            }
+            else
+            {
+                is_valid = false;
+            }
+        }
+        if (!is_valid)
+        {
+            fprintf(stderr, "Usage: %s [--workers=1,2,4] [--pools=SERIAL,WSPDR] [--benchmarks=name,...] [--warmup=1] [--repetitions=5] "
+                            "[--quick] [--output=results.csv] [--output=results.json] [--baseline=before.csv] [--tolerance=0.1]\n",
+                    argv[0]);
+            return false;
+        }
+
+        if (this->workers.empty())
+        {
+            const size_t num_hardware_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+            for (size_t num_workers = 1; num_workers < num_hardware_threads; num_workers *= 2)
+            {
+                this->workers.push_back(num_workers);
+            }
+            this->workers.push_back(num_hardware_threads);
+        }
+        return true;
+    }
+
+    inline bool OPTIONS::write(const REPORT &report) const
+    {
+        bool is_written = true;
+        for (const std::string &path : this->output_paths)
+        {
+            if (!report.write(path))
+            {
+                fprintf(stderr, "BENCH: cannot write %s\n", path.c_str());
+                is_written = false;
+            }
+        }
+        return is_written;
+    }
+
+    inline bool OPTIONS::check_baseline(const REPORT &report) const
+    {
+        if (this->baseline_path.empty())
+        {
+            return true;
+        }
+        REPORT baseline;
+        if (!baseline.read_csv(this->baseline_path))
+        {
+            fprintf(stderr, "BENCH: cannot read %s\n", this->baseline_path.c_str());
+            return false;
+        }
+        return report.compare(baseline, this->tolerance) == 0;
+    }
+
+    inline bool OPTIONS::is_selected(const std::vector<std::string> &names, const std::string &name)
+    {
+        return names.empty() || std::find(names.begin(), names.end(), name) != names.end();
+    }
+}
@@ -0,0 +1,220 @@
+#define MESSAGE_LEVEL 0
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.hpp"
+
+/// Scheduling overhead of the pools, with tasks doing next to nothing, so that the cost of the runtime itself shows.
+/// Latencies are sampled per call, num_repetitions times a batch of calls, to get a distribution.
+/// Usage: overhead_bench [--workers=1,2,4] [--pools=SUAP,WSPDR] [--benchmarks=execute_1,wakeup] [--output=results.csv]
+
+using namespace ERT;
+
+namespace
+{
+    using CLOCK = std::chrono::steady_clock;
+
+    constexpr size_t num_latency_samples_per_repetition = 100;
+
+    struct CONTEXT
+    {
+        const BENCH::OPTIONS &options;
+        const BENCH::POOL_FACTORY &pool_factory;
+        size_t num_workers;
+        BENCH::REPORT &report;
+
+        void add(const char *benchmark, const POOL &pool, size_t num_tasks, std::vector<double> samples) const
+        {
+            this->report.add({benchmark, this->pool_factory.name, pool.num_workers(), num_tasks, BENCH::summarize(std::move(samples))});
+        }
+    };
+
+    void spin_for(std::chrono::nanoseconds duration)
+    {
+        const CLOCK::time_point end = CLOCK::now() + duration;
+        while (CLOCK::now() < end)
+        {
+        }
+    }
+
+    // num_tasks copies of f
+    template <typename F>
+    std::vector<RAW_TASK> make_tasks(size_t num_tasks, const F &f)
+    {
+        std::vector<RAW_TASK> tasks;
+        tasks.reserve(num_tasks);
+        for (size_t itask = 0; itask < num_tasks; itask++)
+        {
+            tasks.emplace_back(f);
+        }
+        return tasks;
+    }
+
+    std::unique_ptr<POOL> start_pool(const CONTEXT &context)
+    {
+        std::unique_ptr<POOL> pool = context.pool_factory.make(context.num_workers);
+        pool->start();
+        return pool;
+    }
+
+    // Sessions of many empty tasks, for the tasks per second
+    void bench_empty_tasks(const CONTEXT &context)
+    {
+        const size_t num_tasks = context.options.is_quick ? 1000 : 100000;
+        std::vector<RAW_TASK> tasks = make_tasks(num_tasks, []() {});
+        std::unique_ptr<POOL> pool = start_pool(context);
+        context.add("empty_tasks", *pool, num_tasks,
+                    BENCH::sample(context.options.num_warmups, context.options.num_repetitions, [&]()
+                                  { pool->execute(tasks); }));
+    }
+
+    // Round trip of execute() on a session of num_tasks empty tasks, the pool being hot
+    void bench_execute(const CONTEXT &context, const char *benchmark, size_t num_tasks)
+    {
+        std::vector<RAW_TASK> tasks = make_tasks(num_tasks, []() {});
+        std::unique_ptr<POOL> pool = start_pool(context);
+        context.add(benchmark, *pool, num_tasks,
+                    BENCH::sample(context.options.num_warmups * num_latency_samples_per_repetition,
+                                  context.options.num_repetitions * num_latency_samples_per_repetition, [&]()
+                                  { pool->execute(tasks); }));
+    }
+
+    void bench_execute_1(const CONTEXT &context) { bench_execute(context, "execute_1", 1); }
+    void bench_execute_64(const CONTEXT &context) { bench_execute(context, "execute_64", 64); }
+
+    // start() then terminate() of a constructed pool, launching and joining its executors
+    void bench_start_terminate(const CONTEXT &context)
+    {
+        constexpr size_t num_samples_per_repetition = 10;
+        std::unique_ptr<POOL> last_pool;
+        std::vector<double> samples = BENCH::sample(context.options.num_warmups, context.options.num_repetitions * num_samples_per_repetition, [&]()
+                                                    {
+                                                        last_pool = context.pool_factory.make(context.num_workers);
+                                                        const CLOCK::time_point start_time = CLOCK::now();
+                                                        last_pool->start();
+                                                        last_pool->terminate();
+                                                        return std::chrono::duration<double>(CLOCK::now() - start_time).count(); });
+        context.add("start_terminate", *last_pool, 0, std::move(samples));
+    }
+
+    // Time a WSPDR thief waits for the response of its victim per steal request, averaged over a session.
+    // The caller seeds every task in its deque, so the other workers get theirs by stealing.
+    void bench_steal_latency(const CONTEXT &context)
+    {
+        if (std::string(context.pool_factory.name) != "WSPDR" || context.num_workers < 2)
+        {
+            return;
+        }
+        const size_t num_tasks = 16 * context.num_workers;
+        std::vector<RAW_TASK> tasks = make_tasks(num_tasks, []()
+                                                 { spin_for(std::chrono::microseconds(10)); });
+        std::unique_ptr<POOL> pool = start_pool(context);
+        pool->set_stats_timing(true);
+        for (size_t i = 0; i < context.options.num_warmups; i++)
+        {
+            pool->execute(tasks);
+        }
+        std::vector<double> samples;
+        const size_t num_sessions = context.options.num_repetitions * num_latency_samples_per_repetition / 10;
+        for (size_t i = 0; i < num_sessions; i++)
+        {
+            const POOL_STATS before = pool->stats();
+            pool->execute(tasks);
+            const WORKER_STATS session = (pool->stats() - before).total();
+            if (session.num_steal_attempts > 0)
+            {
+                samples.push_back(session.steal_wait_time / session.num_steal_attempts);
+            }
+        }
+        context.add("steal_latency", *pool, num_tasks, std::move(samples));
+    }
+
+    // From execute() after the pool idled long enough to park its workers, to the first task run by a worker
+    // other than the caller. Sessions where the caller ran every task are left out.
+    void bench_wakeup(const CONTEXT &context)
+    {
+        if (context.pool_factory.is_serial || context.num_workers < 2)
+        {
+            return;
+        }
+        const std::chrono::milliseconds idle_time(context.options.is_quick ? 2 : 20);
+        std::atomic<int64_t> first_remote_start = 0; // Nanoseconds since the clock epoch, 0 until a worker started
+        std::vector<RAW_TASK> tasks = make_tasks(4 * context.num_workers, [&first_remote_start]()
+                                                 {
+                                                     if (WORKER_INDEX::current() != 0)
+                                                     {
+                                                         int64_t expected = 0;
+                                                         first_remote_start.compare_exchange_strong(expected, CLOCK::now().time_since_epoch().count());
+                                                     }
+                                                     spin_for(std::chrono::microseconds(20)); });
+        std::unique_ptr<POOL> pool = start_pool(context);
+        std::vector<double> samples;
+        const size_t num_sessions = context.options.num_repetitions * num_latency_samples_per_repetition / 10;
+        for (size_t i = 0; i < num_sessions; i++)
+        {
+            std::this_thread::sleep_for(idle_time);
+            first_remote_start = 0;
+            const CLOCK::time_point start_time = CLOCK::now();
+            pool->execute(tasks);
+            if (first_remote_start != 0)
+            {
+                samples.push_back(std::chrono::duration<double>(CLOCK::time_point(CLOCK::duration(first_remote_start.load())) - start_time).count());
+            }
+        }
+        context.add("wakeup", *pool, tasks.size(), std::move(samples));
+    }
+
+    struct MICROBENCHMARK
+    {
+        const char *name;
+        void (*run)(const CONTEXT &context);
+    };
+
+    const MICROBENCHMARK microbenchmarks[] = {
+        {"empty_tasks", bench_empty_tasks},
+        {"execute_1", bench_execute_1},
+        {"execute_64", bench_execute_64},
+        {"start_terminate", bench_start_terminate},
+        {"steal_latency", bench_steal_latency},
+        {"wakeup", bench_wakeup},
+    };
+}
+
+int main(int argc, char **argv)
+{
+    BENCH::OPTIONS options;
+    if (!options.parse(argc, argv))
+    {
+        return 1;
+    }
+
+    BENCH::REPORT report;
+    for (const MICROBENCHMARK &microbenchmark : microbenchmarks)
+    {
+        if (!options.selects_benchmark(microbenchmark.name))
+        {
+            continue;
+        }
+        for (const BENCH::POOL_FACTORY &pool_factory : BENCH::pool_factories())
+        {
+            if (!options.selects_pool(pool_factory.name))
+            {
+                continue;
+            }
+            for (size_t num_workers : options.workers)
+            {
+                microbenchmark.run(CONTEXT{options, pool_factory, num_workers, report});
+                if (pool_factory.is_serial)
+                {
+                    break; // The same for every thread count
+                }
+            }
+        }
+    }
+    return options.write(report) && options.check_baseline(report) ? 0 : 1;
+}
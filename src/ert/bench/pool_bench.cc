@@ -0,0 +1,118 @@
+#define MESSAGE_LEVEL 0
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "tests_kernels.hpp"
+
+/// Execution time of every pool over the workloads of the tests, for every thread count,
+/// with the speedup over SERIAL_POOL.
+/// Usage: pool_bench [--workers=1,2,4] [--pools=SERIAL,WSPDR] [--benchmarks=sorting,matvecp] [--output=results.csv]
+
+using namespace ERT;
+
+namespace
+{
+    // Consumes kernel results so that they are not optimized away
+    std::atomic<size_t> sink = 0;
+
+    struct WORKLOAD
+    {
+        std::vector<RAW_TASK> tasks;
+        std::shared_ptr<void> data; // What the tasks work on
+    };
+
+    struct WORKLOAD_FACTORY
+    {
+        const char *name;
+        WORKLOAD (*make)(bool is_quick);
+    };
+
+    // Tasks of increasing sizes
+    WORKLOAD make_sorting(bool is_quick)
+    {
+        return {TESTS::generate_sorting_tasks(is_quick ? 16 : 100), nullptr};
+    }
+
+    WORKLOAD make_matvecp(bool is_quick)
+    {
+        return {TESTS::generate_matvecp_tasks(is_quick ? 30 : 100), nullptr};
+    }
+
+    // Tasks of decreasing sizes, contending on locks
+    WORKLOAD make_shared_edge(bool is_quick)
+    {
+        struct DATA
+        {
+            std::vector<float> out_pos;
+            std::vector<float> out_acc;
+            std::vector<std::mutex> out_acc_locks;
+            std::vector<float> mass;
+            explicit DATA(size_t n_body) : out_pos(3 * n_body), out_acc(3 * n_body), out_acc_locks(n_body), mass(n_body) {}
+        };
+        auto data = std::make_shared<DATA>(is_quick ? 800 : 4000);
+        std::vector<RAW_TASK> tasks = TESTS::generate_shared_edge_tasks(&data->out_pos, &data->out_acc, &data->out_acc_locks, &data->mass);
+        return {std::move(tasks), std::move(data)};
+    }
+
+    // Many short tasks of similar sizes
+    WORKLOAD make_collatz(bool is_quick)
+    {
+        constexpr size_t shard_size = 150;
+        return {TESTS::generate_n_tasks(is_quick ? 3000 : 30000, [](size_t i)
+                                        { sink += TESTS::collatz_conjecture_kernel(i * shard_size, (i + 1) * shard_size); }),
+                nullptr};
+    }
+
+    const WORKLOAD_FACTORY workload_factories[] = {
+        {"sorting", make_sorting},
+        {"matvecp", make_matvecp},
+        {"shared_edge", make_shared_edge},
+        {"collatz", make_collatz},
+    };
+}
+
+int main(int argc, char **argv)
+{
+    BENCH::OPTIONS options;
+    if (!options.parse(argc, argv))
+    {
+        return 1;
+    }
+
+    BENCH::REPORT report;
+    for (const WORKLOAD_FACTORY &workload_factory : workload_factories)
+    {
+        if (!options.selects_benchmark(workload_factory.name))
+        {
+            continue;
+        }
+        const WORKLOAD workload = workload_factory.make(options.is_quick);
+        for (const BENCH::POOL_FACTORY &pool_factory : BENCH::pool_factories())
+        {
+            if (!options.selects_pool(pool_factory.name))
+            {
+                continue;
+            }
+            for (size_t num_workers : options.workers)
+            {
+                std::unique_ptr<POOL> pool = pool_factory.make(num_workers);
+                pool->start();
+                std::vector<double> samples = BENCH::sample(options.num_warmups, options.num_repetitions, [&pool, &workload]()
+                                                            { pool->execute(workload.tasks); });
+                pool->terminate();
+                report.add({workload_factory.name, pool_factory.name, pool->num_workers(), workload.tasks.size(), BENCH::summarize(std::move(samples))});
+                if (pool_factory.is_serial)
+                {
+                    break; // The same for every thread count
+                }
+            }
+        }
+    }
+    report.compute_speedups();
+    return options.write(report) && options.check_baseline(report) ? 0 : 1;
+}
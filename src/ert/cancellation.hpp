@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/// Cancellation of a session
+
+namespace ERT
+{
+    /// Set by a running task to stop its session early, e.g. once a parallel search found its answer.
+    /// The pools drop the tasks of the session at or past the first cancelled index instead of running them,
+    /// while the tasks already running finish, and may poll is_cancelled() to stop early themselves.
+    /// cancel_from(itask) keeps first match semantics: every task before itask still runs, so the lowest
+    /// index passed is the one a sequential loop would have exited at.
+    class CANCELLATION
+    {
+    public:
+        static constexpr size_t NONE = SIZE_MAX;
+
+        CANCELLATION() = default;
+        CANCELLATION(const CANCELLATION &) = delete;
+        CANCELLATION &operator=(const CANCELLATION &) = delete;
+
+        void cancel() { this->cancel_from(0); }
+        void cancel_from(size_t itask);
+        bool is_cancelled() const { return this->first_cancelled() != NONE; }
+        bool is_cancelled(size_t itask) const { return itask >= this->first_cancelled(); }
+        // The lowest index cancelled from, NONE if not cancelled
+        size_t first_cancelled() const { return this->first_cancelled_.load(std::memory_order_acquire); }
+        void reset() { this->first_cancelled_.store(NONE, std::memory_order_relaxed); }
+
+        // A token never cancelled, for sessions that cannot be
+        static const CANCELLATION &never();
+
+    private:
+        std::atomic<size_t> first_cancelled_ = NONE;
+    };
+}
+
+namespace ERT
+{
+    inline void CANCELLATION::cancel_from(size_t itask)
+    {
+        size_t first_cancelled = this->first_cancelled_.load(std::memory_order_relaxed);
+        while (itask < first_cancelled &&
+               !this->first_cancelled_.compare_exchange_weak(first_cancelled, itask, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    inline const CANCELLATION &CANCELLATION::never()
+    {
+        static const CANCELLATION never;
+        return never;
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "idle.hpp"
+
+/// Completion of a session
+
+namespace ERT
+{
+    /// Counts down the pending units of a session.
+    /// The waiter backs off according to an IDLE_POLICY, and blocks once the
+    /// policy says to park until the last count_down() signals it.
+    /// IDLE_POLICY::spin_forever() gives a pure-spin wait.
+    /// Safe to destroy as soon as wait() returns, e.g. when living on the waiter's stack.
+    class COMPLETION
+    {
+    public:
+        explicit COMPLETION(size_t num_pending) : num_pending_(num_pending), is_done_(num_pending == 0) {}
+
+        void count_down(size_t num_done = 1);
+        bool is_done() const { return this->is_done_.load(); }
+        void wait(const IDLE_POLICY &policy);
+
+    private:
+        std::atomic<size_t> num_pending_;
+        std::atomic<bool> is_done_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+    };
+}
+
+namespace ERT
+{
+    inline void COMPLETION::count_down(size_t num_done)
+    {
+        if (this->num_pending_.fetch_sub(num_done) == num_done)
+        {
+            // Notify under the lock, this COMPLETION may be destroyed right after the lock is released
+            std::lock_guard<std::mutex> lock_guard(this->mutex_);
+            this->is_done_ = true;
+            this->cv_.notify_all();
+        }
+    }
+
+    inline void COMPLETION::wait(const IDLE_POLICY &policy)
+    {
+        BACKOFF backoff(policy);
+        while (!this->is_done_)
+        {
+            if (backoff.pause())
+            {
+                std::unique_lock<std::mutex> unique_lock(this->mutex_);
+                this->cv_.wait(unique_lock, [this]()
+                               { return this->is_done_.load(); });
+                return;
+            }
+        }
+        // Wait for the signaling count_down() to release the lock
+        std::lock_guard<std::mutex> lock_guard(this->mutex_);
+    }
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+
+#include "cancellation.hpp"
+#include "macros.hpp"
+#include "message.hpp"
+#include "pool.hpp"
+#include "task.hpp"
+#include "task_group.hpp"
+#include "trace.hpp"
+#include "wspdr_pool.hpp"
+
+/// Process-wide runtime shared by all parallelized functions, instead of a pool started and torn down per call.
+/// $ERT_NUM_WORKERS overrides the number of workers of the default pool.
+
+namespace ERT
+{
+    /// The pool of type POOL_IF of the process, created and started at the first call, and terminated at exit.
+    /// The process runs a single set of workers, so a call for another type than the last one terminates that pool,
+    /// which must be idle then, and starts the new one in its place; see DEFAULT_POOL_OWNER.
+    /// Only the first call sizes the pools, with $ERT_NUM_WORKERS if set, else num_workers, else the hardware concurrency.
+    /// Host threads may all share it, a session submitted while another one holds the pool is injected, see POOL.
+    template <typename POOL_IF = WSPDR_POOL>
+    POOL_IF &default_pool(size_t num_workers = 0);
+
+    /// Owns the default pools of the process, with a single thread budget: at most one of them is started at a time,
+    /// all of them sized by the first call. A pool switched from is kept, so that references to it never dangle.
+    class DEFAULT_POOL_OWNER
+    {
+    public:
+        static DEFAULT_POOL_OWNER &instance();
+
+        template <typename POOL_IF>
+        POOL_IF &get(size_t num_workers);
+
+    private:
+        DEFAULT_POOL_OWNER() = default;
+        void check_num_workers(size_t num_workers) const; // Warns when it differs from the one of the first call
+
+    private:
+        std::mutex mutex_;
+        std::atomic<POOL *> active_pool_ = nullptr;
+        std::vector<std::unique_ptr<POOL>> pools_; // One per type, terminated but for the active one
+        size_t num_workers_ = 0;                   // Of every pool
+        size_t requested_num_workers_ = 0;         // By the first call
+    };
+
+    /// A session of tasks on a pool shared by the process, blocking until completed.
+    /// From a task already running on a pool, e.g. a parallelized function called by another one or by itself,
+    /// the tasks join the running session instead: spawned to a TASK_GROUP on work stealing pools, and run inline
+    /// otherwise. Nested and recursive calls so stay within the workers, instead of oversubscribing the machine.
+    void execute_shared(POOL &pool, const std::vector<RAW_TASK> &tasks);
+    // Dropping tasks[itask] instead of running it once cancellation.is_cancelled(itask), as POOL::execute()
+    void execute_shared(POOL &pool, const std::vector<RAW_TASK> &tasks, const CANCELLATION &cancellation);
+
+    /// Marks the calling thread as running a session of execute_shared() for the lifetime of the scope
+    class SHARED_SESSION
+    {
+    public:
+        SHARED_SESSION() : previous_(is_running_) { is_running_ = true; }
+        SHARED_SESSION(const SHARED_SESSION &) = delete;
+        SHARED_SESSION &operator=(const SHARED_SESSION &) = delete;
+        ~SHARED_SESSION() { is_running_ = this->previous_; }
+
+        static bool is_running() { return is_running_; }
+
+    private:
+        bool previous_;
+        static inline thread_local bool is_running_ = false;
+    };
+}
+
+namespace ERT
+{
+    template <typename POOL_IF>
+    POOL_IF &default_pool(size_t num_workers)
+    {
+        return DEFAULT_POOL_OWNER::instance().get<POOL_IF>(num_workers);
+    }
+
+    inline DEFAULT_POOL_OWNER &DEFAULT_POOL_OWNER::instance()
+    {
+#if ERT_ENABLE_TRACE
+        TRACER::instance(); // Constructed first, to outlive the pools that dump to it at exit
+#endif
+        static DEFAULT_POOL_OWNER owner;
+        return owner;
+    }
+
+    template <typename POOL_IF>
+    POOL_IF &DEFAULT_POOL_OWNER::get(size_t num_workers)
+    {
+        // The parallelized functions ask for the pool at every call, mostly of the type started already
+        POOL *active_pool = this->active_pool_.load(std::memory_order_acquire);
+        if (active_pool != nullptr && typeid(*active_pool) == typeid(POOL_IF))
+        {
+            this->check_num_workers(num_workers);
+            return static_cast<POOL_IF &>(*active_pool);
+        }
+
+        std::lock_guard<std::mutex> lock_guard(this->mutex_);
+        if (this->num_workers_ == 0)
+        {
+            this->requested_num_workers_ = num_workers;
+            if (const char *num_workers_env = std::getenv("ERT_NUM_WORKERS"))
+            {
+                num_workers = std::strtoul(num_workers_env, nullptr, 10);
+            }
+            if (num_workers == 0)
+            {
+                num_workers = std::max(1u, std::thread::hardware_concurrency());
+            }
+            this->num_workers_ = num_workers;
+        }
+        this->check_num_workers(num_workers);
+
+        auto pool_it = std::find_if(this->pools_.begin(), this->pools_.end(), [](const std::unique_ptr<POOL> &pool)
+                                    { return typeid(*pool) == typeid(POOL_IF); });
+        if (pool_it == this->pools_.end())
+        {
+            this->pools_.emplace_back(std::make_unique<POOL_IF>(this->num_workers_));
+            pool_it = std::prev(this->pools_.end());
+        }
+        POOL *pool = pool_it->get();
+        active_pool = this->active_pool_.load(std::memory_order_relaxed);
+        if (active_pool != pool)
+        {
+            // Switching types from a task, or from a session of execute_shared(), would pull the workers out from under it
+            ASSERT(!WORKER_CONTEXT::current() && WORKER_INDEX::current() == 0 && !SHARED_SESSION::is_running());
+            if (active_pool != nullptr)
+            {
+                active_pool->terminate();
+            }
+            pool->start();
+            this->active_pool_.store(pool, std::memory_order_release);
+        }
+        return static_cast<POOL_IF &>(*pool);
+    }
+
+    inline void DEFAULT_POOL_OWNER::check_num_workers(size_t num_workers) const
+    {
+        if (num_workers != 0 && num_workers != this->requested_num_workers_)
+        {
+            warn("[default_pool] sized by its first call to %lu workers, ignoring the %lu asked for\n", this->num_workers_, num_workers);
+        }
+    }
+
+    inline void execute_shared(POOL &pool, const std::vector<RAW_TASK> &tasks)
+    {
+        execute_shared(pool, tasks, CANCELLATION::never());
+    }
+
+    inline void execute_shared(POOL &pool, const std::vector<RAW_TASK> &tasks, const CANCELLATION &cancellation)
+    {
+        if (tasks.empty())
+        {
+            return;
+        }
+        if (WORKER_CONTEXT::current())
+        {
+            // On a work stealing worker, idle workers steal the nested tasks
+            TASK_GROUP task_group;
+            for (size_t itask = 0; itask < tasks.size(); itask++)
+            {
+                task_group.spawn([task = &tasks[itask], itask, &cancellation]()
+                                 {
+                                     if (!cancellation.is_cancelled(itask))
+                                     {
+                                         (*task)();
+                                     } });
+            }
+            task_group.wait();
+            return;
+        }
+        if (WORKER_INDEX::current() != 0 || SHARED_SESSION::is_running())
+        {
+            // On an executor of a pool without stealing, or on the calling thread of a session
+            for (size_t itask = 0; itask < tasks.size() && !cancellation.is_cancelled(itask); itask++)
+            {
+                tasks[itask]();
+            }
+            return;
+        }
+        SHARED_SESSION shared_session;
+        pool.execute(tasks, cancellation);
+    }
+}
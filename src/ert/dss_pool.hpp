@@ -0,0 +1,509 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "completion.hpp"
+#include "idle.hpp"
+#include "macros.hpp"
+#include "message.hpp"
+#include "pool.hpp"
+#include "task.hpp"
+#include "utils.hpp"
+
+/// Dynamic Self-Scheduling POOL
+/// Workers hand themselves chunks of the session from a shared atomic cursor,
+/// sized by an OpenMP-style DSS_POLICY. Tasks are run in place by index.
+/// The calling thread of execute() joins the session as worker 0,
+/// so a pool of N workers runs N-1 executor threads.
+
+namespace ERT
+{
+    /// How the iterations of a session are cut into chunks, with P workers and R iterations remaining:
+    /// DYNAMIC:   fixed chunks of chunk_size
+    /// GUIDED:    ceil(R / P), no smaller than chunk_size
+    /// FACTORING: batches of P equal chunks of ceil(R / 2P), no smaller than chunk_size
+    /// TRAPEZOID: chunk sizes decreasing linearly from n / 2P down to chunk_size
+    enum class DSS_POLICY
+    {
+        DYNAMIC = 0,
+        GUIDED = 1,
+        FACTORING = 2,
+        TRAPEZOID = 3,
+        DEFAULT = GUIDED
+    };
+
+    class DSS_SESSION;
+    class DSS_WORKER;
+    class DSS_POOL : public POOL
+    {
+    public:
+        explicit DSS_POOL(size_t num_workers, DSS_POLICY policy = DSS_POLICY::DEFAULT, size_t chunk_size = 1, IDLE_POLICY idle_policy = IDLE_POLICY())
+            : POOL(num_workers), policy_(policy), chunk_size_(std::max<size_t>(1, chunk_size)), idle_policy_(idle_policy) {}
+        virtual ~DSS_POOL();
+
+        virtual void start() override;
+        virtual void terminate() override;
+        // A single session of execution, blocking until completed
+        virtual void execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation) override;
+        using POOL::execute;
+        // grain replaces chunk_size for the session
+        virtual void execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body) override;
+        virtual void status() const override;
+
+    protected:
+        virtual void wake_helpers() override;
+
+    private:
+        void run_session(size_t begin, size_t end, size_t chunk_size, const RANGE_BODY &body, const CANCELLATION *cancellation = nullptr);
+
+    private:
+        std::vector<std::unique_ptr<DSS_WORKER>> workers_;
+        std::vector<std::thread> executors_;
+        std::unique_ptr<DSS_SESSION> session_;
+        DSS_POLICY policy_;
+        size_t chunk_size_;
+        IDLE_POLICY idle_policy_;
+    };
+
+    /// The session currently published by the pool, shared by all workers.
+    /// epoch is odd while the caller prepares the next session, and even once it is published.
+    /// A worker registers in num_active before touching the session, so that the caller
+    /// never prepares the next session under a straggler of the previous one.
+    class DSS_SESSION
+    {
+    public:
+        void prepare(size_t begin, size_t end, size_t chunk_size, DSS_POLICY policy, size_t num_workers,
+                     const RANGE_BODY *body, COMPLETION *completion, const CANCELLATION *cancellation);
+        void run_chunks(STATS_RECORDER &stats); // Take and run chunks until none is left
+        void drop_chunks(size_t chunk_begin, size_t chunk_end); // Once cancelled, the chunk taken and all untaken ones
+
+        bool try_join(uint64_t epoch); // False if the session is not the one of epoch anymore
+        void leave();
+        void wait_stragglers(const IDLE_POLICY &wait_policy); // Until every worker that joined has left
+
+    private:
+        size_t chunk_begin(size_t ichunk) const;
+
+    private:
+        friend class DSS_POOL;
+        friend class DSS_WORKER;
+
+        std::atomic<uint64_t> epoch_ = 0;
+        std::atomic<size_t> num_active_ = 0;
+        std::atomic<size_t> next_chunk_ = 0;
+        size_t begin_ = 0;
+        size_t end_ = 0;
+        size_t chunk_size_ = 1;
+        size_t num_chunks_ = 0;
+        std::vector<size_t> chunk_begins_; // Precomputed chunk boundaries, empty for DSS_POLICY::DYNAMIC
+        const RANGE_BODY *body_ = nullptr;
+        COMPLETION *completion_ = nullptr;
+        const CANCELLATION *cancellation_ = nullptr; // nullptr for sessions that cannot be cancelled
+        PARKER parker_;           // Workers waiting for the next session
+        PARKER stragglers_parker_; // The caller waiting for the workers to leave the previous session
+    };
+
+    class DSS_WORKER
+    {
+    public:
+        void init(int worker_id, DSS_SESSION *session, INJECTION_QUEUE *injection_queue, STATS_RECORDER *stats, IDLE_POLICY idle_policy = IDLE_POLICY())
+        {
+            this->worker_id_ = worker_id;
+            this->session_ = session;
+            this->injection_queue_ = injection_queue;
+            this->stats_ = stats;
+            this->idle_policy_ = idle_policy;
+        }
+        void run(); // Running on an executor thread until terminated
+        void terminate();
+        void status() const;
+
+    private:
+        bool should_wake_up() const;
+
+    private:
+        DSS_SESSION *session_ = nullptr;
+        INJECTION_QUEUE *injection_queue_ = nullptr; // Helped between the sessions of the pool
+        STATS_RECORDER *stats_ = nullptr;
+        IDLE_POLICY idle_policy_;
+        std::thread::id thread_id_;
+        int worker_id_ = -1;
+        uint64_t seen_epoch_ = 0;
+        std::atomic<bool> terminate_notify_ = false;
+    };
+}
+
+namespace ERT
+{
+    inline DSS_POOL::~DSS_POOL()
+    {
+        this->terminate();
+    }
+
+    inline void DSS_POOL::start()
+    {
+        ASSERT(this->workers_.empty());
+        ASSERT(this->executors_.empty());
+
+        // The calling thread of execute() acts as worker 0
+        const size_t n_executors = this->num_workers() - 1;
+        this->session_ = std::make_unique<DSS_SESSION>();
+
+        // Construct and initialize workers
+        this->workers_.reserve(n_executors);
+        for (size_t worker_id = 1; worker_id <= n_executors; worker_id++)
+        {
+            this->workers_.emplace_back(std::make_unique<DSS_WORKER>());
+            this->workers_.back()->init(worker_id, this->session_.get(), &this->injection_queue(), &this->stats_recorder(worker_id), this->idle_policy_);
+        }
+
+        // Initialize executors
+        this->executors_.reserve(n_executors);
+        for (const auto &worker : this->workers_)
+        {
+            this->executors_.emplace_back(&DSS_WORKER::run, worker.get());
+        }
+        this->place_executors(this->executors_);
+    }
+
+    inline void DSS_POOL::terminate()
+    {
+        for (const auto &worker : this->workers_)
+        {
+            worker->terminate();
+        }
+        if (this->session_)
+        {
+            this->session_->parker_.unpark_all();
+        }
+        for (auto &executor : this->executors_)
+        {
+            executor.join();
+        }
+        this->workers_.clear();
+        this->executors_.clear();
+        this->session_.reset();
+    }
+
+    inline void DSS_POOL::execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation)
+    {
+        ASSERT(num_tasks > 0);
+
+        // Run the tasks in place, by index, dropping the rest of the chunk once cancelled
+        RANGE_BODY body = [tasks, &cancellation](size_t chunk_begin, size_t chunk_end)
+        {
+            for (size_t itask = chunk_begin; itask < chunk_end && !cancellation.is_cancelled(itask); itask++)
+            {
+                tasks[itask]();
+            }
+        };
+        this->run_session(0, num_tasks, this->chunk_size_, body, &cancellation);
+    }
+
+    inline void DSS_POOL::execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body)
+    {
+        ASSERT(begin < end);
+
+        this->run_session(begin, end, std::max<size_t>(1, grain), body);
+    }
+
+    inline void DSS_POOL::run_session(size_t begin, size_t end, size_t chunk_size, const RANGE_BODY &body, const CANCELLATION *cancellation)
+    {
+        // Workers and executors must be launched already
+        ASSERT(this->session_);
+        ASSERT(this->workers_.size() + 1 == this->num_workers());
+        ASSERT(this->executors_.size() == this->workers_.size());
+
+        // The workers share a single published session, the sessions submitted meanwhile are injected
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
+        {
+            this->inject(begin, end, chunk_size, body);
+            return;
+        }
+        WORKER_INDEX::SCOPE worker_index(0); // The calling thread joins as worker 0
+        COMPLETION completion(end - begin);
+        DSS_SESSION &session = *this->session_;
+
+        // Close the previous session, and wait for its stragglers to leave
+        session.epoch_++;
+        session.wait_stragglers(this->wait_policy());
+        session.prepare(begin, end, chunk_size, this->policy_, this->num_workers(), &body, &completion, cancellation);
+        session.epoch_++;
+        session.parker_.unpark_all();
+        info("[DSS_POOL] session published @thread=%s, num_iterations=%lu, num_chunks=%lu\n",
+             to_string(std::this_thread::get_id()).c_str(), end - begin, session.num_chunks_);
+
+        // The calling thread joins as worker 0
+        STATS_RECORDER &stats = this->stats_recorder(0);
+        stats.count_session();
+        ERT_TRACE(SESSION_BEGIN, -1, session.num_chunks_);
+        stats.begin_perf_counting();
+        session.run_chunks(stats);
+        const STATS_RECORDER::CLOCK::time_point wait_start = stats.now();
+        ERT_TRACE(IDLE_BEGIN);
+        completion.wait(this->wait_policy());
+        ERT_TRACE(IDLE_END);
+        stats.add_idle_time(wait_start);
+        stats.end_perf_counting();
+        ERT_TRACE(SESSION_END);
+    }
+
+    inline void DSS_POOL::wake_helpers()
+    {
+        if (this->session_)
+        {
+            this->session_->parker_.unpark_all();
+        }
+    }
+
+    inline void DSS_POOL::status() const
+    {
+        warn("===================\n");
+        warn("[DSS_POOL] workers=%lu, executors=%lu, policy=%d, chunk_size=%lu]\n",
+             this->workers_.size() + 1, this->executors_.size(), static_cast<int>(this->policy_), this->chunk_size_);
+        for (const auto &worker : this->workers_)
+        {
+            worker->status();
+        }
+        warn("===================\n");
+    }
+
+    inline void DSS_SESSION::prepare(size_t begin, size_t end, size_t chunk_size, DSS_POLICY policy, size_t num_workers,
+                                     const RANGE_BODY *body, COMPLETION *completion, const CANCELLATION *cancellation)
+    {
+        const size_t num_iterations = end - begin;
+        this->begin_ = begin;
+        this->end_ = end;
+        this->chunk_size_ = chunk_size;
+        this->body_ = body;
+        this->completion_ = completion;
+        this->cancellation_ = cancellation;
+        this->next_chunk_ = 0;
+        this->chunk_begins_.clear();
+
+        if (policy == DSS_POLICY::DYNAMIC)
+        {
+            this->num_chunks_ = (num_iterations - 1) / chunk_size + 1;
+            return;
+        }
+
+        // Precompute the boundaries of the shrinking chunks
+        size_t remaining = num_iterations;
+        size_t cursor = begin;
+        auto add_chunk = [this, &remaining, &cursor](size_t size)
+        {
+            size = std::min(std::max(size, this->chunk_size_), remaining);
+            this->chunk_begins_.push_back(cursor);
+            cursor += size;
+            remaining -= size;
+        };
+        if (policy == DSS_POLICY::GUIDED)
+        {
+            while (remaining > 0)
+            {
+                add_chunk((remaining - 1) / num_workers + 1);
+            }
+        }
+        else if (policy == DSS_POLICY::FACTORING)
+        {
+            while (remaining > 0)
+            {
+                const size_t batch_chunk_size = (remaining - 1) / (2 * num_workers) + 1;
+                for (size_t ichunk = 0; ichunk < num_workers && remaining > 0; ichunk++)
+                {
+                    add_chunk(batch_chunk_size);
+                }
+            }
+        }
+        else if (policy == DSS_POLICY::TRAPEZOID)
+        {
+            // Tzen and Ni: first chunk f = n / 2P, last chunk l = chunk_size, N = ceil(2n / (f + l)) chunks
+            const double first = std::max<double>(static_cast<double>(num_iterations) / (2 * num_workers), chunk_size);
+            const double last = chunk_size;
+            const double num_planned_chunks = std::max(1.0, std::ceil(2 * num_iterations / (first + last)));
+            const double decrement = num_planned_chunks > 1 ? (first - last) / (num_planned_chunks - 1) : 0;
+            for (size_t ichunk = 0; remaining > 0; ichunk++)
+            {
+                add_chunk(static_cast<size_t>(std::max(last, first - ichunk * decrement)));
+            }
+        }
+        else
+        {
+            ASSERT(false && "Unsupported DSS_POLICY");
+        }
+        this->num_chunks_ = this->chunk_begins_.size();
+        this->chunk_begins_.push_back(end);
+    }
+
+    inline void DSS_SESSION::run_chunks(STATS_RECORDER &stats)
+    {
+        while (true)
+        {
+            const size_t ichunk = this->next_chunk_.fetch_add(1);
+            if (ichunk >= this->num_chunks_)
+            {
+                return;
+            }
+            const size_t chunk_begin = this->chunk_begin(ichunk);
+            const size_t chunk_end = this->chunk_begin(ichunk + 1);
+            if (this->cancellation_ && this->cancellation_->is_cancelled(chunk_begin))
+            {
+                this->drop_chunks(chunk_begin, chunk_end);
+                return;
+            }
+            ERT_TRACE(TASK_BEGIN, -1, chunk_end - chunk_begin);
+            stats.run_busy([this, chunk_begin, chunk_end]()
+                           { (*this->body_)(chunk_begin, chunk_end); });
+            ERT_TRACE(TASK_END);
+            stats.count_tasks();
+            this->completion_->count_down(chunk_end - chunk_begin);
+        }
+    }
+
+    inline void DSS_SESSION::drop_chunks(size_t chunk_begin, size_t chunk_end)
+    {
+        // Chunks are taken in increasing order, so every untaken one is past the cancelled index as well.
+        // Closing the cursor hands them all to this worker, while the chunks taken already are counted by their takers.
+        const size_t first_untaken_chunk = this->next_chunk_.exchange(this->num_chunks_);
+        size_t num_dropped = chunk_end - chunk_begin;
+        if (first_untaken_chunk < this->num_chunks_)
+        {
+            num_dropped += this->end_ - this->chunk_begin(first_untaken_chunk);
+        }
+        this->completion_->count_down(num_dropped);
+    }
+
+    inline size_t DSS_SESSION::chunk_begin(size_t ichunk) const
+    {
+        if (this->chunk_begins_.empty())
+        {
+            return std::min(this->end_, this->begin_ + ichunk * this->chunk_size_);
+        }
+        return this->chunk_begins_[ichunk];
+    }
+
+    inline bool DSS_SESSION::try_join(uint64_t epoch)
+    {
+        this->num_active_++;
+        if (this->epoch_.load() != epoch)
+        {
+            this->leave();
+            return false;
+        }
+        return true;
+    }
+
+    inline void DSS_SESSION::leave()
+    {
+        if (--this->num_active_ == 0)
+        {
+            this->stragglers_parker_.unpark_all();
+        }
+    }
+
+    inline void DSS_SESSION::wait_stragglers(const IDLE_POLICY &wait_policy)
+    {
+        BACKOFF backoff(wait_policy);
+        while (this->num_active_.load() != 0)
+        {
+            if (backoff.pause())
+            {
+                // The last worker to leave unparks after its decrement, which this re-check sees otherwise
+                const uint64_t ticket = this->stragglers_parker_.prepare_park();
+                if (this->num_active_.load() == 0)
+                {
+                    this->stragglers_parker_.cancel_park();
+                }
+                else
+                {
+                    this->stragglers_parker_.park(ticket);
+                }
+            }
+        }
+    }
+
+    inline void DSS_WORKER::run()
+    {
+        WORKER_INDEX::SCOPE worker_index(this->worker_id_);
+        this->stats_->begin_perf_counting();
+        this->thread_id_ = std::this_thread::get_id();
+        info("[Worker %d] running @thread=%s\n", this->worker_id_, to_string(this->thread_id_).c_str());
+        BACKOFF backoff(this->idle_policy_);
+        // Worker event loop
+        while (true)
+        {
+            const uint64_t epoch = this->session_->epoch_.load();
+            // An even epoch not seen yet is a newly published session
+            if (epoch % 2 == 0 && epoch != this->seen_epoch_)
+            {
+                if (this->session_->try_join(epoch))
+                {
+                    this->stats_->count_session();
+                    this->session_->run_chunks(*this->stats_);
+                    this->session_->leave();
+                }
+                this->seen_epoch_ = epoch;
+                backoff.reset();
+                continue;
+            }
+            if (this->injection_queue_->try_help())
+            {
+                backoff.reset();
+                continue;
+            }
+            if (this->terminate_notify_)
+            {
+                this->terminate_notify_ = false; // Reset
+                info("[Worker %d] terminated\n", this->worker_id_);
+                this->stats_->end_perf_counting(true);
+                return;
+            }
+            if (backoff.pause())
+            {
+                const uint64_t ticket = this->session_->parker_.prepare_park();
+                if (this->should_wake_up())
+                {
+                    this->session_->parker_.cancel_park();
+                }
+                else
+                {
+                    debug("[Worker %d] parking\n", this->worker_id_);
+                    const STATS_RECORDER::CLOCK::time_point park_start = this->stats_->now();
+                    ERT_TRACE(IDLE_BEGIN);
+                    this->session_->parker_.park(ticket);
+                    ERT_TRACE(IDLE_END);
+                    this->stats_->add_idle_time(park_start);
+                    debug("[Worker %d] unparked\n", this->worker_id_);
+                }
+            }
+        }
+    }
+
+    inline void DSS_WORKER::terminate()
+    {
+        debug("[Worker %d] terminate\n", this->worker_id_);
+
+        this->terminate_notify_ = true;
+    }
+
+    inline void DSS_WORKER::status() const
+    {
+        std::string threda_id_str = to_string(this->thread_id_);
+        warn("[Worker %d] @thread=%s, sessions_joined=%lu, seen_epoch=%lu, terminate_notify=%s\n",
+             this->worker_id_, threda_id_str.c_str(), this->stats_->snapshot().num_sessions, this->seen_epoch_,
+             bool_to_cstr(this->terminate_notify_));
+    }
+
+    inline bool DSS_WORKER::should_wake_up() const
+    {
+        const uint64_t epoch = this->session_->epoch_.load();
+        return this->terminate_notify_ || (epoch % 2 == 0 && epoch != this->seen_epoch_) || !this->injection_queue_->empty();
+    }
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "macros.hpp"
+
+/// Move-only type-erased callable with inline storage
+
+namespace ERT
+{
+    template <typename SIGNATURE, size_t INLINE_SIZE = 56>
+    class FUNCTION;
+
+    /// A std::function replacement for the task hot path.
+    /// 1. Move-only, so a callable is never copied behind the caller's back.
+    /// 2. A callable of up to INLINE_SIZE bytes, that is nothrow move constructible,
+    ///    is stored inline; a larger one falls back to a single heap allocation.
+    /// 3. With the default INLINE_SIZE, a FUNCTION fits in a single cache line.
+    /// Like std::function, operator() is const but invokes the target as non-const.
+    template <typename R, typename... ARGS, size_t INLINE_SIZE>
+    class FUNCTION<R(ARGS...), INLINE_SIZE>
+    {
+    public:
+        FUNCTION() = default;
+        FUNCTION(std::nullptr_t) {}
+        template <typename F,
+                  typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, FUNCTION> &&
+                                              std::is_invocable_r_v<R, std::decay_t<F> &, ARGS...>>>
+        FUNCTION(F &&f);
+        FUNCTION(FUNCTION &&other) noexcept;
+        FUNCTION &operator=(FUNCTION &&other) noexcept;
+        FUNCTION(const FUNCTION &) = delete;
+        FUNCTION &operator=(const FUNCTION &) = delete;
+        ~FUNCTION() { this->reset(); }
+
+        R operator()(ARGS... args) const;
+        explicit operator bool() const { return this->ops_ != nullptr; }
+        void reset();
+
+        template <typename F>
+        static constexpr bool is_inline()
+        {
+            return sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(std::max_align_t) &&
+                   std::is_nothrow_move_constructible_v<F>;
+        }
+
+    private:
+        struct OPS
+        {
+            R (*invoke)(void *storage, ARGS &&...args);
+            void (*move)(void *dst, void *src) noexcept; // Move constructs into dst, and destroys src
+            void (*destroy)(void *storage) noexcept;
+        };
+
+        template <typename F>
+        static const OPS *inline_ops();
+        template <typename F>
+        static const OPS *heap_ops();
+
+    private:
+        alignas(std::max_align_t) mutable unsigned char storage_[INLINE_SIZE];
+        const OPS *ops_ = nullptr;
+    };
+}
+
+namespace ERT
+{
+    template <typename R, typename... ARGS, size_t INLINE_SIZE>
+    template <typename F, typename>
+    FUNCTION<R(ARGS...), INLINE_SIZE>::FUNCTION(F &&f)
+    {
+        using TARGET = std::decay_t<F>;
+        if constexpr (is_inline<TARGET>())
+        {
+            ::new (static_cast<void *>(this->storage_)) TARGET(std::forward<F>(f));
+            this->ops_ = inline_ops<TARGET>();
+        }
+        else
+        {
+            ::new (static_cast<void *>(this->storage_)) TARGET *(new TARGET(std::forward<F>(f)));
+            this->ops_ = heap_ops<TARGET>();
+        }
+    }
+
+    template <typename R, typename... ARGS, size_t INLINE_SIZE>
+    FUNCTION<R(ARGS...), INLINE_SIZE>::FUNCTION(FUNCTION &&other) noexcept
+    {
+        if (other.ops_)
+        {
+            other.ops_->move(this->storage_, other.storage_);
+            this->ops_ = std::exchange(other.ops_, nullptr);
+        }
+    }
+
+    template <typename R, typename... ARGS, size_t INLINE_SIZE>
+    FUNCTION<R(ARGS...), INLINE_SIZE> &FUNCTION<R(ARGS...), INLINE_SIZE>::operator=(FUNCTION &&other) noexcept
+    {
+        if (this != &other)
+        {
+            this->reset();
+            if (other.ops_)
+            {
+                other.ops_->move(this->storage_, other.storage_);
+                this->ops_ = std::exchange(other.ops_, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    template <typename R, typename... ARGS, size_t INLINE_SIZE>
+    R FUNCTION<R(ARGS...), INLINE_SIZE>::operator()(ARGS... args) const
+    {
+        ASSERT(this->ops_);
+        return this->ops_->invoke(this->storage_, std::forward<ARGS>(args)...);
+    }
+
+    template <typename R, typename... ARGS, size_t INLINE_SIZE>
+    void FUNCTION<R(ARGS...), INLINE_SIZE>::reset()
+    {
+        if (this->ops_)
+        {
+            this->ops_->destroy(this->storage_);
+            this->ops_ = nullptr;
+        }
+    }
+
+    template <typename R, typename... ARGS, size_t INLINE_SIZE>
+    template <typename F>
+    auto FUNCTION<R(ARGS...), INLINE_SIZE>::inline_ops() -> const OPS *
+    {
+        static constexpr OPS ops{
+            [](void *storage, ARGS &&...args) -> R
+            {
+                return (*std::launder(static_cast<F *>(storage)))(std::forward<ARGS>(args)...);
+            },
+            [](void *dst, void *src) noexcept
+            {
+                F *src_f = std::launder(static_cast<F *>(src));
+                ::new (dst) F(std::move(*src_f));
+                src_f->~F();
+            },
+            [](void *storage) noexcept
+            {
+                std::launder(static_cast<F *>(storage))->~F();
+            }};
+        return &ops;
+    }
+
+    template <typename R, typename... ARGS, size_t INLINE_SIZE>
+    template <typename F>
+    auto FUNCTION<R(ARGS...), INLINE_SIZE>::heap_ops() -> const OPS *
+    {
+        static constexpr OPS ops{
+            [](void *storage, ARGS &&...args) -> R
+            {
+                return (**std::launder(static_cast<F **>(storage)))(std::forward<ARGS>(args)...);
+            },
+            [](void *dst, void *src) noexcept
+            {
+                ::new (dst) F *(*std::launder(static_cast<F **>(src)));
+            },
+            [](void *storage) noexcept
+            {
+                delete *std::launder(static_cast<F **>(storage));
+            }};
+        return &ops;
+    }
+}
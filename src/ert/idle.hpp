@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+/// Idle backoff for workers that fail to acquire tasks
+
+namespace ERT
+{
+    /// A worker that keeps failing to acquire tasks backs off in 3 phases:
+    /// 1. Spin: retry right away for num_spins failed attempts
+    /// 2. Yield: give up the time slice for num_yields failed attempts
+    /// 3. Park: block on a PARKER until woken up
+    struct IDLE_POLICY
+    {
+        static constexpr size_t INFINITE = std::numeric_limits<size_t>::max();
+
+        size_t num_spins = 1 << 10;
+        size_t num_yields = 1 << 6;
+
+        // Never park, the behaviour of a pure busy-waiting worker
+        static IDLE_POLICY spin_forever() { return IDLE_POLICY{INFINITE, 0}; }
+    };
+
+    /// Counts the consecutive failed attempts of a single worker
+    class BACKOFF
+    {
+    public:
+        explicit BACKOFF(const IDLE_POLICY &policy) : policy_(policy) {}
+
+        // Back off for one failed attempt; true if the caller should park now
+        bool pause();
+        void reset() { this->num_attempts_ = 0; }
+
+    private:
+        IDLE_POLICY policy_;
+        size_t num_attempts_ = 0;
+    };
+
+    /// Parking lot shared by all workers of a pool.
+    /// Parking is two-phased to avoid lost wake-ups:
+    ///     ticket = prepare_park();
+    ///     if (wake-up condition already holds) cancel_park(); else park(ticket);
+    /// A waker must publish its wake-up condition before calling unpark_all().
+    class PARKER
+    {
+    public:
+        [[nodiscard]] uint64_t prepare_park();
+        void cancel_park();
+        void park(uint64_t ticket); // Blocking until unpark_all() after prepare_park()
+        void unpark_all();          // Cheap when nobody is parking
+
+        size_t num_parking() const { return this->num_parking_.load(); }
+
+    private:
+        std::atomic<uint64_t> epoch_ = 0;
+        std::atomic<size_t> num_parking_ = 0;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+    };
+}
+
+namespace ERT
+{
+    inline bool BACKOFF::pause()
+    {
+        if (this->num_attempts_ < this->policy_.num_spins)
+        {
+            this->num_attempts_++;
+            return false;
+        }
+        // Spin budget exhausted, num_attempts_ counts yields from now on
+        if (this->num_attempts_ - this->policy_.num_spins < this->policy_.num_yields)
+        {
+            this->num_attempts_++;
+            std::this_thread::yield();
+            return false;
+        }
+        return true;
+    }
+
+    inline uint64_t PARKER::prepare_park()
+    {
+        this->num_parking_++;
+        return this->epoch_.load();
+    }
+
+    inline void PARKER::cancel_park()
+    {
+        this->num_parking_--;
+    }
+
+    inline void PARKER::park(uint64_t ticket)
+    {
+        {
+            std::unique_lock<std::mutex> unique_lock(this->mutex_);
+            this->cv_.wait(unique_lock, [this, ticket]()
+                           { return this->epoch_.load() != ticket; });
+        }
+        this->num_parking_--;
+    }
+
+    inline void PARKER::unpark_all()
+    {
+        if (this->num_parking_.load() == 0)
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock_guard(this->mutex_);
+            this->epoch_++;
+        }
+        this->cv_.notify_all();
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "completion.hpp"
+#include "idle.hpp"
+#include "macros.hpp"
+#include "task.hpp"
+
+/// Sessions injected into a busy pool
+
+namespace ERT
+{
+    /// A session submitted to a pool while another session holds its workers, by another host thread,
+    /// or nested in one of the tasks of the pool. Its iterations [begin, end) are claimed in chunks of grain
+    /// from an atomic cursor, by its calling thread and by the idle workers of the pool,
+    /// and it completes on its own COMPLETION, whatever the session holding the pool is doing.
+    class INJECTED_SESSION
+    {
+    public:
+        INJECTED_SESSION(size_t begin, size_t end, size_t grain, const RANGE_BODY &body)
+            : begin_(begin), end_(end), grain_(std::max<size_t>(1, grain)),
+              num_chunks_((end - begin - 1) / grain_ + 1), body_(body), completion_(num_chunks_)
+        {
+            ASSERT(begin < end);
+        }
+        INJECTED_SESSION(const INJECTED_SESSION &) = delete;
+        INJECTED_SESSION &operator=(const INJECTED_SESSION &) = delete;
+
+    private:
+        friend class INJECTION_QUEUE;
+
+        std::atomic<size_t> next_chunk_ = 0;
+        std::atomic<size_t> num_helpers_ = 0; // Workers of the pool that may still touch the session
+        size_t begin_;
+        size_t end_;
+        size_t grain_;
+        size_t num_chunks_;
+        const RANGE_BODY &body_;
+        COMPLETION completion_; // Counting down chunks
+    };
+
+    /// The injected sessions of a pool that still have chunks to take, served in turn by its idle workers.
+    /// A calling thread runs the chunks of its session as well, so it completes even if no worker is ever idle,
+    /// e.g. when it is nested in a task while every worker is busy, instead of waiting for the pool.
+    class INJECTION_QUEUE
+    {
+    public:
+        // Queues session, then wake() gets the idle workers to call try_help(). Blocking until completed.
+        template <typename WAKE>
+        void run(INJECTED_SESSION &session, const IDLE_POLICY &wait_policy, const WAKE &wake);
+        bool try_help(); // Runs a chunk of a queued session, false if there was none
+        bool empty() const { return this->num_sessions_.load() == 0; }
+
+    private:
+        bool try_run_chunk(INJECTED_SESSION &session); // False once every chunk of session is taken
+        void retire(INJECTED_SESSION &session);        // No chunk left to take, so not worth helping
+
+    private:
+        std::mutex mutex_;
+        std::vector<INJECTED_SESSION *> sessions_;
+        std::atomic<size_t> num_sessions_ = 0;
+        size_t turn_ = 0; // Round robin across the sessions
+    };
+}
+
+namespace ERT
+{
+    template <typename WAKE>
+    void INJECTION_QUEUE::run(INJECTED_SESSION &session, const IDLE_POLICY &wait_policy, const WAKE &wake)
+    {
+        {
+            std::lock_guard<std::mutex> lock_guard(this->mutex_);
+            this->sessions_.push_back(&session);
+            this->num_sessions_++;
+        }
+        wake();
+
+        while (this->try_run_chunk(session))
+        {
+        }
+        session.completion_.wait(wait_policy);
+
+        // The last chunk retired the session before counting down, so no worker takes it anymore,
+        // while the ones that did may not have left it yet
+        while (session.num_helpers_.load() != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    inline bool INJECTION_QUEUE::try_help()
+    {
+        if (this->empty())
+        {
+            return false;
+        }
+        INJECTED_SESSION *session = nullptr;
+        {
+            std::lock_guard<std::mutex> lock_guard(this->mutex_);
+            if (this->sessions_.empty())
+            {
+                return false;
+            }
+            session = this->sessions_[this->turn_++ % this->sessions_.size()];
+            session->num_helpers_++;
+        }
+        const bool is_run = this->try_run_chunk(*session);
+        session->num_helpers_--;
+        return is_run;
+    }
+
+    inline bool INJECTION_QUEUE::try_run_chunk(INJECTED_SESSION &session)
+    {
+        const size_t ichunk = session.next_chunk_.fetch_add(1);
+        if (ichunk >= session.num_chunks_)
+        {
+            return false;
+        }
+        if (ichunk + 1 == session.num_chunks_)
+        {
+            this->retire(session);
+        }
+        const size_t chunk_begin = session.begin_ + ichunk * session.grain_;
+        session.body_(chunk_begin, std::min(session.end_, chunk_begin + session.grain_));
+        session.completion_.count_down();
+        return true;
+    }
+
+    inline void INJECTION_QUEUE::retire(INJECTED_SESSION &session)
+    {
+        std::lock_guard<std::mutex> lock_guard(this->mutex_);
+        const auto session_it = std::find(this->sessions_.begin(), this->sessions_.end(), &session);
+        ASSERT(session_it != this->sessions_.end());
+        this->sessions_.erase(session_it);
+        this->num_sessions_--;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <algorithm>
+
+#include "macros.hpp"
+#include "pool.hpp"
+
+/// Range-based parallel loop
+
+namespace ERT
+{
+    /// Run body(i) for every i in [begin, end) on pool, blocking until completed.
+    /// Iterations are handed out as index ranges of about grain iterations, so no per-iteration
+    /// task is ever materialized. A grain of 0 picks one for about 8 chunks per worker.
+    template <typename BODY>
+    void parallel_for(POOL &pool, size_t begin, size_t end, size_t grain, BODY body)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+        if (grain == 0)
+        {
+            grain = std::max<size_t>(1, (end - begin) / (8 * pool.num_workers()));
+        }
+        pool.execute_range(begin, end, grain, [&body](size_t chunk_begin, size_t chunk_end)
+                           {
+                               for (size_t i = chunk_begin; i < chunk_end; i++)
+                               {
+                                   body(i);
+                               } });
+    }
+}
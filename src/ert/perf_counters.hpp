@@ -0,0 +1,199 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+/// Hardware and scheduler counters of a thread, through perf_event_open(2).
+/// Counters the kernel refuses, e.g. hardware events in a VM or under perf_event_paranoid, are left unavailable.
+
+namespace ERT
+{
+    enum class PERF_EVENT
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        LLC_MISSES,
+        CONTEXT_SWITCHES,
+        CPU_MIGRATIONS,
+    };
+    constexpr size_t NUM_PERF_EVENTS = 5;
+    constexpr const char *PERF_EVENT_NAMES[NUM_PERF_EVENTS] = {"cycles", "instructions", "llc_misses", "context_switches", "cpu_migrations"};
+
+    struct PERF_COUNTS
+    {
+        std::array<uint64_t, NUM_PERF_EVENTS> values{};
+        uint32_t available = 0; // A bit per PERF_EVENT that could be counted
+
+        uint64_t operator[](PERF_EVENT event) const { return this->values[static_cast<size_t>(event)]; }
+        bool is_available(PERF_EVENT event) const { return this->available & (1u << static_cast<size_t>(event)); }
+        // Instructions per cycle, low when memory-bound; 0 when unavailable
+        double ipc() const;
+        // LLC misses per thousand instructions; 0 when unavailable
+        double llc_mpki() const;
+
+        PERF_COUNTS &operator+=(const PERF_COUNTS &other);
+        PERF_COUNTS &operator-=(const PERF_COUNTS &other);
+    };
+
+    /// The counters of one thread, readable from any thread
+    class PERF_COUNTERS
+    {
+    public:
+        PERF_COUNTERS() { this->fds_.fill(-1); }
+        PERF_COUNTERS(const PERF_COUNTERS &) = delete;
+        PERF_COUNTERS &operator=(const PERF_COUNTERS &) = delete;
+        ~PERF_COUNTERS() { this->close(); }
+
+        // Opens the counters of thread tid, the calling thread by default, counting right away.
+        // False if no counter could be opened.
+        bool open(pid_t tid = 0);
+        void close();
+        bool is_open() const { return this->tid_ != NO_THREAD; }
+        pid_t tid() const { return this->tid_; }
+        void enable();
+        void disable();
+        PERF_COUNTS read() const; // Scaled up when the kernel multiplexed the hardware counters
+
+        static pid_t current_tid() { return static_cast<pid_t>(syscall(SYS_gettid)); }
+
+    private:
+        static constexpr pid_t NO_THREAD = -1;
+        std::array<int, NUM_PERF_EVENTS> fds_;
+        pid_t tid_ = NO_THREAD;
+    };
+}
+
+namespace ERT
+{
+    inline double PERF_COUNTS::ipc() const
+    {
+        if (!this->is_available(PERF_EVENT::CYCLES) || !this->is_available(PERF_EVENT::INSTRUCTIONS) || (*this)[PERF_EVENT::CYCLES] == 0)
+        {
+            return 0;
+        }
+        return static_cast<double>((*this)[PERF_EVENT::INSTRUCTIONS]) / (*this)[PERF_EVENT::CYCLES];
+    }
+
+    inline double PERF_COUNTS::llc_mpki() const
+    {
+        if (!this->is_available(PERF_EVENT::LLC_MISSES) || !this->is_available(PERF_EVENT::INSTRUCTIONS) || (*this)[PERF_EVENT::INSTRUCTIONS] == 0)
+        {
+            return 0;
+        }
+        return 1e3 * (*this)[PERF_EVENT::LLC_MISSES] / (*this)[PERF_EVENT::INSTRUCTIONS];
+    }
+
+    inline PERF_COUNTS &PERF_COUNTS::operator+=(const PERF_COUNTS &other)
+    {
+        for (size_t ievent = 0; ievent < NUM_PERF_EVENTS; ievent++)
+        {
+            this->values[ievent] += other.values[ievent];
+        }
+        this->available |= other.available;
+        return *this;
+    }
+
+    inline PERF_COUNTS &PERF_COUNTS::operator-=(const PERF_COUNTS &other)
+    {
+        for (size_t ievent = 0; ievent < NUM_PERF_EVENTS; ievent++)
+        {
+            this->values[ievent] -= other.values[ievent];
+        }
+        return *this;
+    }
+
+    inline bool PERF_COUNTERS::open(pid_t tid)
+    {
+        this->close();
+        // In the order of PERF_EVENT
+        static constexpr std::array<std::pair<uint32_t, uint64_t>, NUM_PERF_EVENTS> events = {{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}, // Usually of the last level cache
+            {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+            {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+        }};
+        bool is_any_open = false;
+        for (size_t ievent = 0; ievent < NUM_PERF_EVENTS; ievent++)
+        {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[ievent].first;
+            attr.config = events[ievent].second;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            // Hardware events of user space only, as allowed with perf_event_paranoid up to 2.
+            // The software events are kernel events by nature.
+            attr.exclude_kernel = attr.type == PERF_TYPE_HARDWARE;
+            attr.exclude_hv = 1;
+            this->fds_[ievent] = static_cast<int>(syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0));
+            is_any_open = is_any_open || this->fds_[ievent] >= 0;
+        }
+        if (is_any_open)
+        {
+            this->tid_ = tid == 0 ? current_tid() : tid;
+        }
+        return is_any_open;
+    }
+
+    inline void PERF_COUNTERS::close()
+    {
+        for (int &fd : this->fds_)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        this->tid_ = NO_THREAD;
+    }
+
+    inline void PERF_COUNTERS::enable()
+    {
+        for (int fd : this->fds_)
+        {
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    inline void PERF_COUNTERS::disable()
+    {
+        for (int fd : this->fds_)
+        {
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+    }
+
+    inline PERF_COUNTS PERF_COUNTERS::read() const
+    {
+        PERF_COUNTS counts;
+        for (size_t ievent = 0; ievent < NUM_PERF_EVENTS; ievent++)
+        {
+            // value, time enabled, time running
+            uint64_t buffer[3];
+            if (this->fds_[ievent] < 0 || ::read(this->fds_[ievent], buffer, sizeof(buffer)) != sizeof(buffer))
+            {
+                continue;
+            }
+            counts.available |= 1u << ievent;
+            counts.values[ievent] = buffer[2] > 0 && buffer[2] < buffer[1]
+                                        ? static_cast<uint64_t>(static_cast<double>(buffer[0]) * buffer[1] / buffer[2])
+                                        : buffer[0];
+        }
+        return counts;
+    }
+}
@@ -1,24 +1,238 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "affinity.hpp"
+#include "cancellation.hpp"
+#include "idle.hpp"
+#include "injection.hpp"
+#include "macros.hpp"
+#include "stats.hpp"
 #include "task.hpp"
+#include "task_graph.hpp"
+#include "trace.hpp"
 
 namespace ERT
 {
+    /// Index of the worker running the calling thread, in [0, num_workers) of its pool.
+    /// The calling thread of a session is worker 0, as is any thread outside of a pool.
+    class WORKER_INDEX
+    {
+    public:
+        static size_t current() { return current_; }
+
+        /// Binds the calling thread to a worker index for the lifetime of the scope
+        class SCOPE
+        {
+        public:
+            explicit SCOPE(size_t worker_index) : previous_(current_)
+            {
+                current_ = worker_index;
+                ERT_TRACE_NAME_THREAD(worker_index);
+            }
+            SCOPE(const SCOPE &) = delete;
+            SCOPE &operator=(const SCOPE &) = delete;
+            ~SCOPE() { current_ = this->previous_; }
+
+        private:
+            size_t previous_;
+        };
+
+    private:
+        static inline thread_local size_t current_ = 0;
+    };
+
+    /// Sessions may be submitted from several host threads at once, or nested in a task of the pool.
+    /// The first one holds the workers of the pool until it completed, the others are injected meanwhile,
+    /// each run by its own calling thread along with the idle workers, see INJECTION_QUEUE.
     class POOL
     {
     public:
-        explicit POOL(size_t num_workers) : num_workers_(num_workers) {}
-        virtual ~POOL() = default;
+        explicit POOL(size_t num_workers) : num_workers_(num_workers), stats_recorders_(std::make_unique<STATS_RECORDER[]>(num_workers)) {}
+        virtual ~POOL() { ERT_TRACE_DUMP(); } // The executors of the derived pool are joined already
 
         virtual void start() {}
         virtual void terminate() {}
-        // A single session of execution, blocking until completed
-        virtual void execute(const std::vector<RAW_TASK> &tasks) = 0;
+        // A single session of execution over tasks[0, num_tasks), blocking until completed.
+        // Tasks are run in place, and must outlive the session.
+        void execute(const RAW_TASK *tasks, size_t num_tasks) { this->execute(tasks, num_tasks, CANCELLATION::never()); }
+        void execute(const std::vector<RAW_TASK> &tasks) { this->execute(tasks.data(), tasks.size()); }
+        // A single session as above, that drops tasks[itask] instead of running it once cancellation.is_cancelled(itask),
+        // e.g. set by one of the tasks. Still blocks until every task is either completed or dropped.
+        virtual void execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation) = 0;
+        void execute(const std::vector<RAW_TASK> &tasks, const CANCELLATION &cancellation) { this->execute(tasks.data(), tasks.size(), cancellation); }
+        // A single session over the iterations [begin, end), run by body in chunks of about grain iterations,
+        // blocking until completed. Falls back to one task per chunk for pools without native range support.
+        virtual void execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body);
+        // A single session over the tasks of graph, blocking until all of them completed.
+        // Falls back to a session per level of the graph for pools that cannot release tasks dynamically.
+        virtual void execute_graph(const TASK_GRAPH &graph);
         virtual void status() const {}
 
         size_t num_workers() const { return this->num_workers_; }
 
+        // How execute() waits for the session to complete, IDLE_POLICY::spin_forever() for pure spinning
+        void set_wait_policy(IDLE_POLICY wait_policy) { this->wait_policy_ = wait_policy; }
+        const IDLE_POLICY &wait_policy() const { return this->wait_policy_; }
+
+        // Where start() pins the executor threads, PLACEMENT::none() by default
+        void set_placement(PLACEMENT placement) { this->placement_ = std::move(placement); }
+        const PLACEMENT &placement() const { return this->placement_; }
+
+        // Scheduling statistics of the workers since the pool was created, for a session when taking the difference
+        // of the statistics before and after it. Only the sessions that held the pool are counted, not the injected ones. Busy, idle and steal wait times need set_stats_timing(true).
+        POOL_STATS stats() const;
+        void set_stats_timing(bool is_timing);
+        // Hardware and scheduler counters of the workers in stats(), where perf_event_open(2) allows.
+        // Executors open their counters when started, so before start().
+        void set_perf_counting(bool is_perf_counting);
+
+    protected:
+        /// Held by a session from before its calling thread binds as worker 0 until it completed.
+        /// A session that does not get it is injected instead of waiting for the pool.
+        class SESSION_HOLD
+        {
+        public:
+            explicit SESSION_HOLD(POOL &pool) : pool_(pool), is_held_(!pool.is_held_.exchange(true, std::memory_order_acquire)) {}
+            SESSION_HOLD(const SESSION_HOLD &) = delete;
+            SESSION_HOLD &operator=(const SESSION_HOLD &) = delete;
+            ~SESSION_HOLD()
+            {
+                if (this->is_held_)
+                {
+                    this->pool_.is_held_.store(false, std::memory_order_release);
+                }
+            }
+
+            bool is_held() const { return this->is_held_; }
+
+        private:
+            POOL &pool_;
+            bool is_held_;
+        };
+
+        // A session while another one holds the pool, blocking until completed
+        void inject(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation);
+        void inject(size_t begin, size_t end, size_t grain, const RANGE_BODY &body);
+        // Gets the idle workers to call injection_queue().try_help() once a session is injected
+        virtual void wake_helpers() {}
+        INJECTION_QUEUE &injection_queue() { return this->injection_queue_; }
+
+        STATS_RECORDER &stats_recorder(size_t worker_id) const { return this->stats_recorders_[worker_id]; }
+        bool is_placed() const { return this->placement_.kind != PLACEMENT_KIND::NONE; }
+        // The CPU of each worker under the placement, empty if the workers are not placed.
+        // The topology is only read when they are.
+        std::vector<int> worker_cpus() const { return this->is_placed() ? this->worker_cpus(TOPOLOGY::current()) : std::vector<int>(); }
+        std::vector<int> worker_cpus(const TOPOLOGY &topology) const { return this->placement_.assign(topology, this->num_workers()); }
+        // Pins executors[i], running worker i + 1, on worker_cpus[i + 1], or on its CPU of the placement.
+        // The calling thread of execute() is worker 0 and is left as it is, the CPU of worker 0 is left to it.
+        void place_executors(std::vector<std::thread> &executors) const { this->place_executors(executors, this->worker_cpus()); }
+        void place_executors(std::vector<std::thread> &executors, const std::vector<int> &worker_cpus) const;
+
     private:
         size_t num_workers_;
+        IDLE_POLICY wait_policy_;
+        PLACEMENT placement_;
+        std::unique_ptr<STATS_RECORDER[]> stats_recorders_;
+        std::atomic<bool> is_held_ = false;
+        INJECTION_QUEUE injection_queue_;
     };
 }
+
+namespace ERT
+{
+    inline void POOL::execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body)
+    {
+        std::vector<RAW_TASK> tasks;
+        tasks.reserve((end - begin - 1) / grain + 1);
+        for (size_t chunk_begin = begin; chunk_begin < end; chunk_begin += grain)
+        {
+            const size_t chunk_end = std::min(end, chunk_begin + grain);
+            tasks.emplace_back([&body, chunk_begin, chunk_end]()
+                               { body(chunk_begin, chunk_end); });
+        }
+        this->execute(tasks.data(), tasks.size());
+    }
+
+    inline void POOL::inject(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation)
+    {
+        // A task per chunk, so that the workers helping spread over the tasks
+        const RANGE_BODY body = [tasks, &cancellation](size_t chunk_begin, size_t chunk_end)
+        {
+            for (size_t itask = chunk_begin; itask < chunk_end && !cancellation.is_cancelled(itask); itask++)
+            {
+                tasks[itask]();
+            }
+        };
+        this->inject(0, num_tasks, 1, body);
+    }
+
+    inline void POOL::inject(size_t begin, size_t end, size_t grain, const RANGE_BODY &body)
+    {
+        INJECTED_SESSION session(begin, end, grain, body);
+        this->injection_queue_.run(session, this->wait_policy(), [this]()
+                                   { this->wake_helpers(); });
+    }
+
+    inline POOL_STATS POOL::stats() const
+    {
+        POOL_STATS stats;
+        stats.workers.reserve(this->num_workers());
+        for (size_t worker_id = 0; worker_id < this->num_workers(); worker_id++)
+        {
+            stats.workers.push_back(this->stats_recorders_[worker_id].snapshot());
+        }
+        return stats;
+    }
+
+    inline void POOL::set_stats_timing(bool is_timing)
+    {
+        for (size_t worker_id = 0; worker_id < this->num_workers(); worker_id++)
+        {
+            this->stats_recorders_[worker_id].set_timing(is_timing);
+        }
+    }
+
+    inline void POOL::set_perf_counting(bool is_perf_counting)
+    {
+        for (size_t worker_id = 0; worker_id < this->num_workers(); worker_id++)
+        {
+            this->stats_recorders_[worker_id].set_perf_counting(is_perf_counting);
+        }
+    }
+
+    inline void POOL::place_executors(std::vector<std::thread> &executors, const std::vector<int> &worker_cpus) const
+    {
+        if (worker_cpus.empty())
+        {
+            return;
+        }
+        for (size_t iexecutor = 0; iexecutor < executors.size(); iexecutor++)
+        {
+            pin_thread(executors[iexecutor], worker_cpus[iexecutor + 1]);
+        }
+    }
+
+    inline void POOL::execute_graph(const TASK_GRAPH &graph)
+    {
+        ASSERT(graph.size() > 0);
+
+        // Level-synchronous, with a barrier between the levels
+        std::vector<RAW_TASK> tasks;
+        for (const auto &level : graph.levels())
+        {
+            tasks.clear();
+            tasks.reserve(level.size());
+            for (TASK_GRAPH::NODE node : level)
+            {
+                tasks.emplace_back([task = &graph.task(node)]()
+                                   { (*task)(); });
+            }
+            this->execute(tasks.data(), tasks.size());
+        }
+    }
+}
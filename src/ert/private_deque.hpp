@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "arena.hpp"
+#include "macros.hpp"
+#include "task.hpp"
+
+/// Private task deque of a worker, never accessed cross thread
+
+namespace ERT
+{
+    /// Tasks in transit between workers, drawn from the ARENA of the worker sending them
+    using TASK_BUFFER = std::vector<TASK, ARENA_ALLOCATOR<TASK>>;
+
+    /// The owner works at the back; surplus tasks leave from the front to other workers.
+    /// Backed by a ring buffer that keeps its capacity, so a steady state session does not allocate.
+    class PRIVATE_DEQUE
+    {
+    public:
+        void push_back(TASK task);
+        TASK pop_back(); // Only when not empty (with assert)
+        // Up to num_tasks tasks from the front
+        TASK_BUFFER take_front(size_t num_tasks, ARENA &arena);
+
+        bool empty() const { return this->size_ == 0; }
+        size_t size() const { return this->size_; }
+
+    private:
+        TASK &at(size_t index) { return this->tasks_[(this->front_ + index) & (this->tasks_.size() - 1)]; }
+        void grow();
+
+    private:
+        std::vector<TASK> tasks_ = std::vector<TASK>(64); // Capacity is a power of 2
+        size_t front_ = 0;
+        size_t size_ = 0;
+    };
+}
+
+namespace ERT
+{
+    inline void PRIVATE_DEQUE::push_back(TASK task)
+    {
+        if (this->size_ == this->tasks_.size())
+        {
+            this->grow();
+        }
+        this->at(this->size_) = std::move(task);
+        this->size_++;
+    }
+
+    inline TASK PRIVATE_DEQUE::pop_back()
+    {
+        ASSERT(this->size_ > 0);
+        this->size_--;
+        return std::move(this->at(this->size_));
+    }
+
+    inline TASK_BUFFER PRIVATE_DEQUE::take_front(size_t num_tasks, ARENA &arena)
+    {
+        TASK_BUFFER tasks{ARENA_ALLOCATOR<TASK>(&arena)};
+        tasks.reserve(std::min(num_tasks, this->size_));
+        for (size_t itask = 0; itask < num_tasks && this->size_ > 0; itask++)
+        {
+            tasks.emplace_back(std::move(this->at(0)));
+            this->front_ = (this->front_ + 1) & (this->tasks_.size() - 1);
+            this->size_--;
+        }
+        return tasks;
+    }
+
+    inline void PRIVATE_DEQUE::grow()
+    {
+        std::vector<TASK> tasks(2 * this->tasks_.size());
+        for (size_t itask = 0; itask < this->size_; itask++)
+        {
+            tasks[itask] = std::move(this->at(itask));
+        }
+        this->tasks_ = std::move(tasks);
+        this->front_ = 0;
+    }
+}
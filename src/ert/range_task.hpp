@@ -0,0 +1,30 @@
+#pragma once
+
+#include "completion.hpp"
+#include "task.hpp"
+
+/// Range tasks for work stealing pools
+
+namespace ERT
+{
+    /// A TASK running body over the iterations [begin, end).
+    /// Ranges larger than grain are split lazily: the task hands both halves back to its worker,
+    /// the right half first, so that the owner continues with the left half while
+    /// thieves take the larger right halves from the other end of the deque.
+    /// Counts down completion by the number of iterations run.
+    inline TASK to_range_task(size_t begin, size_t end, size_t grain, const RANGE_BODY &body, COMPLETION &completion)
+    {
+        return [begin, end, grain, &body, &completion](WORKER_PROXY &worker_proxy)
+        {
+            if (end - begin <= grain)
+            {
+                body(begin, end);
+                completion.count_down(end - begin);
+                return;
+            }
+            const size_t middle = begin + (end - begin) / 2;
+            worker_proxy.tasks.emplace_back(to_range_task(middle, end, grain, body, completion));
+            worker_proxy.tasks.emplace_back(to_range_task(begin, middle, grain, body, completion));
+        };
+    }
+}
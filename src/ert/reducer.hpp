@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "macros.hpp"
+#include "pool.hpp"
+#include "worker_local.hpp"
+
+/// Reductions over the tasks of a session, without shared atomics or locks
+
+namespace ERT
+{
+    template <typename T>
+    struct MIN_OP
+    {
+        T operator()(const T &a, const T &b) const { return std::min(a, b); }
+        static T identity() { return std::numeric_limits<T>::max(); }
+    };
+
+    template <typename T>
+    struct MAX_OP
+    {
+        T operator()(const T &a, const T &b) const { return std::max(a, b); }
+        static T identity() { return std::numeric_limits<T>::lowest(); }
+    };
+
+    /// The default identity of a reducer over OP, OP::identity() if declared and T() otherwise
+    template <typename T, typename OP, typename = void>
+    struct REDUCER_IDENTITY
+    {
+        static T value() { return T(); }
+    };
+
+    template <typename T, typename OP>
+    struct REDUCER_IDENTITY<T, OP, std::void_t<decltype(OP::identity())>>
+    {
+        static T value() { return OP::identity(); }
+    };
+
+    /// Each worker folds into its own partial result with op, starting from identity,
+    /// and result() combines the partial results once the session is done.
+    /// op must be associative; the partial results are combined in worker order.
+    template <typename T, typename OP = std::plus<T>>
+    class REDUCER
+    {
+    public:
+        explicit REDUCER(const POOL &pool, const T &identity = REDUCER_IDENTITY<T, OP>::value(), OP op = OP())
+            : partials_(pool, identity), identity_(identity), op_(std::move(op)) {}
+
+        void update(const T &value);
+        T &local() { return this->partials_.local(); }
+        T result() const;
+        void reset();
+
+    private:
+        WORKER_LOCAL<T> partials_;
+        T identity_;
+        OP op_;
+    };
+
+    /// A REDUCER over num_elements elements at once, e.g. for scattered accumulation into an array.
+    /// Each worker holds a private copy of the array.
+    template <typename T, typename OP = std::plus<T>>
+    class ARRAY_REDUCER
+    {
+    public:
+        ARRAY_REDUCER(const POOL &pool, size_t num_elements, const T &identity = REDUCER_IDENTITY<T, OP>::value(), OP op = OP())
+            : partials_(pool, std::vector<T>(num_elements, identity)), identity_(identity), op_(std::move(op)) {}
+
+        void update(size_t index, const T &value);
+        T *local() { return this->partials_.local().data(); }
+        size_t size() const { return this->partials_[0].size(); }
+        // Combines element-wise into out[0, size())
+        void combine_into(T *out) const;
+        std::vector<T> result() const;
+        void reset();
+
+    private:
+        WORKER_LOCAL<std::vector<T>> partials_;
+        T identity_;
+        OP op_;
+    };
+
+    template <typename T>
+    using MIN_REDUCER = REDUCER<T, MIN_OP<T>>;
+    template <typename T>
+    using MAX_REDUCER = REDUCER<T, MAX_OP<T>>;
+}
+
+namespace ERT
+{
+    template <typename T, typename OP>
+    void REDUCER<T, OP>::update(const T &value)
+    {
+        T &partial = this->partials_.local();
+        partial = this->op_(partial, value);
+    }
+
+    template <typename T, typename OP>
+    T REDUCER<T, OP>::result() const
+    {
+        T result = this->identity_;
+        this->partials_.for_each([this, &result](const T &partial)
+                                 { result = this->op_(result, partial); });
+        return result;
+    }
+
+    template <typename T, typename OP>
+    void REDUCER<T, OP>::reset()
+    {
+        this->partials_.for_each([this](T &partial)
+                                 { partial = this->identity_; });
+    }
+
+    template <typename T, typename OP>
+    void ARRAY_REDUCER<T, OP>::update(size_t index, const T &value)
+    {
+        std::vector<T> &partial = this->partials_.local();
+        ASSERT(index < partial.size());
+        partial[index] = this->op_(partial[index], value);
+    }
+
+    template <typename T, typename OP>
+    void ARRAY_REDUCER<T, OP>::combine_into(T *out) const
+    {
+        this->partials_.for_each([this, out](const std::vector<T> &partial)
+                                 {
+                                     for (size_t i = 0; i < partial.size(); i++)
+                                     {
+                                         out[i] = this->op_(out[i], partial[i]);
+                                     } });
+    }
+
+    template <typename T, typename OP>
+    std::vector<T> ARRAY_REDUCER<T, OP>::result() const
+    {
+        std::vector<T> result(this->size(), this->identity_);
+        this->combine_into(result.data());
+        return result;
+    }
+
+    template <typename T, typename OP>
+    void ARRAY_REDUCER<T, OP>::reset()
+    {
+        this->partials_.for_each([this](std::vector<T> &partial)
+                                 { std::fill(partial.begin(), partial.end(), this->identity_); });
+    }
+}
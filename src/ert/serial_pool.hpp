@@ -17,19 +17,96 @@ namespace ERT
         explicit SERIAL_POOL(size_t num_workers) : POOL(1) {}
 
         // A single session of execution, blocking until completed
-        virtual void execute(const std::vector<RAW_TASK> &tasks) override;
+        virtual void execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation) override;
+        using POOL::execute;
+        virtual void execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body) override;
+        virtual void execute_graph(const TASK_GRAPH &graph) override;
     };
 }
 
 namespace ERT
 {
-    inline void SERIAL_POOL::execute(const std::vector<RAW_TASK> &tasks)
+    inline void SERIAL_POOL::execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation)
     {
-        ASSERT(!tasks.empty());
+        ASSERT(num_tasks > 0);
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
+        {
+            // Nested in one of its tasks, or from another host thread, run on the calling thread as well
+            this->inject(tasks, num_tasks, cancellation);
+            return;
+        }
+        WORKER_INDEX::SCOPE worker_index(0);
+        STATS_RECORDER &stats = this->stats_recorder(0);
+        stats.count_session();
+        ERT_TRACE(SESSION_BEGIN, -1, num_tasks);
+        stats.begin_perf_counting();
+
+        // In order, the tasks past a cancelled one are all cancelled as well
+        size_t num_tasks_run = 0;
+        stats.run_busy([tasks, num_tasks, &cancellation, &num_tasks_run]()
+                       {
+                           for (; num_tasks_run < num_tasks && !cancellation.is_cancelled(num_tasks_run); num_tasks_run++)
+                           {
+                               ERT_TRACE(TASK_BEGIN);
+                               tasks[num_tasks_run]();
+                               ERT_TRACE(TASK_END);
+                           } });
+        stats.count_tasks(num_tasks_run);
+        stats.end_perf_counting();
+        ERT_TRACE(SESSION_END);
+    }
+
+    inline void SERIAL_POOL::execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body)
+    {
+        ASSERT(begin < end);
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
+        {
+            this->inject(begin, end, end - begin, body);
+            return;
+        }
+        WORKER_INDEX::SCOPE worker_index(0);
+        STATS_RECORDER &stats = this->stats_recorder(0);
+        stats.count_session();
+        ERT_TRACE(SESSION_BEGIN, -1, 1);
+        stats.begin_perf_counting();
+
+        ERT_TRACE(TASK_BEGIN);
+        stats.run_busy([&]()
+                       { body(begin, end); });
+        ERT_TRACE(TASK_END);
+        stats.count_tasks();
+        stats.end_perf_counting();
+        ERT_TRACE(SESSION_END);
+    }
 
-        for (const auto &task : tasks)
+    inline void SERIAL_POOL::execute_graph(const TASK_GRAPH &graph)
+    {
+        ASSERT(graph.size() > 0);
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
         {
-            task();
+            POOL::execute_graph(graph); // Injecting level by level
+            return;
         }
+        WORKER_INDEX::SCOPE worker_index(0);
+        STATS_RECORDER &stats = this->stats_recorder(0);
+        stats.count_session();
+        ERT_TRACE(SESSION_BEGIN, -1, graph.size());
+        stats.begin_perf_counting();
+
+        // The order of addition respects every dependency
+        stats.run_busy([&graph]()
+                       {
+                           for (TASK_GRAPH::NODE node = 0; node < graph.size(); node++)
+                           {
+                               ERT_TRACE(TASK_BEGIN);
+                               graph.task(node)();
+                               ERT_TRACE(TASK_END);
+                           } });
+        stats.count_tasks(graph.size());
+        stats.end_perf_counting();
+        ERT_TRACE(SESSION_END);
     }
 }
\ No newline at end of file
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "perf_counters.hpp"
+
+/// Scheduling statistics of the workers of a pool
+
+namespace ERT
+{
+    /// Counters of a single worker, cumulated over the sessions since the pool was created.
+    /// Times are in seconds, and only collected with POOL::set_stats_timing(true).
+    struct WORKER_STATS
+    {
+        size_t num_tasks = 0;          // Tasks, or chunks of a range, executed
+        size_t num_steal_attempts = 0; // Steal requests sent, or idle advertisements for sender initiated pools
+        size_t num_steals = 0;         // Attempts that brought back tasks
+        size_t num_tasks_given = 0;    // Tasks handed over to other workers
+        size_t num_sessions = 0;       // Sessions the worker took part in
+        double busy_time = 0;          // Running tasks
+        double idle_time = 0;          // Parked, or blocked on the completion of a session
+        double steal_wait_time = 0;    // Waiting for the response to a steal request
+        PERF_COUNTS perf;              // Only collected with POOL::set_perf_counting(true)
+
+        WORKER_STATS &operator+=(const WORKER_STATS &other);
+        WORKER_STATS &operator-=(const WORKER_STATS &other);
+    };
+
+    /// Statistics of all the workers of a pool, worker 0 being the calling thread of execute().
+    /// The difference of two snapshots gives the statistics of the sessions in between.
+    struct POOL_STATS
+    {
+        std::vector<WORKER_STATS> workers;
+
+        WORKER_STATS total() const;
+        // Max over mean busy time of the workers, 1 when perfectly balanced, 0 without timing
+        double imbalance() const;
+        POOL_STATS operator-(const POOL_STATS &before) const;
+
+        std::string to_json() const;
+        std::string to_csv() const; // A header line, then a line per worker
+    };
+
+    /// Where a worker records its statistics.
+    /// Only written by the thread running the worker, so a counter update is a plain load and store,
+    /// and read by any thread through snapshot().
+    class STATS_RECORDER
+    {
+    public:
+        using CLOCK = std::chrono::steady_clock;
+
+        void count_tasks(size_t n = 1) { add(this->num_tasks_, n); }
+        void count_steal_attempt(bool is_successful);
+        void count_tasks_given(size_t n) { add(this->num_tasks_given_, n); }
+        void count_session() { add(this->num_sessions_, size_t(1)); }
+        // Counts the session the first time the worker takes part in it, by the session clock of the pool
+        void join_session(uint64_t session);
+
+        void set_timing(bool is_timing) { this->is_timing_.store(is_timing, std::memory_order_relaxed); }
+        bool is_timing() const { return this->is_timing_.load(std::memory_order_relaxed); }
+        // Runs f, adding its duration to the busy time when timing.
+        // Nested calls, e.g. tasks run while waiting on a TASK_GROUP, are counted once.
+        template <typename F>
+        void run_busy(F &&f);
+        // Start of an interval to add to a time with add_*_time(), only meaningful when timing
+        CLOCK::time_point now() const { return this->is_timing() ? CLOCK::now() : CLOCK::time_point(); }
+        void add_idle_time(CLOCK::time_point since) { this->add_time(this->idle_time_, since); }
+        void add_steal_wait_time(CLOCK::time_point since) { this->add_time(this->steal_wait_time_, since); }
+
+        void set_perf_counting(bool is_perf_counting) { this->is_perf_counting_.store(is_perf_counting, std::memory_order_relaxed); }
+        bool is_perf_counting() const { return this->is_perf_counting_.load(std::memory_order_relaxed); }
+        // The calling thread starts counting into this worker, opening its perf counters the first time
+        void begin_perf_counting();
+        // Pauses the counting, or when the thread exits, folds its counts into the worker and closes its counters
+        void end_perf_counting(bool is_thread_exiting = false);
+
+        WORKER_STATS snapshot() const;
+
+    private:
+        template <typename T>
+        static void add(std::atomic<T> &counter, T n) { counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+        void add_time(std::atomic<double> &time, CLOCK::time_point since);
+
+    private:
+        std::atomic<size_t> num_tasks_ = 0;
+        std::atomic<size_t> num_steal_attempts_ = 0;
+        std::atomic<size_t> num_steals_ = 0;
+        std::atomic<size_t> num_tasks_given_ = 0;
+        std::atomic<size_t> num_sessions_ = 0;
+        std::atomic<double> busy_time_ = 0;
+        std::atomic<double> idle_time_ = 0;
+        std::atomic<double> steal_wait_time_ = 0;
+        std::atomic<bool> is_timing_ = false;
+        int busy_depth_ = 0;
+        uint64_t last_session_ = 0;
+        std::atomic<bool> is_perf_counting_ = false;
+        mutable std::mutex perf_mutex_; // The counters are also read by snapshot()
+        PERF_COUNTERS perf_counters_;
+        PERF_COUNTS perf_counts_; // Of the threads that counted into this worker before
+    };
+}
+
+namespace ERT
+{
+    inline WORKER_STATS &WORKER_STATS::operator+=(const WORKER_STATS &other)
+    {
+        this->num_tasks += other.num_tasks;
+        this->num_steal_attempts += other.num_steal_attempts;
+        this->num_steals += other.num_steals;
+        this->num_tasks_given += other.num_tasks_given;
+        this->num_sessions += other.num_sessions;
+        this->busy_time += other.busy_time;
+        this->idle_time += other.idle_time;
+        this->steal_wait_time += other.steal_wait_time;
+        this->perf += other.perf;
+        return *this;
+    }
+
+    inline WORKER_STATS &WORKER_STATS::operator-=(const WORKER_STATS &other)
+    {
+        this->num_tasks -= other.num_tasks;
+        this->num_steal_attempts -= other.num_steal_attempts;
+        this->num_steals -= other.num_steals;
+        this->num_tasks_given -= other.num_tasks_given;
+        this->num_sessions -= other.num_sessions;
+        this->busy_time -= other.busy_time;
+        this->idle_time -= other.idle_time;
+        this->steal_wait_time -= other.steal_wait_time;
+        this->perf -= other.perf;
+        return *this;
+    }
+
+    inline WORKER_STATS POOL_STATS::total() const
+    {
+        WORKER_STATS total;
+        for (const auto &worker : this->workers)
+        {
+            total += worker;
+        }
+        return total;
+    }
+
+    inline double POOL_STATS::imbalance() const
+    {
+        if (this->workers.empty())
+        {
+            return 0;
+        }
+        const double mean_busy_time = this->total().busy_time / this->workers.size();
+        if (mean_busy_time <= 0)
+        {
+            return 0;
+        }
+        const double max_busy_time = std::max_element(this->workers.begin(), this->workers.end(), [](const WORKER_STATS &a, const WORKER_STATS &b)
+                                                      { return a.busy_time < b.busy_time; })
+                                         ->busy_time;
+        return max_busy_time / mean_busy_time;
+    }
+
+    inline POOL_STATS POOL_STATS::operator-(const POOL_STATS &before) const
+    {
+        POOL_STATS delta = *this;
+        for (size_t worker_id = 0; worker_id < std::min(delta.workers.size(), before.workers.size()); worker_id++)
+        {
+            delta.workers[worker_id] -= before.workers[worker_id];
+        }
+        return delta;
+    }
+
+    inline std::string POOL_STATS::to_json() const
+    {
+        char buffer[512];
+        std::string json = "{\"imbalance\": ";
+        snprintf(buffer, sizeof(buffer), "%f", this->imbalance());
+        json += buffer;
+        json += ", \"workers\": [";
+        for (size_t worker_id = 0; worker_id < this->workers.size(); worker_id++)
+        {
+            const WORKER_STATS &worker = this->workers[worker_id];
+            snprintf(buffer, sizeof(buffer),
+                     "%s{\"worker\": %lu, \"tasks\": %lu, \"steal_attempts\": %lu, \"steals\": %lu, \"tasks_given\": %lu, \"sessions\": %lu, "
+                     "\"busy_time\": %f, \"idle_time\": %f, \"steal_wait_time\": %f",
+                     worker_id == 0 ? "" : ", ", worker_id, worker.num_tasks, worker.num_steal_attempts, worker.num_steals, worker.num_tasks_given,
+                     worker.num_sessions, worker.busy_time, worker.idle_time, worker.steal_wait_time);
+            json += buffer;
+            for (size_t ievent = 0; ievent < NUM_PERF_EVENTS; ievent++)
+            {
+                json += std::string(", \"") + PERF_EVENT_NAMES[ievent] + "\": ";
+                json += worker.perf.is_available(static_cast<PERF_EVENT>(ievent)) ? std::to_string(worker.perf.values[ievent]) : "null";
+            }
+            json += "}";
+        }
+        json += "]}";
+        return json;
+    }
+
+    inline std::string POOL_STATS::to_csv() const
+    {
+        char buffer[256];
+        std::string csv = "worker,tasks,steal_attempts,steals,tasks_given,sessions,busy_time,idle_time,steal_wait_time";
+        for (const char *perf_event_name : PERF_EVENT_NAMES)
+        {
+            csv += std::string(",") + perf_event_name;
+        }
+        csv += "\n";
+        for (size_t worker_id = 0; worker_id < this->workers.size(); worker_id++)
+        {
+            const WORKER_STATS &worker = this->workers[worker_id];
+            snprintf(buffer, sizeof(buffer), "%lu,%lu,%lu,%lu,%lu,%lu,%f,%f,%f",
+                     worker_id, worker.num_tasks, worker.num_steal_attempts, worker.num_steals, worker.num_tasks_given,
+                     worker.num_sessions, worker.busy_time, worker.idle_time, worker.steal_wait_time);
+            csv += buffer;
+            // Empty when unavailable
+            for (size_t ievent = 0; ievent < NUM_PERF_EVENTS; ievent++)
+            {
+                csv += ",";
+                csv += worker.perf.is_available(static_cast<PERF_EVENT>(ievent)) ? std::to_string(worker.perf.values[ievent]) : "";
+            }
+            csv += "\n";
+        }
+        return csv;
+    }
+
+    inline void STATS_RECORDER::count_steal_attempt(bool is_successful)
+    {
+        add(this->num_steal_attempts_, size_t(1));
+        if (is_successful)
+        {
+            add(this->num_steals_, size_t(1));
+        }
+    }
+
+    inline void STATS_RECORDER::join_session(uint64_t session)
+    {
+        if (session != this->last_session_)
+        {
+            this->last_session_ = session;
+            this->count_session();
+        }
+    }
+
+    template <typename F>
+    void STATS_RECORDER::run_busy(F &&f)
+    {
+        if (this->busy_depth_ > 0 || !this->is_timing())
+        {
+            f();
+            return;
+        }
+        const CLOCK::time_point start_time = CLOCK::now();
+        this->busy_depth_++;
+        f();
+        this->busy_depth_--;
+        this->add_time(this->busy_time_, start_time);
+    }
+
+    inline void STATS_RECORDER::add_time(std::atomic<double> &time, CLOCK::time_point since)
+    {
+        if (this->is_timing() && since != CLOCK::time_point())
+        {
+            add(time, std::chrono::duration<double>(CLOCK::now() - since).count());
+        }
+    }
+
+    inline void STATS_RECORDER::begin_perf_counting()
+    {
+        if (!this->is_perf_counting())
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock_guard(this->perf_mutex_);
+        if (this->perf_counters_.is_open() && this->perf_counters_.tid() == PERF_COUNTERS::current_tid())
+        {
+            this->perf_counters_.enable();
+            return;
+        }
+        // Another thread takes over the worker, e.g. a new calling thread of execute()
+        if (this->perf_counters_.is_open())
+        {
+            this->perf_counts_ += this->perf_counters_.read();
+        }
+        this->perf_counters_.open();
+    }
+
+    inline void STATS_RECORDER::end_perf_counting(bool is_thread_exiting)
+    {
+        std::lock_guard<std::mutex> lock_guard(this->perf_mutex_);
+        if (!this->perf_counters_.is_open())
+        {
+            return;
+        }
+        if (is_thread_exiting)
+        {
+            this->perf_counts_ += this->perf_counters_.read();
+            this->perf_counters_.close();
+        }
+        else
+        {
+            this->perf_counters_.disable();
+        }
+    }
+
+    inline WORKER_STATS STATS_RECORDER::snapshot() const
+    {
+        WORKER_STATS stats;
+        {
+            std::lock_guard<std::mutex> lock_guard(this->perf_mutex_);
+            stats.perf = this->perf_counts_;
+            if (this->perf_counters_.is_open())
+            {
+                stats.perf += this->perf_counters_.read();
+            }
+        }
+        stats.num_tasks = this->num_tasks_.load(std::memory_order_relaxed);
+        stats.num_steal_attempts = this->num_steal_attempts_.load(std::memory_order_relaxed);
+        stats.num_steals = this->num_steals_.load(std::memory_order_relaxed);
+        stats.num_tasks_given = this->num_tasks_given_.load(std::memory_order_relaxed);
+        stats.num_sessions = this->num_sessions_.load(std::memory_order_relaxed);
+        stats.busy_time = this->busy_time_.load(std::memory_order_relaxed);
+        stats.idle_time = this->idle_time_.load(std::memory_order_relaxed);
+        stats.steal_wait_time = this->steal_wait_time_.load(std::memory_order_relaxed);
+        return stats;
+    }
+}
@@ -3,34 +3,95 @@
 #include <algorithm>
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <thread>
 #include <vector>
 
+#include "completion.hpp"
 #include "macros.hpp"
 #include "pool.hpp"
 
 /// Statically and Uniformly Assigned Private POOL
+/// The calling thread of execute() takes the first share of the session,
+/// so a pool of N workers runs N-1 executor threads.
+/// Shares are fixed by a SUAP_PARTITION before the session starts, the workers never communicate.
 
 namespace ERT
 {
+    /// How the n tasks, or iterations, of a session are statically assigned to P workers:
+    /// BLOCK:        a contiguous share of ceil(n / P) per worker
+    /// CYCLIC:       index i to worker i % P
+    /// BLOCK_CYCLIC: chunks of chunk_size, chunk c to worker c % P
+    /// WEIGHTED:     contiguous shares of about equal total cost, by the non-negative cost function of the pool,
+    ///               as BLOCK if every cost is 0
+    enum class SUAP_PARTITION
+    {
+        BLOCK = 0,
+        CYCLIC = 1,
+        BLOCK_CYCLIC = 2,
+        WEIGHTED = 3,
+        DEFAULT = BLOCK
+    };
+
+    /// The chunks [begin + k * stride, begin + k * stride + chunk_size) within [begin, end) that a worker runs, in order
+    struct SUAP_SHARE
+    {
+        size_t begin = 0;
+        size_t end = 0;
+        size_t chunk_size = 1;
+        size_t stride = 1;
+
+        bool empty() const { return this->begin >= this->end; }
+        template <typename F>
+        void for_each_chunk(const F &f) const; // f(chunk_begin, chunk_end)
+    };
+
     class SUAP_WORKER;
     class SUAP_POOL : public POOL
     {
     public:
-        explicit SUAP_POOL(size_t num_workers) : POOL(num_workers) {}
+        using COST = std::function<double(size_t)>;
+
+        // chunk_size is only used by SUAP_PARTITION::BLOCK_CYCLIC
+        explicit SUAP_POOL(size_t num_workers, SUAP_PARTITION partition = SUAP_PARTITION::DEFAULT, size_t chunk_size = 1)
+            : POOL(num_workers), partition_(partition), chunk_size_(std::max<size_t>(1, chunk_size)) {}
         virtual ~SUAP_POOL();
 
         virtual void start() override;
         virtual void terminate() override;
         // A single session of execution, blocking until completed
-        virtual void execute(const std::vector<RAW_TASK> &tasks) override;
+        virtual void execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation) override;
+        using POOL::execute;
+        // Static assignment ignores grain, each worker runs the chunks of its share
+        virtual void execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body) override;
+
+        // The cost of index i for SUAP_PARTITION::WEIGHTED, of tasks[i] or of iteration i of a range, e.g. i * i.
+        // Called for every index of a session before it starts.
+        void set_cost(COST cost) { this->cost_ = std::move(cost); }
+        // The share of each worker over [begin, end), worker 0 first
+        std::vector<SUAP_SHARE> partition(size_t begin, size_t end) const;
+
+    protected:
+        virtual void wake_helpers() override;
+
+    private:
+        void partition(size_t begin, size_t end, std::vector<SUAP_SHARE> &shares) const;
+        void partition_block(size_t begin, size_t end, std::vector<SUAP_SHARE> &shares) const; // Into the shares.size() workers
+        // Runs shares[i] by run_share on worker i, and the first one on the calling thread, blocking until completed.
+        // run_share returns the number of tasks it ran.
+        template <typename RUN_SHARE>
+        void run_session(const std::vector<SUAP_SHARE> &shares, const RUN_SHARE &run_share, size_t num_tasks);
 
     private:
         std::vector<std::unique_ptr<SUAP_WORKER>> workers_;
         std::vector<std::thread> executors_;
+        SUAP_PARTITION partition_;
+        size_t chunk_size_;
+        COST cost_;
+        std::vector<SUAP_SHARE> shares_; // Of the session holding the pool, reused across sessions
     };
 
     /// A channel with capacity 1 that supports backpressure.
@@ -40,6 +101,8 @@ namespace ERT
     ///    The try_send call is non-blocking:
     ///    If the channel is empty, it populates the channel right away;
     ///    If the channel is full, it immediately fails.
+    ///    The send call is blocking:
+    ///    If the channel is full, it waits until a receive call cleared it.
     /// 3. A receive call clears out the channel.
     ///    The receive call is blocking:
     ///    If the channel is full, it clears the channel right away;
@@ -54,6 +117,7 @@ namespace ERT
 
         // False if the channel is already full; True if successfully sent
         [[nodiscard]] bool try_send(T data);
+        void send(T data);
         T receive();
 
     private:
@@ -62,6 +126,7 @@ namespace ERT
             std::optional<T> parcel;
             std::mutex mutex;
             std::condition_variable cv_has_parcel;
+            std::condition_variable cv_has_room;
         };
         std::unique_ptr<STATE> state_ptr_;
     };
@@ -69,13 +134,16 @@ namespace ERT
     class SUAP_WORKER
     {
     public:
+        SUAP_WORKER(size_t worker_id, STATS_RECORDER &stats) : worker_id_(worker_id), stats_(stats) {}
         void run(); // Running on a thread
         void send_task(RAW_TASK task);
+        void send_help(INJECTION_QUEUE &injection_queue); // Unless a task is already waiting to be received
         void terminate();
 
     private:
-        using thread_task_type = std::function<bool()>; // true to continue thread event loop; false to terminate
-        CHANNEL_LITE<thread_task_type> task_launch_channel_;
+        CHANNEL_LITE<RAW_TASK> task_launch_channel_; // An empty task terminates the thread event loop
+        size_t worker_id_;
+        STATS_RECORDER &stats_;
     };
 
 }
@@ -92,19 +160,23 @@ namespace ERT
         ASSERT(this->workers_.empty());
         ASSERT(this->executors_.empty());
 
-        const size_t n_workers = this->num_workers();
+        // The calling thread of execute() acts as the first worker
+        const size_t n_executors = this->num_workers() - 1;
 
         // Consruct workers
-        this->workers_.reserve(n_workers);
-        std::generate_n(std::back_inserter(this->workers_), n_workers, []()
-                        { return std::make_unique<SUAP_WORKER>(); });
+        this->workers_.reserve(n_executors);
+        for (size_t worker_id = 1; worker_id <= n_executors; worker_id++)
+        {
+            this->workers_.emplace_back(std::make_unique<SUAP_WORKER>(worker_id, this->stats_recorder(worker_id)));
+        }
 
         // Initialize executors
-        this->executors_.reserve(n_workers);
+        this->executors_.reserve(n_executors);
         for (const auto &worker : this->workers_)
         {
             this->executors_.emplace_back(&SUAP_WORKER::run, worker.get());
         }
+        this->place_executors(this->executors_);
     }
 
     inline void SUAP_POOL::terminate()
@@ -121,56 +193,214 @@ namespace ERT
         this->executors_.clear();
     }
 
-    inline void SUAP_POOL::execute(const std::vector<RAW_TASK> &tasks)
+    inline void SUAP_POOL::execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation)
     {
-        ASSERT(!tasks.empty());
+        ASSERT(num_tasks > 0);
 
         // Workers and executors must be launched already
-        ASSERT(!this->workers_.empty());
-        ASSERT(!this->executors_.empty());
+        ASSERT(this->workers_.size() + 1 == this->num_workers());
+        ASSERT(this->executors_.size() == this->workers_.size());
+        // Each executor takes a single share at a time, the sessions submitted meanwhile are injected
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
+        {
+            this->inject(tasks, num_tasks, cancellation);
+            return;
+        }
 
-        const size_t num_tasks = tasks.size();
-        const size_t n_workers = this->num_workers();
-        size_t num_tasks_per_thread = (num_tasks - 1) / n_workers + 1;
+        // Each worker runs its share in place from the caller's tasks, the tasks past a cancelled one are all cancelled as well
+        this->partition(0, num_tasks, this->shares_);
+        this->run_session(this->shares_, [tasks, &cancellation](const SUAP_SHARE &share)
+                          {
+                              size_t num_tasks_run = 0;
+                              share.for_each_chunk([tasks, &cancellation, &num_tasks_run](size_t chunk_begin, size_t chunk_end)
+                                                   {
+                                                       for (size_t itask = chunk_begin; itask < chunk_end && !cancellation.is_cancelled(itask); itask++)
+                                                       {
+                                                           tasks[itask]();
+                                                           num_tasks_run++;
+                                                       } });
+                              return num_tasks_run; },
+                          num_tasks);
+    }
 
-        // Prepare thread master task
-        std::vector<RAW_TASK> thread_master_tasks;
-        std::atomic<size_t> n_workers_done = 0;
-        size_t num_tasks_added = 0;
-        for (size_t worker_id = 0; worker_id < n_workers; worker_id++)
+    inline void SUAP_POOL::execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body)
+    {
+        ASSERT(begin < end);
+
+        // Workers and executors must be launched already
+        ASSERT(this->workers_.size() + 1 == this->num_workers());
+        ASSERT(this->executors_.size() == this->workers_.size());
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
         {
-            if (num_tasks_added >= num_tasks)
+            this->inject(begin, end, grain, body);
+            return;
+        }
+
+        // A task per chunk of the share
+        this->partition(begin, end, this->shares_);
+        this->run_session(this->shares_, [&body](const SUAP_SHARE &share)
+                          {
+                              size_t num_chunks = 0;
+                              share.for_each_chunk([&body, &num_chunks](size_t chunk_begin, size_t chunk_end)
+                                                   {
+                                                       body(chunk_begin, chunk_end);
+                                                       num_chunks++; });
+                              return num_chunks; },
+                          end - begin);
+    }
+
+    template <typename RUN_SHARE>
+    void SUAP_POOL::run_session(const std::vector<SUAP_SHARE> &shares, const RUN_SHARE &run_share, size_t num_tasks)
+    {
+        ASSERT(shares.size() == this->num_workers());
+
+        // The first share is run by the calling thread
+        const size_t n_executors_launched = std::count_if(shares.begin() + 1, shares.end(), [](const SUAP_SHARE &share)
+                                                          { return !share.empty(); });
+        COMPLETION completion(n_executors_launched);
+
+        // Launch
+        for (size_t worker_id = 1; worker_id < shares.size(); worker_id++)
+        {
+            if (shares[worker_id].empty())
             {
                 continue;
             }
-            const size_t num_tasks_for_current_thread = std::min(num_tasks_per_thread, num_tasks - num_tasks_added);
-            num_tasks_added += num_tasks_for_current_thread;
+            this->workers_[worker_id - 1]->send_task([&run_share, &share = shares[worker_id], &completion, &stats = this->stats_recorder(worker_id)]()
+                                                     {
+                                                         stats.count_session();
+                                                         ERT_TRACE(TASK_BEGIN);
+                                                         const size_t num_tasks_run = run_share(share);
+                                                         ERT_TRACE(TASK_END);
+                                                         stats.count_tasks(num_tasks_run);
+                                                         completion.count_down(); });
+        }
 
-            std::vector<RAW_TASK> thread_tasks(
-                tasks.begin() + num_tasks_added - num_tasks_for_current_thread,
-                tasks.begin() + num_tasks_added);
+        // Run the first share on the calling thread, as worker 0
+        WORKER_INDEX::SCOPE worker_index(0);
+        STATS_RECORDER &stats = this->stats_recorder(0);
+        stats.count_session();
+        ERT_TRACE(SESSION_BEGIN, -1, num_tasks);
+        stats.begin_perf_counting();
+        size_t num_caller_tasks_run = 0;
+        ERT_TRACE(TASK_BEGIN);
+        stats.run_busy([&]()
+                       { num_caller_tasks_run = run_share(shares.front()); });
+        ERT_TRACE(TASK_END);
+        stats.count_tasks(num_caller_tasks_run);
 
-            auto thread_master_task = [thread_tasks = std::move(thread_tasks), &n_workers_done]()
+        // Synchronize
+        const STATS_RECORDER::CLOCK::time_point wait_start = stats.now();
+        ERT_TRACE(IDLE_BEGIN);
+        completion.wait(this->wait_policy());
+        ERT_TRACE(IDLE_END);
+        stats.add_idle_time(wait_start);
+        stats.end_perf_counting();
+        ERT_TRACE(SESSION_END);
+    }
+
+    inline void SUAP_POOL::wake_helpers()
+    {
+        for (const auto &worker : this->workers_)
+        {
+            worker->send_help(this->injection_queue());
+        }
+    }
+
+    inline std::vector<SUAP_SHARE> SUAP_POOL::partition(size_t begin, size_t end) const
+    {
+        std::vector<SUAP_SHARE> shares;
+        this->partition(begin, end, shares);
+        return shares;
+    }
+
+    inline void SUAP_POOL::partition_block(size_t begin, size_t end, std::vector<SUAP_SHARE> &shares) const
+    {
+        const size_t n_workers = shares.size();
+        const size_t num_indices_per_thread = (end - begin - 1) / n_workers + 1;
+        for (size_t worker_id = 0; worker_id < n_workers; worker_id++)
+        {
+            const size_t share_begin = std::min(end, begin + worker_id * num_indices_per_thread);
+            shares[worker_id] = {share_begin, std::min(end, share_begin + num_indices_per_thread), num_indices_per_thread, num_indices_per_thread};
+        }
+    }
+
+    inline void SUAP_POOL::partition(size_t begin, size_t end, std::vector<SUAP_SHARE> &shares) const
+    {
+        ASSERT(begin < end);
+        const size_t n_workers = this->num_workers();
+        const size_t num_indices = end - begin;
+        shares.resize(n_workers);
+        switch (this->partition_)
+        {
+        case SUAP_PARTITION::BLOCK:
+        {
+            this->partition_block(begin, end, shares);
+            break;
+        }
+        case SUAP_PARTITION::CYCLIC:
+        case SUAP_PARTITION::BLOCK_CYCLIC:
+        {
+            const size_t chunk_size = this->partition_ == SUAP_PARTITION::CYCLIC ? 1 : this->chunk_size_;
+            for (size_t worker_id = 0; worker_id < n_workers; worker_id++)
+            {
+                const size_t share_begin = worker_id < (num_indices - 1) / chunk_size + 1 ? begin + worker_id * chunk_size : end;
+                shares[worker_id] = {share_begin, end, chunk_size, n_workers * chunk_size};
+            }
+            break;
+        }
+        case SUAP_PARTITION::WEIGHTED:
+        {
+            ASSERT(this->cost_ && "SUAP_PARTITION::WEIGHTED needs set_cost()");
+            std::vector<double> costs(num_indices);
+            double total_cost = 0;
+            for (size_t i = 0; i < num_indices; i++)
+            {
+                costs[i] = this->cost_(begin + i);
+                ASSERT(costs[i] >= 0);
+                total_cost += costs[i];
+            }
+            if (total_cost <= 0)
+            {
+                // Nothing to weigh the indices by
+                this->partition_block(begin, end, shares);
+                break;
+            }
+            // Worker w starts at the index whose cost straddles w / P of the total, cutting at its midpoint
+            std::vector<size_t> share_begins(n_workers + 1, end);
+            share_begins[0] = begin;
+            size_t worker_id = 1;
+            double cost_before = 0;
+            for (size_t i = 0; i < num_indices && worker_id < n_workers; i++)
             {
-                for (const auto &task : thread_tasks)
+                while (worker_id < n_workers && cost_before + costs[i] / 2 >= total_cost * worker_id / n_workers)
                 {
-                    task();
+                    share_begins[worker_id++] = begin + i;
                 }
-                n_workers_done++;
-            };
-            thread_master_tasks.emplace_back(std::move(thread_master_task));
+                cost_before += costs[i];
+            }
+            for (worker_id = 0; worker_id < n_workers; worker_id++)
+            {
+                const size_t share_size = std::max<size_t>(1, share_begins[worker_id + 1] - share_begins[worker_id]);
+                shares[worker_id] = {share_begins[worker_id], share_begins[worker_id + 1], share_size, share_size};
+            }
+            break;
         }
-
-        // Launch
-        const size_t n_workers_launched = thread_master_tasks.size();
-        for (size_t worker_id = 0; worker_id < n_workers_launched; worker_id++)
+        default:
         {
-            this->workers_[worker_id]->send_task(thread_master_tasks[worker_id]);
+            ASSERT(false && "Unsupported SUAP_PARTITION");
+        }
         }
+    }
 
-        // Synchronize
-        while (n_workers_done.load() != n_workers_launched)
+    template <typename F>
+    void SUAP_SHARE::for_each_chunk(const F &f) const
+    {
+        for (size_t chunk_begin = this->begin; chunk_begin < this->end; chunk_begin += this->stride)
         {
+            f(chunk_begin, std::min(this->end, chunk_begin + this->chunk_size));
         }
     }
 
@@ -190,6 +420,17 @@ namespace ERT
         return true;
     }
 
+    template <typename T>
+    void CHANNEL_LITE<T>::send(T data)
+    {
+        std::unique_lock<std::mutex> unique_lock(state_ptr_->mutex);
+        state_ptr_->cv_has_room
+            .wait(unique_lock, [this]()
+                  { return !state_ptr_->parcel.has_value(); });
+        state_ptr_->parcel.emplace(std::move(data));
+        state_ptr_->cv_has_parcel.notify_one();
+    }
+
     template <typename T>
     T CHANNEL_LITE<T>::receive()
     {
@@ -199,38 +440,49 @@ namespace ERT
                   { return state_ptr_->parcel.has_value(); });
         T data = std::move(state_ptr_->parcel.value());
         state_ptr_->parcel.reset();
+        state_ptr_->cv_has_room.notify_one();
         return data;
     }
 
     inline void SUAP_WORKER::run()
     {
+        WORKER_INDEX::SCOPE worker_index(this->worker_id_);
+        this->stats_.begin_perf_counting();
         while (true)
         {
-            thread_task_type task = this->task_launch_channel_.receive(); // Blocking wait
-            bool should_continue = task();
-            if (!should_continue)
+            const STATS_RECORDER::CLOCK::time_point wait_start = this->stats_.now();
+            ERT_TRACE(IDLE_BEGIN);
+            RAW_TASK task = this->task_launch_channel_.receive(); // Blocking wait
+            ERT_TRACE(IDLE_END);
+            if (!task)
             {
+                this->stats_.end_perf_counting(true);
                 break;
             }
+            this->stats_.add_idle_time(wait_start);
+            this->stats_.run_busy(task);
         }
     }
 
     inline void SUAP_WORKER::send_task(RAW_TASK task)
     {
-        auto thread_task = [task = std::move(task)]
-        {
-            task();
-            return true;
-        };
-        bool is_sent = this->task_launch_channel_.try_send(std::move(thread_task));
-        ASSERT(is_sent);
+        ASSERT(task);
+        // Blocking behind a help task not received yet at most
+        this->task_launch_channel_.send(std::move(task));
+    }
+
+    inline void SUAP_WORKER::send_help(INJECTION_QUEUE &injection_queue)
+    {
+        // Running the chunks of the injected sessions until none is left to take
+        [[maybe_unused]] bool is_sent = this->task_launch_channel_.try_send([&injection_queue]()
+                                                                            {
+                                                                                while (injection_queue.try_help())
+                                                                                {
+                                                                                } });
     }
 
     inline void SUAP_WORKER::terminate()
     {
-        static const auto thread_quit_task = []()
-        { return false; };
-        bool is_sent = this->task_launch_channel_.try_send(thread_quit_task);
-        ASSERT(is_sent);
+        this->task_launch_channel_.send(nullptr);
     }
 }
\ No newline at end of file
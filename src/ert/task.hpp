@@ -1,21 +1,24 @@
 #pragma once
 
-#include <functional>
 #include <vector>
 
+#include "function.hpp"
+
 namespace ERT
 {
     struct WORKER_PROXY;
 
-    using TASK = std::function<void(WORKER_PROXY &)>;
-    using RAW_TASK = std::function<void()>;
+    // Move-only, with small captures stored inline
+    using TASK = FUNCTION<void(WORKER_PROXY &)>;
+    using RAW_TASK = FUNCTION<void()>;
+    using RANGE_BODY = FUNCTION<void(size_t begin, size_t end)>; // runs the iterations [begin, end)
 
     struct WORKER_PROXY
     {
         std::vector<TASK> tasks; // new tasks to add
     };
 
-    TASK to_task(RAW_TASK raw_task)
+    inline TASK to_task(RAW_TASK raw_task)
     {
         return [raw_task = std::move(raw_task)](WORKER_PROXY &)
         {
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "completion.hpp"
+#include "macros.hpp"
+#include "task.hpp"
+
+/// Task dependency graph
+
+namespace ERT
+{
+    /// Tasks with predecessors, each released as soon as all of its predecessors are done.
+    /// A node may only depend on nodes added before it, so the graph is acyclic by construction
+    /// and the order of addition is a valid serial order.
+    /// Built once and executed by POOL::execute_graph() as many times as needed.
+    class TASK_GRAPH
+    {
+    public:
+        using NODE = size_t;
+        using LOOP_BODY = FUNCTION<void(size_t)>; // runs a single iteration
+
+        /// The nodes [first, first + num_iterations) of a loop, a node per iteration
+        struct LOOP
+        {
+            NODE first;
+            size_t num_iterations;
+
+            NODE node(size_t iteration) const { return this->first + iteration; }
+        };
+
+        NODE add(RAW_TASK task);
+        void precede(NODE predecessor, NODE successor);
+        // A loop of body(i) for every i in [0, num_iterations)
+        LOOP add_loop(size_t num_iterations, LOOP_BODY body);
+        // A loop over the same iterations as previous, iteration i only waiting on iteration i of previous,
+        // so a pipeline of loops flows without a barrier between them
+        LOOP chain_loop(const LOOP &previous, LOOP_BODY body);
+
+        size_t size() const { return this->tasks_.size(); }
+        const RAW_TASK &task(NODE node) const { return this->tasks_[node]; }
+        const std::vector<NODE> &successors(NODE node) const { return this->successors_[node]; }
+        size_t num_predecessors(NODE node) const { return this->num_predecessors_[node]; }
+        // Nodes grouped by their depth, each level only depending on the levels before it
+        std::vector<std::vector<NODE>> levels() const;
+
+    private:
+        std::vector<RAW_TASK> tasks_;
+        std::vector<std::vector<NODE>> successors_;
+        std::vector<size_t> num_predecessors_;
+        std::vector<std::unique_ptr<LOOP_BODY>> loop_bodies_; // Shared by the nodes of a loop
+    };
+
+    /// The join counters of a single session over a TASK_GRAPH, for pools that release tasks dynamically.
+    /// Each task counts down the completion, and hands its released successors back to the worker running it.
+    class GRAPH_SESSION
+    {
+    public:
+        GRAPH_SESSION(const TASK_GRAPH &graph, COMPLETION &completion);
+
+        const std::vector<TASK_GRAPH::NODE> &roots() const { return this->roots_; }
+        TASK task(TASK_GRAPH::NODE node);
+
+    private:
+        const TASK_GRAPH &graph_;
+        COMPLETION &completion_;
+        std::unique_ptr<std::atomic<size_t>[]> num_pending_predecessors_;
+        std::vector<TASK_GRAPH::NODE> roots_;
+    };
+}
+
+namespace ERT
+{
+    inline TASK_GRAPH::NODE TASK_GRAPH::add(RAW_TASK task)
+    {
+        ASSERT(task);
+        this->tasks_.push_back(std::move(task));
+        this->successors_.emplace_back();
+        this->num_predecessors_.push_back(0);
+        return this->tasks_.size() - 1;
+    }
+
+    inline void TASK_GRAPH::precede(NODE predecessor, NODE successor)
+    {
+        ASSERT(successor < this->size());
+        ASSERT(predecessor < successor);
+        this->successors_[predecessor].push_back(successor);
+        this->num_predecessors_[successor]++;
+    }
+
+    inline TASK_GRAPH::LOOP TASK_GRAPH::add_loop(size_t num_iterations, LOOP_BODY body)
+    {
+        ASSERT(num_iterations > 0);
+        this->loop_bodies_.push_back(std::make_unique<LOOP_BODY>(std::move(body)));
+        const LOOP_BODY *loop_body = this->loop_bodies_.back().get();
+
+        const LOOP loop{this->size(), num_iterations};
+        this->tasks_.reserve(this->size() + num_iterations);
+        for (size_t i = 0; i < num_iterations; i++)
+        {
+            this->add([loop_body, i]()
+                      { (*loop_body)(i); });
+        }
+        return loop;
+    }
+
+    inline TASK_GRAPH::LOOP TASK_GRAPH::chain_loop(const LOOP &previous, LOOP_BODY body)
+    {
+        const LOOP loop = this->add_loop(previous.num_iterations, std::move(body));
+        for (size_t i = 0; i < loop.num_iterations; i++)
+        {
+            this->precede(previous.node(i), loop.node(i));
+        }
+        return loop;
+    }
+
+    inline std::vector<std::vector<TASK_GRAPH::NODE>> TASK_GRAPH::levels() const
+    {
+        // Predecessors come first, so a single pass in the order of addition settles every depth
+        std::vector<size_t> depths(this->size(), 0);
+        std::vector<std::vector<NODE>> levels;
+        for (NODE node = 0; node < this->size(); node++)
+        {
+            if (depths[node] == levels.size())
+            {
+                levels.emplace_back();
+            }
+            levels[depths[node]].push_back(node);
+            for (NODE successor : this->successors_[node])
+            {
+                depths[successor] = std::max(depths[successor], depths[node] + 1);
+            }
+        }
+        return levels;
+    }
+
+    inline GRAPH_SESSION::GRAPH_SESSION(const TASK_GRAPH &graph, COMPLETION &completion)
+        : graph_(graph), completion_(completion),
+          num_pending_predecessors_(std::make_unique<std::atomic<size_t>[]>(graph.size()))
+    {
+        for (TASK_GRAPH::NODE node = 0; node < graph.size(); node++)
+        {
+            this->num_pending_predecessors_[node].store(graph.num_predecessors(node), std::memory_order_relaxed);
+            if (graph.num_predecessors(node) == 0)
+            {
+                this->roots_.push_back(node);
+            }
+        }
+    }
+
+    inline TASK GRAPH_SESSION::task(TASK_GRAPH::NODE node)
+    {
+        return [this, node](WORKER_PROXY &worker_proxy)
+        {
+            this->graph_.task(node)();
+            for (TASK_GRAPH::NODE successor : this->graph_.successors(node))
+            {
+                // The last predecessor to finish releases the successor
+                if (this->num_pending_predecessors_[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    worker_proxy.tasks.push_back(this->task(successor));
+                }
+            }
+            this->completion_.count_down();
+        };
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <utility>
+
+#include "idle.hpp"
+#include "task.hpp"
+
+/// Fork-join task groups for tasks running on a pool
+
+namespace ERT
+{
+    /// The worker running the calling thread, for a running task to add and help with nested work.
+    /// Bound by the work stealing workers while they run, and nullptr on any other thread.
+    class WORKER_CONTEXT
+    {
+    public:
+        virtual ~WORKER_CONTEXT() = default;
+
+        virtual void spawn(TASK task) = 0; // Add a task to the deque of this worker
+        virtual bool try_run_one() = 0;    // Run or acquire some pending work; false if none was found
+
+        static WORKER_CONTEXT *current() { return current_; }
+
+    protected:
+        static void bind(WORKER_CONTEXT *worker_context) { current_ = worker_context; }
+
+    private:
+        static inline thread_local WORKER_CONTEXT *current_ = nullptr;
+    };
+
+    /// Spawns tasks on the worker running the calling thread, and waits for all of them.
+    /// A waiting worker runs or steals pending work instead of blocking, so groups nest
+    /// and recurse, e.g., for divide and conquer or nested parallel loops.
+    /// Outside of a worker, spawned tasks run inline right away.
+    class TASK_GROUP
+    {
+    public:
+        TASK_GROUP() = default;
+        TASK_GROUP(const TASK_GROUP &) = delete;
+        TASK_GROUP &operator=(const TASK_GROUP &) = delete;
+        ~TASK_GROUP() { this->wait(); }
+
+        template <typename F>
+        void spawn(F &&f);
+        void wait();
+
+    private:
+        std::atomic<size_t> num_pending_ = 0;
+    };
+}
+
+namespace ERT
+{
+    template <typename F>
+    void TASK_GROUP::spawn(F &&f)
+    {
+        WORKER_CONTEXT *worker_context = WORKER_CONTEXT::current();
+        if (!worker_context)
+        {
+            f();
+            return;
+        }
+        this->num_pending_++;
+        worker_context->spawn([this, f = std::forward<F>(f)](WORKER_PROXY &) mutable
+                              {
+                                  f();
+                                  // The group may be gone right after the count reaches 0
+                                  this->num_pending_.fetch_sub(1, std::memory_order_release); });
+    }
+
+    inline void TASK_GROUP::wait()
+    {
+        WORKER_CONTEXT *worker_context = WORKER_CONTEXT::current();
+        // Nobody unparks a waiting group, so back off no further than yielding
+        BACKOFF backoff(IDLE_POLICY{});
+        while (this->num_pending_.load(std::memory_order_acquire) != 0)
+        {
+            if (worker_context && worker_context->try_run_one())
+            {
+                backoff.reset();
+            }
+            else if (backoff.pause())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
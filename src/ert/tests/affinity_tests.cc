@@ -0,0 +1,120 @@
+#define MESSAGE_LEVEL 0
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "affinity.hpp"
+#include "tests_helper.hpp"
+#include "utst.hpp"
+#include "wspdr_pool.hpp"
+
+using namespace ERT;
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    void write_file(const fs::path &path, const std::string &content)
+    {
+        fs::create_directories(path.parent_path());
+        std::ofstream file(path);
+        file << content << "\n";
+    }
+
+    // 2 packages x 2 cores x 2 SMT siblings, numbered as Linux does: cpu i and cpu i + 4 share a core
+    fs::path make_fake_sysfs()
+    {
+        const fs::path root = fs::temp_directory_path() / "ert_affinity_tests";
+        fs::remove_all(root);
+        write_file(root / "online", "0-7");
+        for (int cpu = 0; cpu < 8; cpu++)
+        {
+            const fs::path cpu_path = root / ("cpu" + std::to_string(cpu));
+            const int package = (cpu % 4) / 2;
+            write_file(cpu_path / "topology" / "core_id", std::to_string(cpu % 2));
+            write_file(cpu_path / "topology" / "physical_package_id", std::to_string(package));
+            write_file(cpu_path / "cache" / "index3" / "id", std::to_string(package));
+            fs::create_directories(cpu_path / ("node" + std::to_string(package)));
+        }
+        return root;
+    }
+}
+
+UTST_MAIN();
+
+UTST_TEST(parse_cpu_list)
+{
+    UTST_ASSERT(parse_cpu_list("0-3,5,7-8") == std::vector<int>({0, 1, 2, 3, 5, 7, 8}));
+    UTST_ASSERT(parse_cpu_list("4") == std::vector<int>({4}));
+    UTST_ASSERT(parse_cpu_list("").empty());
+}
+
+UTST_TEST(topology)
+{
+    const fs::path root = make_fake_sysfs();
+    const TOPOLOGY topology = TOPOLOGY::read(root.string());
+    UTST_ASSERT_EQUAL(topology.size(), size_t(8));
+    const CPU_INFO &cpu5 = *topology.find(5);
+    UTST_ASSERT_EQUAL(cpu5.core, 1);
+    UTST_ASSERT_EQUAL(cpu5.package, 0);
+    UTST_ASSERT_EQUAL(cpu5.llc, 0);
+    UTST_ASSERT_EQUAL(cpu5.node, 0);
+
+    UTST_ASSERT_EQUAL(TOPOLOGY::distance(*topology.find(0), *topology.find(0)), 0);
+    UTST_ASSERT_EQUAL(TOPOLOGY::distance(*topology.find(0), *topology.find(4)), 1);
+    UTST_ASSERT_EQUAL(TOPOLOGY::distance(*topology.find(0), *topology.find(1)), 2);
+    UTST_ASSERT_EQUAL(TOPOLOGY::distance(*topology.find(0), *topology.find(2)), 4);
+
+    UTST_ASSERT(TOPOLOGY::read((root / "missing").string()).size() == 0);
+    fs::remove_all(root);
+}
+
+UTST_TEST(placements)
+{
+    const fs::path root = make_fake_sysfs();
+    const TOPOLOGY topology = TOPOLOGY::read(root.string());
+    fs::remove_all(root);
+
+    UTST_ASSERT(PLACEMENT::none().assign(topology, 8).empty());
+    UTST_ASSERT(PLACEMENT::compact().assign(topology, 8) == std::vector<int>({0, 4, 1, 5, 2, 6, 3, 7}));
+    UTST_ASSERT(PLACEMENT::scatter().assign(topology, 8) == std::vector<int>({0, 2, 1, 3, 4, 6, 5, 7}));
+    UTST_ASSERT(PLACEMENT::physical_cores().assign(topology, 6) == std::vector<int>({0, 1, 2, 3, 0, 1}));
+    UTST_ASSERT(PLACEMENT::cpu_list({5, 3}).assign(topology, 3) == std::vector<int>({5, 3, 5}));
+}
+
+UTST_TEST(group_by_distance)
+{
+    const fs::path root = make_fake_sysfs();
+    const TOPOLOGY topology = TOPOLOGY::read(root.string());
+    fs::remove_all(root);
+
+    // Compact: workers 0 and 1 share a core, 2 and 3 the other core of package 0, and 4-7 are on package 1
+    const std::vector<int> worker_cpus = PLACEMENT::compact().assign(topology, 8);
+    UTST_ASSERT(topology.group_by_distance(worker_cpus, 8, 0) == std::vector<std::vector<int>>({{1}, {2, 3}, {4, 5, 6, 7}}));
+    UTST_ASSERT(topology.group_by_distance(worker_cpus, 8, 6) == std::vector<std::vector<int>>({{7}, {4, 5}, {0, 1, 2, 3}}));
+
+    // Not placed, a single group
+    UTST_ASSERT(topology.group_by_distance({}, 4, 2) == std::vector<std::vector<int>>({{0, 1, 3}}));
+    UTST_ASSERT(topology.group_by_distance({}, 1, 0).empty());
+}
+
+UTST_TEST(pinned_pool)
+{
+    const TOPOLOGY topology = TOPOLOGY::current();
+    UTST_ASSERT(topology.size() > 0);
+    UTST_ASSERT(pin_this_thread(topology.cpus().front().cpu));
+
+    for (PLACEMENT placement : {PLACEMENT::compact(), PLACEMENT::scatter(), PLACEMENT::physical_cores()})
+    {
+        WSPDR_POOL pool(4);
+        pool.set_placement(placement);
+        pool.start();
+        std::vector<int> num_runs(1000, 0);
+        parallel_for(pool, 0, num_runs.size(), 1, [&num_runs](size_t i)
+                     { num_runs[i]++; });
+        UTST_ASSERT(std::all_of(num_runs.begin(), num_runs.end(), [](int n)
+                                { return n == 1; }));
+    }
+}
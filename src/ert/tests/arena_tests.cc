@@ -0,0 +1,79 @@
+#define MESSAGE_LEVEL 0
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "arena.hpp"
+#include "utst.hpp"
+
+using namespace ERT;
+
+UTST_MAIN();
+
+UTST_TEST(allocate)
+{
+    ARENA arena(256);
+    char *a = static_cast<char *>(arena.allocate(10, 1));
+    double *b = static_cast<double *>(arena.allocate(sizeof(double), alignof(double)));
+    UTST_ASSERT(reinterpret_cast<uintptr_t>(b) % alignof(double) == 0);
+    UTST_ASSERT(reinterpret_cast<char *>(b) >= a + 10);
+    UTST_ASSERT_EQUAL(arena.num_blocks(), size_t(1));
+
+    // Spills into a new block, and an oversized one gets a block of its own
+    arena.allocate(240, 1);
+    UTST_ASSERT_EQUAL(arena.num_blocks(), size_t(2));
+    arena.allocate(1000, 1);
+    UTST_ASSERT_EQUAL(arena.num_blocks(), size_t(3));
+}
+
+UTST_TEST(reset)
+{
+    ARENA arena(256);
+    void *first = arena.allocate(64);
+    for (int i = 0; i < 100; i++)
+    {
+        arena.allocate(64);
+    }
+    const size_t num_blocks = arena.num_blocks();
+
+    // Blocks are reused after reset
+    arena.reset();
+    UTST_ASSERT(arena.allocate(64) == first);
+    for (int i = 0; i < 100; i++)
+    {
+        arena.allocate(64);
+    }
+    UTST_ASSERT_EQUAL(arena.num_blocks(), num_blocks);
+}
+
+UTST_TEST(allocator)
+{
+    ARENA arena;
+    std::vector<int, ARENA_ALLOCATOR<int>> vec{ARENA_ALLOCATOR<int>(&arena)};
+    for (int i = 0; i < 1000; i++)
+    {
+        vec.push_back(i);
+    }
+    UTST_ASSERT_EQUAL(vec[999], 999);
+
+    // Moving carries the allocator along
+    std::vector<int, ARENA_ALLOCATOR<int>> moved;
+    moved = std::move(vec);
+    UTST_ASSERT(moved.get_allocator().arena() == &arena);
+    UTST_ASSERT_EQUAL(moved.size(), size_t(1000));
+}
+
+UTST_TEST(session_arena)
+{
+    std::atomic<uint64_t> session_clock = 1;
+    SESSION_ARENA session_arena;
+    session_arena.bind(&session_clock);
+
+    void *first = session_arena.get().allocate(64);
+    UTST_ASSERT(session_arena.get().allocate(64) != first);
+
+    // Reset at the first use in the next session
+    session_clock++;
+    UTST_ASSERT(session_arena.get().allocate(64) == first);
+}
@@ -0,0 +1,92 @@
+#define MESSAGE_LEVEL 0
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "bench/bench.hpp"
+#include "utst.hpp"
+
+using namespace BENCH;
+
+namespace
+{
+    RESULT make_result(const char *benchmark, const char *pool, size_t num_workers, std::vector<double> samples)
+    {
+        return {benchmark, pool, num_workers, 10, summarize(std::move(samples))};
+    }
+}
+
+UTST_MAIN();
+
+UTST_TEST(summarize)
+{
+    const SUMMARY empty = summarize({});
+    UTST_ASSERT_EQUAL(empty.num_samples, size_t(0));
+
+    const SUMMARY single = summarize({2.0});
+    UTST_ASSERT_EQUAL(single.median, 2.0);
+    UTST_ASSERT_EQUAL(single.p95, 2.0);
+    UTST_ASSERT_EQUAL(single.stddev, 0.0);
+
+    std::vector<double> samples;
+    for (size_t i = 100; i > 0; i--)
+    {
+        samples.push_back(double(i));
+    }
+    const SUMMARY summary = summarize(samples);
+    UTST_ASSERT_EQUAL(summary.num_samples, size_t(100));
+    UTST_ASSERT_EQUAL(summary.min, 1.0);
+    UTST_ASSERT_EQUAL(summary.max, 100.0);
+    UTST_ASSERT_EQUAL(summary.mean, 50.5);
+    UTST_ASSERT_EQUAL(summary.median, 50.5);
+    UTST_ASSERT_EQUAL(summary.p95, 95.0);
+    UTST_ASSERT(summary.stddev > 29.0 && summary.stddev < 29.1);
+
+    const std::vector<double> sampled = sample(2, 3, []()
+                                               { return 1.5; });
+    UTST_ASSERT(sampled == std::vector<double>({1.5, 1.5, 1.5}));
+}
+
+UTST_TEST(report)
+{
+    REPORT report;
+    report.add(make_result("sorting", "SERIAL", 1, {4.0, 4.0}));
+    report.add(make_result("sorting", "WSPDR", 4, {1.0, 1.0}));
+    report.add(make_result("wakeup", "WSPDR", 4, {})); // Left out
+    UTST_ASSERT_EQUAL(report.results().size(), size_t(2));
+    report.compute_speedups();
+    UTST_ASSERT_EQUAL(report.results()[1].speedup, 4.0);
+    UTST_ASSERT_EQUAL(report.results()[1].throughput(), 10.0);
+
+    const std::string csv = report.to_csv();
+    UTST_ASSERT_EQUAL(csv.rfind("benchmark,pool,workers,tasks,samples,mean,stddev,min,median,p95,max,speedup,throughput\n", 0), size_t(0));
+    UTST_ASSERT(csv.find("\nsorting,WSPDR,4,10,2,") != std::string::npos);
+    const std::string json = report.to_json();
+    UTST_ASSERT(json.find("{\"benchmark\": \"sorting\", \"pool\": \"WSPDR\", \"workers\": 4, ") != std::string::npos);
+
+    // Round trip through a CSV, then compared to a slower run
+    const std::string path = (std::filesystem::temp_directory_path() / "ert_bench_tests.csv").string();
+    UTST_ASSERT(report.write(path));
+    REPORT baseline;
+    UTST_ASSERT(baseline.read_csv(path));
+    std::remove(path.c_str());
+    UTST_ASSERT_EQUAL(baseline.results().size(), size_t(2));
+    UTST_ASSERT_EQUAL(baseline.results()[1].summary.median, 1.0);
+    UTST_ASSERT_EQUAL(report.compare(baseline, 0.1), size_t(0));
+
+    REPORT slower;
+    slower.add(make_result("sorting", "SERIAL", 1, {4.2, 4.2}));
+    slower.add(make_result("sorting", "WSPDR", 4, {1.5, 1.5}));
+    slower.add(make_result("sorting", "WSPDR", 8, {9.0})); // Not in the baseline
+    UTST_ASSERT_EQUAL(slower.compare(baseline, 0.1), size_t(1));
+    UTST_ASSERT_EQUAL(slower.compare(baseline, 0.6), size_t(0));
+
+    // A truncated baseline is not a baseline
+    UTST_ASSERT(REPORT().write(path));
+    REPORT truncated;
+    UTST_ASSERT(!truncated.read_csv(path));
+    std::remove(path.c_str());
+    UTST_ASSERT(!truncated.read_csv(path));
+}
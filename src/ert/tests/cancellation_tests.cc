@@ -0,0 +1,152 @@
+#define MESSAGE_LEVEL 0
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "cancellation.hpp"
+#include "default_pool.hpp"
+#include "dss_pool.hpp"
+#include "serial_pool.hpp"
+#include "suap_pool.hpp"
+#include "tests_kernels.hpp"
+#include "utst.hpp"
+#include "wscl_pool.hpp"
+#include "wspdr_pool.hpp"
+#include "wspds_pool.hpp"
+
+using namespace ERT;
+
+namespace
+{
+    // Every task past 300 that is a multiple of 97 matches, as a search loop exiting at its first match.
+    // Whatever the order the pool runs them in, every task before the first match runs, and it is the one reported.
+    void check_first_match(POOL &pool)
+    {
+        const size_t num_tasks = 1000;
+        const size_t first_match = 300;
+        for (int session = 0; session < 20; session++)
+        {
+            CANCELLATION cancellation;
+            std::vector<std::atomic<bool>> is_run(num_tasks);
+            std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_tasks, [&](size_t itask)
+                                                                  {
+                                                                      is_run[itask] = true;
+                                                                      if (itask >= first_match && itask % 97 == first_match % 97)
+                                                                      {
+                                                                          cancellation.cancel_from(itask);
+                                                                      } });
+            pool.execute(tasks, cancellation);
+            UTST_ASSERT_EQUAL(cancellation.first_cancelled(), first_match);
+            for (size_t itask = 0; itask <= first_match; itask++)
+            {
+                UTST_ASSERT(is_run[itask].load());
+            }
+        }
+    }
+
+    // The first task to run cancels the whole session: each worker may have started at most one more task before
+    // seeing it, and every other task is dropped while the session still completes
+    void check_drop(POOL &pool)
+    {
+        const size_t num_tasks = 10000;
+        for (int session = 0; session < 20; session++)
+        {
+            CANCELLATION cancellation;
+            std::atomic<size_t> num_run = 0;
+            std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_tasks, [&](size_t)
+                                                                  {
+                                                                      if (num_run++ == 0)
+                                                                      {
+                                                                          cancellation.cancel();
+                                                                      } });
+            pool.execute(tasks, cancellation);
+            UTST_ASSERT(cancellation.is_cancelled());
+            UTST_ASSERT(num_run.load() >= 1);
+            UTST_ASSERT(num_run.load() <= pool.num_workers());
+        }
+
+        // Never cancelled, the next session runs everything
+        std::atomic<size_t> num_run = 0;
+        std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_tasks, [&](size_t)
+                                                              { num_run++; });
+        pool.execute(tasks);
+        UTST_ASSERT_EQUAL(num_run.load(), num_tasks);
+    }
+
+    template <typename POOL_IF, typename... ARGS>
+    void check_cancellation(ARGS... args)
+    {
+        auto pool = std::make_unique<POOL_IF>(args...);
+        pool->start();
+        check_first_match(*pool);
+        check_drop(*pool);
+        pool->terminate();
+    }
+}
+
+UTST_MAIN();
+
+UTST_TEST(token)
+{
+    CANCELLATION cancellation;
+    UTST_ASSERT(!cancellation.is_cancelled());
+    UTST_ASSERT(!cancellation.is_cancelled(CANCELLATION::NONE - 1));
+
+    // Only ever lowered
+    cancellation.cancel_from(42);
+    cancellation.cancel_from(100);
+    UTST_ASSERT_EQUAL(cancellation.first_cancelled(), size_t(42));
+    UTST_ASSERT(!cancellation.is_cancelled(41));
+    UTST_ASSERT(cancellation.is_cancelled(42));
+    UTST_ASSERT(cancellation.is_cancelled(43));
+    cancellation.cancel();
+    UTST_ASSERT(cancellation.is_cancelled(0));
+
+    cancellation.reset();
+    UTST_ASSERT(!cancellation.is_cancelled());
+    UTST_ASSERT(!CANCELLATION::never().is_cancelled());
+}
+
+UTST_TEST(pools)
+{
+    check_cancellation<SERIAL_POOL>(1);
+    check_cancellation<SUAP_POOL>(4);
+    check_cancellation<WSPDR_POOL>(4);
+    check_cancellation<WSPDS_POOL>(4);
+    check_cancellation<WSCL_POOL>(4);
+    check_cancellation<DSS_POOL>(4, DSS_POLICY::DYNAMIC, 16);
+    check_cancellation<DSS_POOL>(4, DSS_POLICY::GUIDED);
+    check_cancellation<DSS_POOL>(4, DSS_POLICY::FACTORING);
+    check_cancellation<DSS_POOL>(4, DSS_POLICY::TRAPEZOID);
+}
+
+UTST_TEST(execute_shared)
+{
+    // From the calling thread, and nested in a task of a work stealing session
+    WSPDR_POOL &pool = default_pool<WSPDR_POOL>(4);
+    CANCELLATION cancellation;
+    std::atomic<size_t> num_run = 0;
+    std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(1000, [&](size_t itask)
+                                                          {
+                                                              num_run++;
+                                                              if (itask == 10)
+                                                              {
+                                                                  cancellation.cancel_from(itask);
+                                                              } });
+    execute_shared(pool, tasks, cancellation);
+    UTST_ASSERT_EQUAL(cancellation.first_cancelled(), size_t(10));
+    UTST_ASSERT(num_run.load() >= 11);
+
+    std::atomic<size_t> num_nested_run = 0;
+    std::vector<RAW_TASK> outer_tasks = TESTS::generate_n_tasks(4, [&](size_t)
+                                                                {
+                                                                    CANCELLATION nested_cancellation;
+                                                                    std::vector<RAW_TASK> nested_tasks = TESTS::generate_n_tasks(100, [&](size_t)
+                                                                                                                                 {
+                                                                                                                                     num_nested_run++;
+                                                                                                                                     nested_cancellation.cancel(); });
+                                                                    execute_shared(pool, nested_tasks, nested_cancellation); });
+    execute_shared(pool, outer_tasks);
+    UTST_ASSERT(num_nested_run.load() < 4 * 100);
+}
@@ -0,0 +1,179 @@
+#define MESSAGE_LEVEL 0
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "dss_pool.hpp"
+#include "serial_pool.hpp"
+#include "suap_pool.hpp"
+#include "task_graph.hpp"
+#include "tests_kernels.hpp"
+#include "utst.hpp"
+#include "wscl_pool.hpp"
+#include "wspdr_pool.hpp"
+#include "wspds_pool.hpp"
+
+using namespace ERT;
+
+namespace
+{
+    constexpr size_t NUM_SUBMITTERS = 4;
+    constexpr int NUM_ROUNDS = 30;
+
+    // A round of the three kinds of sessions, each checking its own results only; the number of them that failed
+    size_t run_round(POOL &pool, size_t submitter)
+    {
+        size_t num_failures = 0;
+
+        const size_t num_tasks = 200;
+        std::atomic<size_t> task_sum = 0;
+        std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_tasks, [&task_sum, submitter](size_t itask)
+                                                              { task_sum += (itask + 1) * (submitter + 1); });
+        pool.execute(tasks);
+        num_failures += task_sum.load() != (submitter + 1) * num_tasks * (num_tasks + 1) / 2;
+
+        const size_t num_iterations = 10000;
+        std::atomic<size_t> range_sum = 0;
+        pool.execute_range(0, num_iterations, 64, [&range_sum](size_t chunk_begin, size_t chunk_end)
+                           {
+                               size_t chunk_sum = 0;
+                               for (size_t i = chunk_begin; i < chunk_end; i++)
+                               {
+                                   chunk_sum += i;
+                               }
+                               range_sum += chunk_sum; });
+        num_failures += range_sum.load() != num_iterations * (num_iterations - 1) / 2;
+
+        const size_t num_nodes = 100;
+        std::vector<size_t> stages(num_nodes, 0);
+        TASK_GRAPH graph;
+        const TASK_GRAPH::LOOP first = graph.add_loop(num_nodes, [&stages](size_t i)
+                                                      { stages[i] = 1; });
+        graph.chain_loop(first, [&stages](size_t i)
+                         { stages[i] = stages[i] == 1 ? 2 : 0; });
+        pool.execute_graph(graph);
+        for (size_t stage : stages)
+        {
+            num_failures += stage != 2;
+        }
+        return num_failures;
+    }
+
+    // Host threads submitting overlapping sessions to the same pool
+    template <typename POOL_IF, typename... ARGS>
+    void check_concurrent_sessions(ARGS... args)
+    {
+        auto pool = std::make_unique<POOL_IF>(args...);
+        pool->start();
+
+        std::atomic<bool> is_started = false;
+        std::atomic<size_t> num_failures = 0;
+        std::vector<std::thread> submitters;
+        for (size_t submitter = 0; submitter < NUM_SUBMITTERS; submitter++)
+        {
+            submitters.emplace_back([&, submitter]()
+                                    {
+                                        while (!is_started)
+                                        {
+                                            std::this_thread::yield();
+                                        }
+                                        for (int round = 0; round < NUM_ROUNDS; round++)
+                                        {
+                                            num_failures += run_round(*pool, submitter);
+                                        } });
+        }
+        is_started = true;
+        for (std::thread &submitter : submitters)
+        {
+            submitter.join();
+        }
+        UTST_ASSERT_EQUAL(num_failures.load(), size_t(0));
+
+        // Still serving a single caller afterwards
+        UTST_ASSERT_EQUAL(run_round(*pool, 0), size_t(0));
+        pool->terminate();
+    }
+
+    // A session short of the workers held by a long one, which only completes once released
+    template <typename POOL_IF, typename... ARGS>
+    void check_short_behind_long(ARGS... args)
+    {
+        auto pool = std::make_unique<POOL_IF>(args...);
+        pool->start();
+
+        std::atomic<size_t> num_started = 0;
+        std::atomic<bool> is_released = false;
+        std::thread long_submitter([&]()
+                                   {
+                                       std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(pool->num_workers(), [&](size_t)
+                                                                                             {
+                                                                                                 num_started++;
+                                                                                                 while (!is_released)
+                                                                                                 {
+                                                                                                     std::this_thread::yield();
+                                                                                                 } });
+                                       pool->execute(tasks); });
+        while (num_started == 0)
+        {
+            std::this_thread::yield();
+        }
+
+        // Completing while the long session still holds every worker
+        UTST_ASSERT_EQUAL(run_round(*pool, 0), size_t(0));
+        UTST_ASSERT(!is_released);
+        is_released = true;
+        long_submitter.join();
+        UTST_ASSERT_EQUAL(num_started.load(), pool->num_workers());
+        pool->terminate();
+    }
+
+    // Tasks submitting sessions to the pool running them
+    template <typename POOL_IF, typename... ARGS>
+    void check_nested_sessions(ARGS... args)
+    {
+        auto pool = std::make_unique<POOL_IF>(args...);
+        pool->start();
+
+        const size_t num_tasks = 16;
+        std::atomic<size_t> num_failures = 0;
+        std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_tasks, [&](size_t itask)
+                                                              { num_failures += run_round(*pool, itask); });
+        pool->execute(tasks);
+        UTST_ASSERT_EQUAL(num_failures.load(), size_t(0));
+        pool->terminate();
+    }
+}
+
+UTST_MAIN();
+
+UTST_TEST(submitters)
+{
+    check_concurrent_sessions<SERIAL_POOL>(1);
+    check_concurrent_sessions<SUAP_POOL>(4);
+    check_concurrent_sessions<DSS_POOL>(4);
+    check_concurrent_sessions<WSPDR_POOL>(4);
+    check_concurrent_sessions<WSPDS_POOL>(4);
+    check_concurrent_sessions<WSCL_POOL>(4);
+}
+
+UTST_TEST(short_behind_long)
+{
+    check_short_behind_long<SERIAL_POOL>(1);
+    check_short_behind_long<SUAP_POOL>(4);
+    check_short_behind_long<DSS_POOL>(4);
+    check_short_behind_long<WSPDR_POOL>(4);
+    check_short_behind_long<WSPDS_POOL>(4);
+    check_short_behind_long<WSCL_POOL>(4);
+}
+
+UTST_TEST(nested)
+{
+    check_nested_sessions<SERIAL_POOL>(1);
+    check_nested_sessions<SUAP_POOL>(4);
+    check_nested_sessions<DSS_POOL>(4);
+    check_nested_sessions<WSPDR_POOL>(4);
+    check_nested_sessions<WSPDS_POOL>(4);
+    check_nested_sessions<WSCL_POOL>(4);
+}
@@ -0,0 +1,104 @@
+#define MESSAGE_LEVEL 0
+
+#include <atomic>
+#include <filesystem>
+#include <iterator>
+#include <vector>
+
+#include "default_pool.hpp"
+#include "dss_pool.hpp"
+#include "serial_pool.hpp"
+#include "suap_pool.hpp"
+#include "tests_kernels.hpp"
+#include "utst.hpp"
+#include "wscl_pool.hpp"
+#include "wspdr_pool.hpp"
+#include "wspds_pool.hpp"
+
+using namespace ERT;
+
+namespace
+{
+    // A parallelized function calling itself from its tasks, num_branches times per level
+    template <typename POOL_IF>
+    void recurse(size_t depth, size_t num_branches, std::atomic<size_t> &num_leaves)
+    {
+        POOL_IF &pool = default_pool<POOL_IF>(4);
+        std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_branches, [depth, num_branches, &num_leaves](size_t)
+                                                              {
+                                                                  if (depth == 0)
+                                                                  {
+                                                                      num_leaves++;
+                                                                      return;
+                                                                  }
+                                                                  recurse<POOL_IF>(depth - 1, num_branches, num_leaves); });
+        execute_shared(pool, tasks);
+    }
+
+    template <typename POOL_IF>
+    void check_nested_calls()
+    {
+        // Sized by the first call only
+        POOL_IF &pool = default_pool<POOL_IF>(4);
+        UTST_ASSERT(&default_pool<POOL_IF>(2) == &pool);
+
+        for (int call = 0; call < 50; call++)
+        {
+            std::atomic<size_t> num_leaves = 0;
+            recurse<POOL_IF>(3, 4, num_leaves);
+            UTST_ASSERT_EQUAL(num_leaves.load(), size_t(4 * 4 * 4 * 4));
+        }
+    }
+
+    size_t num_threads()
+    {
+        return std::distance(std::filesystem::directory_iterator("/proc/self/task"), std::filesystem::directory_iterator());
+    }
+}
+
+UTST_MAIN();
+
+UTST_TEST(default_pool)
+{
+    WSPDR_POOL &pool = default_pool();
+    UTST_ASSERT(&default_pool<WSPDR_POOL>() == &pool);
+    UTST_ASSERT(pool.num_workers() > 0);
+
+    auto [serial_task, tasks, result_ptr] = TESTS::generate_collatz_conjecture_tasks();
+    const size_t serial_result = serial_task();
+    for (int call = 0; call < 3; call++)
+    {
+        *result_ptr = 0;
+        execute_shared(pool, tasks);
+        UTST_ASSERT_EQUAL(serial_result, result_ptr->load());
+    }
+    execute_shared(pool, {});
+}
+
+UTST_TEST(nested_calls)
+{
+    check_nested_calls<WSPDR_POOL>();
+    check_nested_calls<WSPDS_POOL>();
+    check_nested_calls<WSCL_POOL>();
+    check_nested_calls<SUAP_POOL>();
+    check_nested_calls<DSS_POOL>();
+    check_nested_calls<SERIAL_POOL>();
+}
+
+UTST_TEST(single_thread_budget)
+{
+    // The executors of a single pool at a time, whatever the types asked for
+    WSPDR_POOL &wspdr_pool = default_pool<WSPDR_POOL>();
+    const size_t num_pool_threads = num_threads();
+    SUAP_POOL &suap_pool = default_pool<SUAP_POOL>();
+    UTST_ASSERT_EQUAL(num_threads(), num_pool_threads);
+    UTST_ASSERT_EQUAL(suap_pool.num_workers(), wspdr_pool.num_workers());
+
+    // Switching back restarts the same pool
+    UTST_ASSERT(&default_pool<WSPDR_POOL>() == &wspdr_pool);
+    UTST_ASSERT_EQUAL(num_threads(), num_pool_threads);
+    std::atomic<size_t> num_run = 0;
+    execute_shared(wspdr_pool, TESTS::generate_n_tasks(100, [&num_run](size_t)
+                                                       { num_run++; }));
+    UTST_ASSERT_EQUAL(num_run.load(), size_t(100));
+}
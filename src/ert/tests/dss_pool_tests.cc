@@ -0,0 +1,117 @@
+#define MESSAGE_LEVEL 0
+
+#include <algorithm>
+#include <cstdio>
+
+#include "dss_pool.hpp"
+#include "serial_pool.hpp"
+#include "tests_helper.hpp"
+#include "tests_kernels.hpp"
+#include "timer.hpp"
+#include "utst.hpp"
+
+using namespace ERT;
+
+UTST_MAIN();
+
+UTST_TEST(simple)
+{
+    TESTS::quick_launch<DSS_POOL>(2, TESTS::generate_simple_print_tasks(2));
+}
+
+UTST_TEST(simple_with_idle_worker)
+{
+    TESTS::quick_launch<DSS_POOL>(4, TESTS::generate_simple_print_tasks(2));
+}
+
+UTST_TEST(multi_session)
+{
+    constexpr int size = 32;
+    DSS_POOL pool(size);
+    pool.start();
+    for (int i = 1; i <= size; i++)
+    {
+        printf("generate_simple_print_tasks(%d)\n", i);
+        pool.execute(TESTS::generate_simple_print_tasks(i));
+        pool.status();
+    }
+}
+
+UTST_TEST(collatz_conjecture)
+{
+    auto [serial_task, tasks, result_ptr] = TESTS::generate_collatz_conjecture_tasks();
+
+    // Serial execution result
+    TIMER timer("serial");
+    size_t serial_result = serial_task();
+    printf("serial total_num_steps=%lu\n", serial_result);
+    timer.elapsed_start();
+
+    // Serial chunk execution result
+    *result_ptr = 0;
+    TESTS::quick_launch<SERIAL_POOL>(1, tasks);
+    size_t serial_chunk_result = *result_ptr;
+    printf("serial chunk total_num_steps=%lu\n", serial_chunk_result);
+
+    // Pool execution result
+    *result_ptr = 0;
+    TESTS::quick_launch<DSS_POOL>(4, tasks);
+    size_t pool_result = *result_ptr;
+    printf("pool total_num_steps=%lu\n", pool_result);
+
+    UTST_ASSERT_EQUAL(serial_result, serial_chunk_result);
+    UTST_ASSERT_EQUAL(serial_result, pool_result);
+}
+
+UTST_TEST(parallel_for)
+{
+    TESTS::check_parallel_for<DSS_POOL>(4, 0, 100000, 0);
+    TESTS::check_parallel_for<DSS_POOL>(4, 7, 100000, 1);
+    TESTS::check_parallel_for<DSS_POOL>(4, 0, 3, 1000);
+    TESTS::check_parallel_for<DSS_POOL>(1, 0, 1000, 10);
+}
+
+UTST_TEST(policies)
+{
+    auto [serial_task, tasks, result_ptr] = TESTS::generate_collatz_conjecture_tasks();
+    const size_t serial_result = serial_task();
+
+    for (DSS_POLICY policy : {DSS_POLICY::DYNAMIC, DSS_POLICY::GUIDED, DSS_POLICY::FACTORING, DSS_POLICY::TRAPEZOID})
+    {
+        for (size_t chunk_size : {1, 7, 1000000})
+        {
+            *result_ptr = 0;
+            DSS_POOL pool(4, policy, chunk_size);
+            pool.start();
+            pool.execute(tasks);
+            pool.terminate();
+            UTST_ASSERT_EQUAL(serial_result, *result_ptr);
+        }
+    }
+}
+
+UTST_TEST(policies_parallel_for)
+{
+    for (DSS_POLICY policy : {DSS_POLICY::DYNAMIC, DSS_POLICY::GUIDED, DSS_POLICY::FACTORING, DSS_POLICY::TRAPEZOID})
+    {
+        for (size_t grain : {1, 5, 100000})
+        {
+            for (size_t num_iterations : {1, 10, 100000})
+            {
+                std::vector<int> visits(num_iterations);
+                DSS_POOL pool(4, policy);
+                pool.start();
+                ERT::parallel_for(pool, 0, num_iterations, grain, [&visits](size_t i)
+                                  { visits[i]++; });
+                pool.terminate();
+                UTST_ASSERT_EQUAL(num_iterations, static_cast<size_t>(std::count(visits.begin(), visits.end(), 1)));
+            }
+        }
+    }
+}
+
+UTST_TEST(task_graph)
+{
+    TESTS::check_task_graph<DSS_POOL>(4);
+    TESTS::check_task_graph<DSS_POOL>(1);
+}
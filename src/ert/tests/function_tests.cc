@@ -0,0 +1,99 @@
+#define MESSAGE_LEVEL 0
+
+#include <array>
+#include <memory>
+
+#include "function.hpp"
+#include "task.hpp"
+#include "utst.hpp"
+
+using namespace ERT;
+
+UTST_MAIN();
+
+UTST_TEST(inline_storage)
+{
+    int value = 0;
+    RAW_TASK task = [&value]()
+    { value++; };
+    UTST_ASSERT(static_cast<bool>(task));
+    task();
+    task();
+    UTST_ASSERT_EQUAL(value, 2);
+
+    // The ap emitted task captures a handful of words by value
+    auto capture_words = [a = size_t(), b = size_t(), c = size_t(), d = size_t(), e = size_t(), &value]()
+    { value += a + b + c + d + e; };
+    UTST_ASSERT(RAW_TASK::is_inline<decltype(capture_words)>());
+    UTST_ASSERT_EQUAL(sizeof(RAW_TASK), size_t(64));
+}
+
+UTST_TEST(heap_storage)
+{
+    std::array<size_t, 32> big{};
+    big[31] = 7;
+    size_t result = 0;
+    auto big_capture = [big, &result]()
+    { result = big[31]; };
+    UTST_ASSERT(!RAW_TASK::is_inline<decltype(big_capture)>());
+
+    RAW_TASK task = big_capture;
+    RAW_TASK moved = std::move(task);
+    UTST_ASSERT(!static_cast<bool>(task));
+    moved();
+    UTST_ASSERT_EQUAL(result, size_t(7));
+}
+
+UTST_TEST(move_only)
+{
+    auto owned = std::make_unique<int>(5);
+    int result = 0;
+    RAW_TASK task = [owned = std::move(owned), &result]()
+    { result = *owned; };
+
+    std::vector<RAW_TASK> tasks;
+    tasks.emplace_back(std::move(task));
+    tasks.reserve(64); // Relocates the stored callables
+    tasks.front()();
+    UTST_ASSERT_EQUAL(result, 5);
+
+    RAW_TASK assigned;
+    assigned = std::move(tasks.front());
+    result = 0;
+    assigned();
+    UTST_ASSERT_EQUAL(result, 5);
+}
+
+UTST_TEST(destruction)
+{
+    auto counter = std::make_shared<int>(0);
+    {
+        RAW_TASK task = [counter]() {};
+        UTST_ASSERT_EQUAL(counter.use_count(), long(2));
+        RAW_TASK moved = std::move(task);
+        UTST_ASSERT_EQUAL(counter.use_count(), long(2));
+        moved.reset();
+        UTST_ASSERT_EQUAL(counter.use_count(), long(1));
+        moved = [counter]() {};
+    }
+    UTST_ASSERT_EQUAL(counter.use_count(), long(1));
+}
+
+UTST_TEST(arguments)
+{
+    RANGE_BODY body = [](size_t begin, size_t end)
+    { ASSERT(begin + 1 == end); };
+    body(3, 4);
+
+    FUNCTION<size_t(size_t, size_t)> add = [](size_t a, size_t b)
+    { return a + b; };
+    UTST_ASSERT_EQUAL(add(2, 3), size_t(5));
+
+    size_t num_tasks = 0;
+    TASK task = [&num_tasks](WORKER_PROXY &worker_proxy)
+    { num_tasks = worker_proxy.tasks.size(); };
+    WORKER_PROXY worker_proxy;
+    worker_proxy.tasks.emplace_back([](WORKER_PROXY &) {});
+    task(worker_proxy);
+    UTST_ASSERT_EQUAL(num_tasks, size_t(1));
+}
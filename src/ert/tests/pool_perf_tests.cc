@@ -1,55 +1,652 @@
 #define MESSAGE_LEVEL 0
 
+#include "dss_pool.hpp"
+#include "parallel_for.hpp"
+#include "reducer.hpp"
 #include "serial_pool.hpp"
 #include "suap_pool.hpp"
+#include "tests_alloc_counter.hpp"
 #include "tests_helper.hpp"
 #include "tests_kernels.hpp"
 #include "timer.hpp"
 #include "utst.hpp"
+#include "wscl_pool.hpp"
 #include "wspdr_pool.hpp"
+#include "wspds_pool.hpp"
 
 using namespace ERT;
 
 namespace
 {
     constexpr size_t num_workers = 8;
+
+    // Consumes kernel results so that they are not optimized away
+    std::atomic<size_t> sink = 0;
 }
 
 UTST_MAIN();
 
-UTST_TEST(sorting)
+UTST_TEST(idle_session_latency)
 {
-    constexpr size_t num_tasks = 200;
+    constexpr size_t num_sessions = 50;
+    constexpr size_t num_tasks = 256;
+    constexpr size_t idle_ms = 5;
 
-    std::vector<RAW_TASK> tasks = TESTS::generate_sorting_tasks(num_tasks);
+    std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_tasks, [](size_t i)
+                                                          { sink += TESTS::collatz_conjecture_kernel(i * 150, (i + 1) * 150); });
 
-    // TESTS::quick_launch<SERIAL_POOL>(num_workers, tasks);
-    TESTS::quick_launch<SUAP_POOL>(num_workers, tasks);
-    TESTS::quick_launch<WSPDR_POOL>(num_workers, tasks);
+    WSPDR_POOL spinning_pool(num_workers, IDLE_POLICY::spin_forever());
+    spinning_pool.start();
+    const double spinning_latency = TESTS::measure_session_latency("spin_forever", spinning_pool, tasks, num_sessions, idle_ms);
+    spinning_pool.terminate();
+
+    WSPDR_POOL parking_pool(num_workers);
+    parking_pool.start();
+    const double parking_latency = TESTS::measure_session_latency("spin_yield_park", parking_pool, tasks, num_sessions, idle_ms);
+    parking_pool.terminate();
+
+    printf("LATENCY: spin_yield_park / spin_forever = %f\n", parking_latency / spinning_latency);
 }
 
-UTST_TEST(matvecp)
+UTST_TEST(completion_wait_latency)
 {
-    constexpr size_t num_tasks = 200;
+    constexpr size_t num_sessions = 200;
+    constexpr size_t num_tasks = 64;
 
-    std::vector<RAW_TASK> tasks = TESTS::generate_matvecp_tasks(num_tasks);
+    std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_tasks, [](size_t i)
+                                                          { sink += TESTS::collatz_conjecture_kernel(i * 150, (i + 1) * 150); });
 
-    // TESTS::quick_launch<SERIAL_POOL>(num_workers, tasks);
-    TESTS::quick_launch<SUAP_POOL>(num_workers, tasks);
-    TESTS::quick_launch<WSPDR_POOL>(num_workers, tasks);
+    auto run = [&tasks](auto &pool, const char *profile_name, IDLE_POLICY wait_policy)
+    {
+        pool.set_wait_policy(wait_policy);
+        pool.start();
+        TESTS::measure_session_latency(profile_name, pool, tasks, num_sessions, 0);
+        pool.terminate();
+    };
+
+    {
+        SUAP_POOL pool(num_workers);
+        run(pool, "SUAP_POOL/spin", IDLE_POLICY::spin_forever());
+    }
+    {
+        SUAP_POOL pool(num_workers);
+        run(pool, "SUAP_POOL/spin_yield_block", IDLE_POLICY());
+    }
+    {
+        WSPDR_POOL pool(num_workers);
+        run(pool, "WSPDR_POOL/spin", IDLE_POLICY::spin_forever());
+    }
+    {
+        WSPDR_POOL pool(num_workers);
+        run(pool, "WSPDR_POOL/spin_yield_block", IDLE_POLICY());
+    }
 }
 
-UTST_TEST(shared_edge)
+UTST_TEST(long_task_stall)
 {
-    constexpr int n_body = 10000;
+    // The last task seeded is long, and is the first one to be run by the calling thread.
+    // A thief of WSPDR waits for the victim to respond between tasks, while WSCL steals right away.
+    constexpr size_t num_tasks = 64;
+    constexpr size_t num_long_shards = 2000;
 
-    auto out_pos = std::make_unique<std::vector<float>>(3 * n_body);
-    auto out_acc = std::make_unique<std::vector<float>>(3 * n_body);
-    auto out_acc_locks = std::make_unique<std::vector<std::mutex>>(n_body);
-    auto mass = std::make_unique<std::vector<float>>(n_body);
-    std::vector<RAW_TASK> tasks = TESTS::generate_shared_edge_tasks(out_pos.get(), out_acc.get(), out_acc_locks.get(), mass.get());
+    std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_tasks, [](size_t i)
+                                                          {
+                                                              const size_t num_shards = i + 1 == num_tasks ? num_long_shards : 20;
+                                                              sink += TESTS::collatz_conjecture_kernel(i * 150, i * 150 + num_shards * 150); });
 
-    // TESTS::quick_launch<SERIAL_POOL>(num_workers, tasks);
-    TESTS::quick_launch<SUAP_POOL>(num_workers, tasks);
     TESTS::quick_launch<WSPDR_POOL>(num_workers, tasks);
-}
\ No newline at end of file
+    TESTS::quick_launch<WSPDS_POOL>(num_workers, tasks);
+    TESTS::quick_launch<WSCL_POOL>(num_workers, tasks);
+}
+
+UTST_TEST(parallel_for_throughput)
+{
+    constexpr size_t num_iterations = 1000000;
+    std::vector<float> out(num_iterations);
+    auto body = [&out](size_t i)
+    {
+        out[i] = static_cast<float>(i) * 0.5f + 1.0f;
+    };
+
+    auto run = [&body](auto &pool)
+    {
+        pool.start();
+        ERT::TIMER timer(typeid(pool).name());
+        // Materializing one task per iteration
+        std::vector<RAW_TASK> tasks;
+        tasks.reserve(num_iterations);
+        for (size_t i = 0; i < num_iterations; i++)
+        {
+            tasks.emplace_back([i, &body]()
+                               { body(i); });
+        }
+        pool.execute(tasks);
+        timer.elapsed_previous("vector_of_tasks");
+        ERT::parallel_for(pool, 0, num_iterations, 0, body);
+        timer.elapsed_previous("parallel_for");
+        pool.terminate();
+    };
+
+    {
+        SUAP_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSPDR_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSPDS_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSCL_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        DSS_POOL pool(num_workers);
+        run(pool);
+    }
+}
+
+UTST_TEST(dss_policies)
+{
+    // Task costs grow with the index, so that fixed chunks leave the last worker with the heaviest tail
+    constexpr size_t num_tasks = 2048;
+
+    std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_tasks, [](size_t i)
+                                                          { sink += TESTS::collatz_conjecture_kernel(0, i * 4); });
+
+    for (auto [policy, name] : {std::pair{DSS_POLICY::DYNAMIC, "DYNAMIC"}, std::pair{DSS_POLICY::GUIDED, "GUIDED"},
+                                std::pair{DSS_POLICY::FACTORING, "FACTORING"}, std::pair{DSS_POLICY::TRAPEZOID, "TRAPEZOID"}})
+    {
+        DSS_POOL pool(num_workers, policy);
+        pool.start();
+        {
+            ERT::TIMER timer(name);
+            pool.execute(tasks);
+        }
+        pool.terminate();
+    }
+}
+
+UTST_TEST(task_allocations)
+{
+    constexpr size_t num_tasks = 4096;
+    // Sized like the captures of a loop body emitted by ap
+    struct CAPTURE
+    {
+        size_t values[5];
+    };
+    auto make_task = [](size_t i)
+    {
+        return [capture = CAPTURE{i, i, i, i, i}]()
+        { sink += capture.values[0]; };
+    };
+
+    {
+        TESTS::ALLOC_COUNTER counter("std::function");
+        std::vector<std::function<void()>> tasks;
+        tasks.reserve(num_tasks);
+        for (size_t i = 0; i < num_tasks; i++)
+        {
+            tasks.emplace_back(make_task(i));
+        }
+        counter.report("construct");
+    }
+
+    std::vector<RAW_TASK> tasks;
+    {
+        TESTS::ALLOC_COUNTER counter("RAW_TASK");
+        tasks.reserve(num_tasks);
+        for (size_t i = 0; i < num_tasks; i++)
+        {
+            tasks.emplace_back(make_task(i));
+        }
+        counter.report("construct");
+    }
+
+    // Steady state allocations of a session, after a warm up session
+    auto run = [&tasks](auto &pool)
+    {
+        pool.start();
+        pool.execute(tasks);
+        TESTS::ALLOC_COUNTER counter(typeid(pool).name());
+        pool.execute(tasks);
+        counter.report("execute");
+        pool.terminate();
+    };
+
+    {
+        SUAP_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSPDR_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSPDS_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSCL_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        DSS_POOL pool(num_workers);
+        run(pool);
+    }
+}
+
+UTST_TEST(collatz_allocations)
+{
+    auto [serial_task, tasks, result_ptr] = TESTS::generate_collatz_conjecture_tasks();
+    const size_t serial_result = serial_task();
+
+    // Allocations of a steady state session over the 30,000 tasks, run in place from the caller's buffer
+    auto run = [&tasks = tasks, &result_ptr = result_ptr, serial_result](auto &pool)
+    {
+        pool.start();
+        pool.execute(tasks);
+        *result_ptr = 0;
+        {
+            TESTS::ALLOC_COUNTER counter(typeid(pool).name());
+            pool.execute(tasks.data(), tasks.size());
+            counter.report("execute");
+        }
+        ASSERT(*result_ptr == serial_result);
+        *result_ptr = 0;
+        {
+            // Range tasks split into new tasks while running
+            TESTS::ALLOC_COUNTER counter(typeid(pool).name());
+            ERT::parallel_for(pool, 0, tasks.size(), 1, [&tasks = tasks](size_t i)
+                              { tasks[i](); });
+            counter.report("parallel_for");
+        }
+        ASSERT(*result_ptr == serial_result);
+        pool.terminate();
+    };
+
+    {
+        SERIAL_POOL pool(1);
+        run(pool);
+    }
+    {
+        SUAP_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSPDR_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSPDS_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSCL_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        DSS_POOL pool(num_workers);
+        run(pool);
+    }
+}
+
+UTST_TEST(nested_matvecp)
+{
+    // The allocation phase of matvecp_bm, scaled down: an outer loop over matrices, with an inner loop over rows
+    constexpr size_t num_iterations = 100;
+
+    std::vector<std::vector<float *>> matrices(num_iterations);
+    for (size_t iteration = 0; iteration < num_iterations; iteration++)
+    {
+        matrices[iteration].resize(1 + iteration * 10);
+    }
+    auto allocate_row = [&matrices](size_t iteration, size_t i)
+    {
+        const size_t n = matrices[iteration].size();
+        float *row = new float[n];
+        std::fill(row, row + n, 1.0f);
+        matrices[iteration][i] = row;
+    };
+    auto free_rows = [&matrices]()
+    {
+        for (auto &matrix : matrices)
+        {
+            for (float *&row : matrix)
+            {
+                delete[] row;
+                row = nullptr;
+            }
+        }
+    };
+
+    WSPDR_POOL pool(num_workers);
+    pool.start();
+    {
+        // Serial outer loop, with a session per inner loop
+        ERT::TIMER timer("WSPDR inner sessions");
+        for (size_t iteration = 0; iteration < num_iterations; iteration++)
+        {
+            std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(matrices[iteration].size(), [&allocate_row, iteration](size_t i)
+                                                                  { allocate_row(iteration, i); });
+            pool.execute(tasks);
+        }
+    }
+    free_rows();
+    {
+        // A single session over the outer loop, with serial inner loops
+        ERT::TIMER timer("WSPDR outer session");
+        std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_iterations, [&](size_t iteration)
+                                                              {
+                                                                  for (size_t i = 0; i < matrices[iteration].size(); i++)
+                                                                  {
+                                                                      allocate_row(iteration, i);
+                                                                  } });
+        pool.execute(tasks);
+    }
+    free_rows();
+    {
+        // A single session over the outer loop, spawning the inner loops into task groups
+        ERT::TIMER timer("WSPDR outer session, inner task groups");
+        std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_iterations, [&](size_t iteration)
+                                                              {
+                                                                  TASK_GROUP task_group;
+                                                                  const size_t n = matrices[iteration].size();
+                                                                  constexpr size_t grain = 64;
+                                                                  for (size_t i_begin = 0; i_begin < n; i_begin += grain)
+                                                                  {
+                                                                      task_group.spawn([&allocate_row, iteration, i_begin, i_end = std::min(n, i_begin + grain)]()
+                                                                                       {
+                                                                                           for (size_t i = i_begin; i < i_end; i++)
+                                                                                           {
+                                                                                               allocate_row(iteration, i);
+                                                                                           } });
+                                                                  }
+                                                                  task_group.wait(); });
+        pool.execute(tasks);
+    }
+    for (const auto &matrix : matrices)
+    {
+        for (float *row : matrix)
+        {
+            UTST_ASSERT(row && row[0] == 1.0f);
+        }
+    }
+    free_rows();
+    pool.terminate();
+}
+
+UTST_TEST(sorting_pipeline)
+{
+    // The allocate, sort and free loops of sorting_bm, scaled down, where iteration i of a loop
+    // only depends on iteration i of the previous loop
+    constexpr size_t num_iterations = 200;
+    constexpr size_t scale = 5;
+
+    std::vector<float *> vecs(num_iterations, nullptr);
+    auto allocate_vec = [&vecs](size_t i)
+    { vecs[i] = new float[1 + i * scale]; };
+    auto sort_vec = [&vecs](size_t i)
+    {
+        const size_t n = 1 + i * scale;
+        int seed = static_cast<int>(i);
+        for (size_t j = 0; j < n; j++)
+        {
+            seed = seed * 0x343fd + 0x269EC3;
+            vecs[i][j] = static_cast<float>(seed / 65536 & 0x7FFF);
+        }
+        // Bubble sort
+        for (size_t j = 0; j + 1 < n; j++)
+        {
+            for (size_t k = 0; k + j + 1 < n; k++)
+            {
+                if (vecs[i][k] > vecs[i][k + 1])
+                {
+                    std::swap(vecs[i][k], vecs[i][k + 1]);
+                }
+            }
+        }
+        sink += static_cast<size_t>(vecs[i][n - 1]);
+    };
+    auto free_vec = [&vecs](size_t i)
+    {
+        delete[] vecs[i];
+        vecs[i] = nullptr;
+    };
+
+    TASK_GRAPH graph;
+    graph.chain_loop(graph.chain_loop(graph.add_loop(num_iterations, allocate_vec), sort_vec), free_vec);
+
+    auto run = [&](POOL &pool)
+    {
+        pool.start();
+        {
+            // A session per loop, as generated by apert_gen
+            ERT::TIMER timer(std::string(typeid(pool).name()) + " sessions");
+            pool.execute(TESTS::generate_n_tasks(num_iterations, allocate_vec));
+            pool.execute(TESTS::generate_n_tasks(num_iterations, sort_vec));
+            pool.execute(TESTS::generate_n_tasks(num_iterations, free_vec));
+        }
+        {
+            ERT::TIMER timer(std::string(typeid(pool).name()) + " graph");
+            pool.execute_graph(graph);
+        }
+        UTST_ASSERT(std::all_of(vecs.begin(), vecs.end(), [](float *vec)
+                                { return vec == nullptr; }));
+        pool.terminate();
+    };
+
+    {
+        SUAP_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSPDR_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSPDS_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSCL_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        DSS_POOL pool(num_workers);
+        run(pool);
+    }
+}
+
+UTST_TEST(reductions)
+{
+    // Short iterations, so that the cost of a shared update is not hidden by the kernel
+    constexpr size_t num_iterations = 1000000;
+    constexpr size_t num_bins = 64;
+
+    auto run = [&](POOL &pool)
+    {
+        const std::string pool_name = typeid(pool).name();
+        pool.start();
+
+        // Sum
+        {
+            std::atomic<size_t> sum = 0;
+            {
+                ERT::TIMER timer(pool_name + " sum atomic");
+                parallel_for(pool, 0, num_iterations, 0, [&sum](size_t i)
+                             { sum += i % 7; });
+            }
+            REDUCER<size_t> reducer(pool);
+            {
+                ERT::TIMER timer(pool_name + " sum REDUCER");
+                parallel_for(pool, 0, num_iterations, 0, [&reducer](size_t i)
+                             { reducer.update(i % 7); });
+            }
+            UTST_ASSERT_EQUAL(sum.load(), reducer.result());
+        }
+
+        // Scattered accumulation into an array, as with the per-body locks of shared_edge
+        {
+            std::vector<size_t> bins(num_bins, 0);
+            std::vector<std::mutex> bin_locks(num_bins);
+            {
+                ERT::TIMER timer(pool_name + " histogram mutex");
+                parallel_for(pool, 0, num_iterations, 0, [&](size_t i)
+                             {
+                                 const size_t bin = (i * 2654435761u) % num_bins;
+                                 std::lock_guard<std::mutex> lock_guard(bin_locks[bin]);
+                                 bins[bin]++; });
+            }
+            ARRAY_REDUCER<size_t> reducer(pool, num_bins);
+            {
+                ERT::TIMER timer(pool_name + " histogram ARRAY_REDUCER");
+                parallel_for(pool, 0, num_iterations, 0, [&](size_t i)
+                             { reducer.update((i * 2654435761u) % num_bins, 1); });
+            }
+            UTST_ASSERT(bins == reducer.result());
+        }
+        pool.terminate();
+    };
+
+    {
+        SUAP_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSPDR_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSPDS_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        WSCL_POOL pool(num_workers);
+        run(pool);
+    }
+    {
+        DSS_POOL pool(num_workers);
+        run(pool);
+    }
+}
+
+UTST_TEST(placement_scaling)
+{
+    // The collatz and matvecp kernels over 1, 2, 4 and 8 workers, for each placement of the workers
+    std::vector<RAW_TASK> collatz_tasks = TESTS::generate_n_tasks(3000, [](size_t i)
+                                                                  { sink += TESTS::collatz_conjecture_kernel(i * 150, (i + 1) * 150); });
+    std::vector<RAW_TASK> matvecp_tasks = TESTS::generate_matvecp_tasks(40);
+
+    for (auto [placement, placement_name] : {std::pair{PLACEMENT::none(), "none"}, std::pair{PLACEMENT::compact(), "compact"},
+                                             std::pair{PLACEMENT::scatter(), "scatter"}, std::pair{PLACEMENT::physical_cores(), "physical_cores"}})
+    {
+        for (size_t n_workers = 1; n_workers <= num_workers; n_workers *= 2)
+        {
+            const std::string profile_name = std::string(placement_name) + " x" + std::to_string(n_workers);
+            {
+                SUAP_POOL pool(n_workers);
+                pool.set_placement(placement);
+                pool.start();
+                ERT::TIMER timer("SUAP collatz " + profile_name);
+                pool.execute(collatz_tasks);
+            }
+            {
+                WSPDR_POOL pool(n_workers);
+                pool.set_placement(placement);
+                pool.start();
+                ERT::TIMER timer("WSPDR matvecp " + profile_name);
+                pool.execute(matvecp_tasks);
+            }
+        }
+    }
+}
+
+UTST_TEST(victim_selection)
+{
+    // Many short tasks, so that the workers keep stealing, with the steal counts and latencies in the status
+    constexpr size_t num_tasks = 100000;
+
+    std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_tasks, [](size_t i)
+                                                          { sink += TESTS::collatz_conjecture_kernel(i, i + 20); });
+    for (auto [placement, placement_name] : {std::pair{PLACEMENT::none(), "none"}, std::pair{PLACEMENT::compact(), "compact"},
+                                             std::pair{PLACEMENT::scatter(), "scatter"}})
+    {
+        WSPDR_POOL pool(num_workers);
+        pool.set_placement(placement);
+        pool.set_seed(2024);
+        pool.start();
+        {
+            ERT::TIMER timer(std::string("WSPDR victim selection ") + placement_name);
+            pool.execute(tasks);
+        }
+        pool.status();
+    }
+}
+
+UTST_TEST(wspdr_policies)
+{
+    // The best steal amount depends on the workload, see pool_perf_data.txt
+    std::vector<std::pair<const char *, std::vector<RAW_TASK>>> workloads;
+    workloads.emplace_back("sorting", TESTS::generate_sorting_tasks(40));
+    workloads.emplace_back("matvecp", TESTS::generate_matvecp_tasks(60));
+    workloads.emplace_back("short", TESTS::generate_n_tasks(50000, [](size_t i)
+                                                            { sink += TESTS::collatz_conjecture_kernel(i, i + 20); }));
+    workloads.emplace_back("growing", TESTS::generate_n_tasks(1024, [](size_t i)
+                                                              { sink += TESTS::collatz_conjecture_kernel(0, i * 4); }));
+
+    for (const auto &[workload_name, tasks] : workloads)
+    {
+        for (auto [policy, policy_name] : {std::pair{WSPDR_POLICY::STEAL_ONE, "STEAL_ONE"}, std::pair{WSPDR_POLICY::STEAL_HALF, "STEAL_HALF"},
+                                           std::pair{WSPDR_POLICY::ADAPTIVE, "ADAPTIVE"}})
+        {
+            WSPDR_POOL pool(num_workers, policy);
+            pool.start();
+            ERT::TIMER timer(std::string("WSPDR ") + workload_name + " " + policy_name);
+            pool.execute(tasks);
+        }
+    }
+}
+
+UTST_TEST(scheduling_stats)
+{
+    // Per-worker counters and the load imbalance of a skewed session, as CSV,
+    // with IPC and LLC misses where the hardware counters are available
+    std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(1024, [](size_t i)
+                                                          { sink += TESTS::collatz_conjecture_kernel(0, i * 4); });
+    auto run = [&tasks](POOL &pool, const char *pool_name)
+    {
+        pool.set_perf_counting(true);
+        pool.start();
+        pool.set_stats_timing(true);
+        const POOL_STATS before = pool.stats();
+        pool.execute(tasks);
+        const POOL_STATS session = pool.stats() - before;
+        const PERF_COUNTS perf = session.total().perf;
+        printf("STATS: %s imbalance=%f, ipc=%f, llc_mpki=%f, context_switches=%lu\n%s", pool_name, session.imbalance(), perf.ipc(), perf.llc_mpki(),
+               perf[PERF_EVENT::CONTEXT_SWITCHES], session.to_csv().c_str());
+    };
+    {
+        SUAP_POOL pool(num_workers);
+        run(pool, "SUAP");
+    }
+    {
+        DSS_POOL pool(num_workers);
+        run(pool, "DSS");
+    }
+    {
+        WSPDR_POOL pool(num_workers);
+        run(pool, "WSPDR");
+    }
+    {
+        WSPDS_POOL pool(num_workers);
+        run(pool, "WSPDS");
+    }
+    {
+        WSCL_POOL pool(num_workers);
+        run(pool, "WSCL");
+    }
+}
@@ -0,0 +1,156 @@
+#define MESSAGE_LEVEL 0
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "dss_pool.hpp"
+#include "parallel_for.hpp"
+#include "reducer.hpp"
+#include "serial_pool.hpp"
+#include "suap_pool.hpp"
+#include "tests_kernels.hpp"
+#include "utst.hpp"
+#include "worker_local.hpp"
+#include "wscl_pool.hpp"
+#include "wspdr_pool.hpp"
+#include "wspds_pool.hpp"
+
+using namespace ERT;
+
+namespace
+{
+    constexpr size_t num_workers = 4;
+
+    struct BITWISE_OR_OP
+    {
+        uint64_t operator()(uint64_t a, uint64_t b) const { return a | b; }
+    };
+
+    template <typename POOL_IF>
+    void check_reducers()
+    {
+        constexpr size_t num_iterations = 10000;
+        constexpr size_t num_bins = 17;
+
+        POOL_IF pool(num_workers);
+        pool.start();
+
+        REDUCER<size_t> sum(pool);
+        MIN_REDUCER<size_t> min(pool);
+        MAX_REDUCER<size_t> max(pool);
+        REDUCER<uint64_t, BITWISE_OR_OP> bits(pool, 0);
+        ARRAY_REDUCER<size_t> histogram(pool, num_bins);
+        WORKER_LOCAL<size_t> num_runs(pool);
+        for (int session = 0; session < 2; session++)
+        {
+            parallel_for(pool, 0, num_iterations, 0, [&](size_t i)
+                         {
+                             const size_t num_steps = TESTS::collatz_conjecture_kernel(i, i + 1);
+                             sum.update(num_steps);
+                             min.update(i + 5);
+                             max.update(i + 5);
+                             bits.update(uint64_t(1) << (i % 64));
+                             histogram.update(i % num_bins, 1);
+                             num_runs.local()++; });
+
+            UTST_ASSERT_EQUAL(sum.result(), TESTS::collatz_conjecture_kernel(0, num_iterations));
+            UTST_ASSERT_EQUAL(min.result(), size_t(5));
+            UTST_ASSERT_EQUAL(max.result(), num_iterations + 4);
+            UTST_ASSERT_EQUAL(bits.result(), ~uint64_t(0));
+            const std::vector<size_t> bins = histogram.result();
+            for (size_t bin = 0; bin < num_bins; bin++)
+            {
+                UTST_ASSERT_EQUAL(bins[bin], num_iterations / num_bins + (bin < num_iterations % num_bins ? 1 : 0));
+            }
+            size_t total_runs = 0;
+            num_runs.for_each([&total_runs](size_t n)
+                              { total_runs += n; });
+            UTST_ASSERT_EQUAL(total_runs, num_iterations);
+
+            sum.reset();
+            min.reset();
+            max.reset();
+            bits.reset();
+            histogram.reset();
+            num_runs.for_each([](size_t &n)
+                              { n = 0; });
+        }
+    }
+}
+
+UTST_MAIN();
+
+UTST_TEST(worker_index)
+{
+    // Outside of a pool, the calling thread is worker 0
+    UTST_ASSERT_EQUAL(WORKER_INDEX::current(), size_t(0));
+    {
+        WORKER_INDEX::SCOPE scope(3);
+        UTST_ASSERT_EQUAL(WORKER_INDEX::current(), size_t(3));
+    }
+    UTST_ASSERT_EQUAL(WORKER_INDEX::current(), size_t(0));
+
+    // Every task sees the index of a worker of its pool
+    WSPDR_POOL pool(num_workers);
+    pool.start();
+    WORKER_LOCAL<size_t> num_runs(pool);
+    std::atomic<size_t> num_out_of_range = 0;
+    parallel_for(pool, 0, 1000, 1, [&](size_t)
+                 {
+                     if (WORKER_INDEX::current() >= pool.num_workers())
+                     {
+                         num_out_of_range++;
+                     }
+                     num_runs.local()++; });
+    UTST_ASSERT_EQUAL(num_out_of_range.load(), size_t(0));
+    size_t total_runs = 0;
+    for (size_t worker_index = 0; worker_index < num_runs.size(); worker_index++)
+    {
+        total_runs += num_runs[worker_index];
+    }
+    UTST_ASSERT_EQUAL(total_runs, size_t(1000));
+}
+
+UTST_TEST(worker_local_padding)
+{
+    WORKER_LOCAL<char> chars(num_workers);
+    UTST_ASSERT(reinterpret_cast<uintptr_t>(&chars[1]) - reinterpret_cast<uintptr_t>(&chars[0]) >= CACHE_LINE_SIZE);
+}
+
+UTST_TEST(reducer_identities)
+{
+    // Neutral for every value, so that the workers without any update leave the result alone:
+    // two iterations on four workers with static shares
+    SUAP_POOL pool(num_workers);
+    pool.start();
+    MIN_REDUCER<size_t> min(pool);
+    MAX_REDUCER<int> max(pool);
+    MAX_REDUCER<double> max_double(pool);
+    ARRAY_REDUCER<int, MAX_OP<int>> maxes(pool, 2);
+    REDUCER<int> sum(pool);
+    UTST_ASSERT_EQUAL(min.result(), std::numeric_limits<size_t>::max());
+    UTST_ASSERT_EQUAL(max_double.result(), std::numeric_limits<double>::lowest());
+    UTST_ASSERT_EQUAL(sum.result(), 0);
+    parallel_for(pool, 0, 2, 0, [&](size_t i)
+                 {
+                     min.update(i + 7);
+                     max.update(-static_cast<int>(i) - 3);
+                     max_double.update(-1.5 * i - 1);
+                     maxes.update(i % 2, -static_cast<int>(i)); });
+    UTST_ASSERT_EQUAL(min.result(), size_t(7));
+    UTST_ASSERT_EQUAL(max.result(), -3);
+    UTST_ASSERT_EQUAL(max_double.result(), -1.0);
+    UTST_ASSERT((maxes.result() == std::vector<int>{0, -1}));
+}
+
+UTST_TEST(reducers)
+{
+    check_reducers<SERIAL_POOL>();
+    check_reducers<SUAP_POOL>();
+    check_reducers<WSPDR_POOL>();
+    check_reducers<WSPDS_POOL>();
+    check_reducers<WSCL_POOL>();
+    check_reducers<DSS_POOL>();
+}
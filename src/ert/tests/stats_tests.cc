@@ -0,0 +1,199 @@
+#define MESSAGE_LEVEL 0
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dss_pool.hpp"
+#include "serial_pool.hpp"
+#include "stats.hpp"
+#include "suap_pool.hpp"
+#include "tests_kernels.hpp"
+#include "utst.hpp"
+#include "wscl_pool.hpp"
+#include "wspdr_pool.hpp"
+#include "wspds_pool.hpp"
+
+using namespace ERT;
+
+namespace
+{
+    constexpr size_t num_workers = 4;
+
+    size_t count_lines(const std::string &text)
+    {
+        size_t num_lines = 0;
+        for (char c : text)
+        {
+            num_lines += c == '\n' ? 1 : 0;
+        }
+        return num_lines;
+    }
+
+    // is_chunked: a pool that counts chunks of tasks instead of single tasks
+    template <typename POOL_IF>
+    void check_stats(bool is_chunked = false)
+    {
+        constexpr size_t num_tasks = 1000;
+        constexpr size_t num_sessions = 3;
+
+        POOL_IF pool(num_workers);
+        pool.start();
+        std::vector<size_t> results(num_tasks, 0);
+        std::vector<RAW_TASK> tasks;
+        for (size_t itask = 0; itask < num_tasks; itask++)
+        {
+            tasks.emplace_back([&results, itask]()
+                               { results[itask] = TESTS::collatz_conjecture_kernel(itask, itask + 1); });
+        }
+
+        // Counters only
+        const POOL_STATS initial = pool.stats();
+        UTST_ASSERT_EQUAL(initial.workers.size(), pool.num_workers());
+        UTST_ASSERT_EQUAL(initial.total().num_tasks, size_t(0));
+        for (size_t session = 0; session < num_sessions; session++)
+        {
+            pool.execute(tasks);
+        }
+        const POOL_STATS counted = pool.stats() - initial;
+        const WORKER_STATS counted_total = counted.total();
+        if (is_chunked)
+        {
+            UTST_ASSERT(counted_total.num_tasks > 0 && counted_total.num_tasks <= num_sessions * num_tasks);
+        }
+        else
+        {
+            UTST_ASSERT_EQUAL(counted_total.num_tasks, num_sessions * num_tasks);
+        }
+        UTST_ASSERT(counted_total.num_sessions >= num_sessions);
+        for (const WORKER_STATS &worker : counted.workers)
+        {
+            UTST_ASSERT(worker.num_sessions <= num_sessions);
+            UTST_ASSERT(worker.num_steals <= worker.num_steal_attempts);
+        }
+        UTST_ASSERT_EQUAL(counted_total.busy_time, 0.0);
+        UTST_ASSERT_EQUAL(counted.imbalance(), 0.0);
+
+        // With timing, a single session
+        pool.set_stats_timing(true);
+        const POOL_STATS before = pool.stats();
+        pool.execute(tasks);
+        const POOL_STATS timed = pool.stats() - before;
+        UTST_ASSERT(timed.total().busy_time > 0);
+        UTST_ASSERT(timed.imbalance() >= 1.0);
+        UTST_ASSERT(timed.imbalance() <= double(pool.num_workers()));
+
+        const std::string csv = timed.to_csv();
+        UTST_ASSERT_EQUAL(csv.rfind("worker,tasks,steal_attempts,steals,tasks_given,sessions,busy_time,idle_time,steal_wait_time,"
+                                    "cycles,instructions,llc_misses,context_switches,cpu_migrations\n",
+                                    0),
+                          size_t(0));
+        UTST_ASSERT_EQUAL(count_lines(csv), pool.num_workers() + 1);
+        const std::string json = timed.to_json();
+        UTST_ASSERT_EQUAL(json.rfind("{\"imbalance\": ", 0), size_t(0));
+        UTST_ASSERT(json.find("{\"worker\": 0, \"tasks\": ") != std::string::npos);
+        UTST_ASSERT_EQUAL(json.back(), '}');
+    }
+}
+
+UTST_MAIN();
+
+UTST_TEST(recorder)
+{
+    STATS_RECORDER recorder;
+    recorder.count_tasks(3);
+    recorder.count_steal_attempt(true);
+    recorder.count_steal_attempt(false);
+    recorder.count_tasks_given(2);
+    recorder.join_session(1);
+    recorder.join_session(1);
+    recorder.join_session(2);
+    recorder.run_busy([]() {});
+    const WORKER_STATS stats = recorder.snapshot();
+    UTST_ASSERT_EQUAL(stats.num_tasks, size_t(3));
+    UTST_ASSERT_EQUAL(stats.num_steal_attempts, size_t(2));
+    UTST_ASSERT_EQUAL(stats.num_steals, size_t(1));
+    UTST_ASSERT_EQUAL(stats.num_tasks_given, size_t(2));
+    UTST_ASSERT_EQUAL(stats.num_sessions, size_t(2));
+    UTST_ASSERT_EQUAL(stats.busy_time, 0.0);
+
+    // Nested busy time is counted once
+    recorder.set_timing(true);
+    recorder.run_busy([&recorder]()
+                      { recorder.run_busy([]() {}); });
+    const double busy_time = recorder.snapshot().busy_time;
+    UTST_ASSERT(busy_time > 0);
+}
+
+UTST_TEST(imbalance)
+{
+    POOL_STATS stats;
+    UTST_ASSERT_EQUAL(stats.imbalance(), 0.0);
+    stats.workers.resize(4);
+    stats.workers[0].busy_time = 4;
+    stats.workers[1].busy_time = 2;
+    stats.workers[2].busy_time = 1;
+    stats.workers[3].busy_time = 1;
+    UTST_ASSERT_EQUAL(stats.imbalance(), 2.0);
+    POOL_STATS before;
+    before.workers.resize(4);
+    before.workers[0].busy_time = 3;
+    before.workers[1].busy_time = 1;
+    UTST_ASSERT_EQUAL((stats - before).imbalance(), 1.0);
+}
+
+UTST_TEST(pools)
+{
+    check_stats<SERIAL_POOL>();
+    check_stats<SUAP_POOL>();
+    check_stats<WSPDR_POOL>();
+    check_stats<WSPDS_POOL>();
+    check_stats<WSCL_POOL>();
+    check_stats<DSS_POOL>(true);
+}
+
+UTST_TEST(perf_counters)
+{
+    // Whichever counters the kernel allows, possibly none
+    PERF_COUNTERS counters;
+    const bool is_open = counters.open();
+    UTST_ASSERT_EQUAL(counters.is_open(), is_open);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    const PERF_COUNTS counts = counters.read();
+    UTST_ASSERT_EQUAL(counts.available != 0, is_open);
+    if (counts.is_available(PERF_EVENT::CONTEXT_SWITCHES))
+    {
+        UTST_ASSERT(counts[PERF_EVENT::CONTEXT_SWITCHES] > 0); // Slept
+    }
+    counters.close();
+    UTST_ASSERT_EQUAL(counters.read().available, uint32_t(0));
+
+    // Every worker counts with the same counters once its executor runs, cumulated over sessions
+    WSPDR_POOL pool(num_workers);
+    pool.set_perf_counting(true);
+    pool.start();
+    std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(1000, [](size_t i)
+                                                          { TESTS::collatz_conjecture_kernel(i, i + 100); });
+    pool.execute(tasks);
+    const POOL_STATS first = pool.stats();
+    pool.execute(tasks);
+    const POOL_STATS session = pool.stats() - first;
+    UTST_ASSERT_EQUAL(session.workers[0].perf.available, counts.available);
+    for (size_t worker_id = 1; worker_id < num_workers; worker_id++)
+    {
+        const uint32_t available = session.workers[worker_id].perf.available;
+        UTST_ASSERT(available == counts.available || available == 0);
+    }
+    if (counts.is_available(PERF_EVENT::INSTRUCTIONS))
+    {
+        UTST_ASSERT(session.workers[0].perf[PERF_EVENT::INSTRUCTIONS] > 0);
+        UTST_ASSERT(session.total().perf.ipc() > 0);
+    }
+
+    // Not counting by default
+    SUAP_POOL quiet_pool(num_workers);
+    quiet_pool.start();
+    quiet_pool.execute(tasks);
+    UTST_ASSERT_EQUAL(quiet_pool.stats().total().perf.available, uint32_t(0));
+}
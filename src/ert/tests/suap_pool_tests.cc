@@ -1,7 +1,12 @@
 #define MESSAGE_LEVEL 0
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <stdexcept>
+#include <vector>
 
 #include "tests_helper.hpp"
 #include "tests_kernels.hpp"
@@ -61,4 +66,155 @@ UTST_TEST(collatz_conjecture)
 
     UTST_ASSERT_EQUAL(serial_result, serial_chunk_result);
     UTST_ASSERT_EQUAL(serial_result, pool_result);
-}
\ No newline at end of file
+}
+
+UTST_TEST(parallel_for)
+{
+    TESTS::check_parallel_for<SUAP_POOL>(4, 0, 100000, 0);
+    TESTS::check_parallel_for<SUAP_POOL>(4, 7, 100000, 1);
+    TESTS::check_parallel_for<SUAP_POOL>(4, 0, 3, 1000);
+    TESTS::check_parallel_for<SUAP_POOL>(1, 0, 1000, 10);
+}
+
+UTST_TEST(task_graph)
+{
+    TESTS::check_task_graph<SUAP_POOL>(4);
+    TESTS::check_task_graph<SUAP_POOL>(1);
+}
+
+namespace
+{
+    // The worker that ran each of num_tasks tasks
+    std::vector<size_t> run_owners(SUAP_POOL &pool, size_t num_tasks)
+    {
+        std::vector<size_t> owners(num_tasks, SIZE_MAX);
+        pool.execute(TESTS::generate_n_tasks(num_tasks, [&owners](size_t i)
+                                             { owners[i] = WORKER_INDEX::current(); }));
+        return owners;
+    }
+}
+
+UTST_TEST(partitions)
+{
+    SUAP_POOL block_pool(4, SUAP_PARTITION::BLOCK);
+    block_pool.start();
+    const std::vector<size_t> block_owners = run_owners(block_pool, 10);
+    UTST_ASSERT((block_owners == std::vector<size_t>{0, 0, 0, 1, 1, 1, 2, 2, 2, 3}));
+    // Fewer tasks than workers leave the last shares empty
+    const std::vector<SUAP_SHARE> block_shares = block_pool.partition(0, 2);
+    UTST_ASSERT(!block_shares[1].empty());
+    UTST_ASSERT(block_shares[2].empty());
+    UTST_ASSERT(block_shares[3].empty());
+    UTST_ASSERT((run_owners(block_pool, 2) == std::vector<size_t>{0, 1}));
+
+    SUAP_POOL cyclic_pool(4, SUAP_PARTITION::CYCLIC);
+    cyclic_pool.start();
+    const std::vector<size_t> cyclic_owners = run_owners(cyclic_pool, 10);
+    UTST_ASSERT((cyclic_owners == std::vector<size_t>{0, 1, 2, 3, 0, 1, 2, 3, 0, 1}));
+
+    SUAP_POOL block_cyclic_pool(4, SUAP_PARTITION::BLOCK_CYCLIC, 3);
+    block_cyclic_pool.start();
+    const std::vector<size_t> block_cyclic_owners = run_owners(block_cyclic_pool, 20);
+    for (size_t i = 0; i < block_cyclic_owners.size(); i++)
+    {
+        UTST_ASSERT_EQUAL(block_cyclic_owners[i], (i / 3) % 4);
+    }
+
+    // Ranges follow the same partition, each chunk of a share in a call of body
+    std::vector<size_t> range_owners(100, SIZE_MAX);
+    std::atomic<size_t> num_calls = 0;
+    block_cyclic_pool.execute_range(1000, 1100, 1, [&](size_t chunk_begin, size_t chunk_end)
+                                    {
+                                        num_calls++;
+                                        for (size_t i = chunk_begin; i < chunk_end; i++)
+                                        {
+                                            range_owners[i - 1000] = WORKER_INDEX::current();
+                                        } });
+    UTST_ASSERT_EQUAL(num_calls.load(), size_t((100 - 1) / 3 + 1));
+    for (size_t i = 0; i < range_owners.size(); i++)
+    {
+        UTST_ASSERT_EQUAL(range_owners[i], (i / 3) % 4);
+    }
+}
+
+UTST_TEST(weighted_partition)
+{
+    // With cost(i) = i^2, the share of worker w starts near n * cbrt(w / P)
+    const size_t num_tasks = 1000;
+    auto cost = [](size_t i)
+    { return static_cast<double>(i) * i; };
+    SUAP_POOL pool(4, SUAP_PARTITION::WEIGHTED);
+    pool.set_cost(cost);
+    pool.start();
+    const std::vector<size_t> owners = run_owners(pool, num_tasks);
+    UTST_ASSERT(std::is_sorted(owners.begin(), owners.end()));
+    UTST_ASSERT_EQUAL(owners.front(), size_t(0));
+    UTST_ASSERT_EQUAL(owners.back(), size_t(3));
+
+    double total_cost = 0;
+    std::vector<double> worker_costs(4, 0);
+    for (size_t i = 0; i < num_tasks; i++)
+    {
+        total_cost += cost(i);
+        worker_costs[owners[i]] += cost(i);
+    }
+    for (size_t worker_id = 0; worker_id < 4; worker_id++)
+    {
+        const size_t share_begin = std::find(owners.begin(), owners.end(), worker_id) - owners.begin();
+        const double expected_begin = num_tasks * std::cbrt(worker_id / 4.0);
+        UTST_ASSERT(std::abs(share_begin - expected_begin) <= 2);
+        // Balanced within the cost of a single task
+        UTST_ASSERT(std::abs(worker_costs[worker_id] - total_cost / 4) <= cost(num_tasks - 1));
+    }
+
+    // Ranges are weighted by the cost of their iterations
+    const std::vector<SUAP_SHARE> shares = pool.partition(500, 1000);
+    UTST_ASSERT_EQUAL(shares.front().begin, size_t(500));
+    UTST_ASSERT_EQUAL(shares.back().end, size_t(1000));
+    for (size_t worker_id = 1; worker_id < 4; worker_id++)
+    {
+        UTST_ASSERT_EQUAL(shares[worker_id].begin, shares[worker_id - 1].end);
+        // Later iterations cost more, so later shares are shorter
+        UTST_ASSERT(shares[worker_id].end - shares[worker_id].begin < shares[worker_id - 1].end - shares[worker_id - 1].begin);
+    }
+}
+
+UTST_TEST(weighted_partition_zero_cost)
+{
+    // Nothing to weigh by, the shares are even as with SUAP_PARTITION::BLOCK
+    SUAP_POOL pool(4, SUAP_PARTITION::WEIGHTED);
+    pool.set_cost([](size_t)
+                  { return 0.0; });
+    SUAP_POOL block_pool(4, SUAP_PARTITION::BLOCK);
+    for (size_t end : {size_t(1), size_t(3), size_t(1000)})
+    {
+        const std::vector<SUAP_SHARE> shares = pool.partition(0, end);
+        const std::vector<SUAP_SHARE> block_shares = block_pool.partition(0, end);
+        for (size_t worker_id = 0; worker_id < 4; worker_id++)
+        {
+            UTST_ASSERT_EQUAL(shares[worker_id].begin, block_shares[worker_id].begin);
+            UTST_ASSERT_EQUAL(shares[worker_id].end, block_shares[worker_id].end);
+        }
+    }
+
+    pool.start();
+    const std::vector<size_t> owners = run_owners(pool, 1000);
+    for (size_t itask = 0; itask < owners.size(); itask++)
+    {
+        UTST_ASSERT_EQUAL(owners[itask], itask / 250);
+    }
+
+    // Negative costs cannot be weighed
+    pool.set_cost([](size_t i)
+                  { return i == 10 ? -1.0 : 1.0; });
+    bool is_thrown = false;
+    try
+    {
+        pool.partition(0, 100);
+    }
+    catch (const std::runtime_error &)
+    {
+        is_thrown = true;
+    }
+    UTST_ASSERT(is_thrown);
+}
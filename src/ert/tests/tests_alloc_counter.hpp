@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+/// Counts the heap allocations made through the global operator new.
+/// Replaces the global operator new and delete, so it must be included by a single
+/// translation unit of a test executable.
+
+namespace TESTS
+{
+    inline std::atomic<size_t> num_allocations = 0;
+
+    /// Allocations made since construction
+    class ALLOC_COUNTER
+    {
+    public:
+        explicit ALLOC_COUNTER(const char *profile_name) : profile_name_(profile_name), start_(num_allocations.load()) {}
+
+        size_t count() const { return num_allocations.load() - this->start_; }
+        size_t report(const char *subprofile_name) const
+        {
+            const size_t num = this->count();
+            printf("ALLOCS: [%s/%s]: %lu allocations\n", this->profile_name_, subprofile_name, num);
+            return num;
+        }
+
+    private:
+        const char *profile_name_;
+        size_t start_;
+    };
+}
+
+// Kept out of line along with operator delete, GCC otherwise flags the inlined malloc()/free() pairs
+__attribute__((noinline)) void *operator new(size_t size)
+{
+    TESTS::num_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
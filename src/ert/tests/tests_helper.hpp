@@ -1,8 +1,17 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <memory>
+#include <thread>
 #include <vector>
 
+#include "macros.hpp"
+#include "parallel_for.hpp"
+#include "task_graph.hpp"
+#include "task_group.hpp"
 #include "task.hpp"
 #include "timer.hpp"
 
@@ -21,4 +30,142 @@ namespace TESTS
         pool.reset();
         timer.elapsed_previous("dtor");
     }
-}
\ No newline at end of file
+
+    /// Average latency of a session in seconds, with the pool left idle for idle_ms between sessions
+    template <typename POOL_IF>
+    double measure_session_latency(const char *profile_name, POOL_IF &pool, const std::vector<ERT::RAW_TASK> &tasks,
+                                   size_t num_sessions, size_t idle_ms)
+    {
+        double total_elapsed = 0;
+        for (size_t i = 0; i < num_sessions; i++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(idle_ms));
+            const double start_time = ERT::get_time_stamp();
+            pool.execute(tasks);
+            total_elapsed += ERT::get_time_stamp() - start_time;
+        }
+        const double latency = total_elapsed / num_sessions;
+        printf("LATENCY: [%s] %lu sessions, idle=%lums: %f seconds per session\n", profile_name, num_sessions, idle_ms, latency);
+        return latency;
+    }
+
+    /// Every iteration of ERT::parallel_for must run exactly once
+    template <typename POOL_IF>
+    void check_parallel_for(size_t num_workers, size_t begin, size_t end, size_t grain)
+    {
+        POOL_IF pool(num_workers);
+        pool.start();
+        std::vector<int> num_runs(end, 0);
+        ERT::parallel_for(pool, begin, end, grain, [&num_runs](size_t i)
+                          { num_runs[i]++; });
+        for (size_t i = 0; i < end; i++)
+        {
+            ASSERT(num_runs[i] == (i >= begin ? 1 : 0));
+        }
+    }
+
+    inline size_t task_group_fib(size_t n)
+    {
+        if (n < 2)
+        {
+            return n;
+        }
+        size_t a = 0;
+        ERT::TASK_GROUP task_group;
+        task_group.spawn([&a, n]()
+                         { a = task_group_fib(n - 1); });
+        const size_t b = task_group_fib(n - 2);
+        task_group.wait();
+        return a + b;
+    }
+
+    /// Recursive and nested ERT::TASK_GROUP inside the tasks of a session
+    template <typename POOL_IF>
+    void check_task_group(size_t num_workers)
+    {
+        // Outside of a pool, spawned tasks run inline
+        ASSERT(task_group_fib(15) == 610);
+
+        POOL_IF pool(num_workers);
+        pool.start();
+
+        // Divide and conquer
+        size_t fib = 0;
+        std::vector<ERT::RAW_TASK> fib_tasks;
+        fib_tasks.emplace_back([&fib]()
+                               { fib = task_group_fib(20); });
+        pool.execute(fib_tasks);
+        ASSERT(fib == 6765);
+
+        // Nested loops
+        constexpr size_t num_outer = 16;
+        constexpr size_t num_inner = 100;
+        std::vector<int> num_runs(num_outer * num_inner, 0);
+        std::vector<ERT::RAW_TASK> outer_tasks;
+        for (size_t i = 0; i < num_outer; i++)
+        {
+            outer_tasks.emplace_back([i, &num_runs]()
+                                     {
+                                         ERT::TASK_GROUP task_group;
+                                         for (size_t j = 0; j < num_inner; j++)
+                                         {
+                                             task_group.spawn([i, j, &num_runs]()
+                                                              { num_runs[i * num_inner + j]++; });
+                                         }
+                                         task_group.wait(); });
+        }
+        pool.execute(outer_tasks);
+        ASSERT(std::all_of(num_runs.begin(), num_runs.end(), [](int n)
+                           { return n == 1; }));
+    }
+
+    /// Chained loops of an ERT::TASK_GRAPH run in dependency order, over repeated sessions
+    template <typename POOL_IF>
+    void check_task_graph(size_t num_workers)
+    {
+        constexpr size_t num_iterations = 1000;
+        constexpr int num_stages = 3;
+
+        POOL_IF pool(num_workers);
+        pool.start();
+
+        // Every iteration goes through the stages in order, then a single node joins all of them
+        std::vector<int> stages(num_iterations, 0);
+        std::atomic<size_t> num_out_of_order = 0;
+        bool is_joined = false;
+        ERT::TASK_GRAPH graph;
+        auto stage_body = [&stages, &num_out_of_order](int stage)
+        {
+            return [&stages, &num_out_of_order, stage](size_t i)
+            {
+                if (stages[i] != stage)
+                {
+                    num_out_of_order++;
+                }
+                stages[i] = stage + 1;
+            };
+        };
+        ERT::TASK_GRAPH::LOOP loop = graph.add_loop(num_iterations, stage_body(0));
+        for (int stage = 1; stage < num_stages; stage++)
+        {
+            loop = graph.chain_loop(loop, stage_body(stage));
+        }
+        const ERT::TASK_GRAPH::NODE join = graph.add([&stages, &is_joined]()
+                                                     { is_joined = std::all_of(stages.begin(), stages.end(), [](int stage)
+                                                                               { return stage == num_stages; }); });
+        for (size_t i = 0; i < num_iterations; i++)
+        {
+            graph.precede(loop.node(i), join);
+        }
+        ASSERT(graph.levels().size() == num_stages + 1);
+
+        for (int session = 0; session < 3; session++)
+        {
+            std::fill(stages.begin(), stages.end(), 0);
+            is_joined = false;
+            pool.execute_graph(graph);
+            ASSERT(num_out_of_order == 0);
+            ASSERT(is_joined);
+        }
+    }
+}
@@ -0,0 +1,156 @@
+#define MESSAGE_LEVEL 0
+#define ERT_ENABLE_TRACE 1
+#define ERT_TRACE_CAPACITY 1024
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "serial_pool.hpp"
+#include "suap_pool.hpp"
+#include "tests_kernels.hpp"
+#include "trace.hpp"
+#include "utst.hpp"
+#include "wscl_pool.hpp"
+#include "wspdr_pool.hpp"
+#include "wspds_pool.hpp"
+
+using namespace ERT;
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    size_t count(const std::string &text, const std::string &pattern)
+    {
+        size_t n = 0;
+        for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1))
+        {
+            n++;
+        }
+        return n;
+    }
+
+    std::string read_file(const fs::path &path)
+    {
+        std::ifstream file(path);
+        std::stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    // Runs a session on a pool torn down right after, returning its trace file
+    template <typename POOL_IF>
+    std::string trace_session(const fs::path &path, size_t num_tasks)
+    {
+        TRACER::instance().dump_json(); // Drop what earlier tests left
+        {
+            POOL_IF pool(4);
+            pool.start();
+            std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_tasks, [](size_t i)
+                                                                  { TESTS::collatz_conjecture_kernel(i, i + 100); });
+            pool.execute(tasks);
+        }
+        return read_file(path);
+    }
+}
+
+UTST_MAIN();
+
+UTST_TEST(pool_teardown_dump)
+{
+    const fs::path root = fs::temp_directory_path() / "ert_trace_tests";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    TRACER::instance().set_file_prefix((root / "trace").string());
+    constexpr size_t num_tasks = 200;
+
+    const std::string serial = trace_session<SERIAL_POOL>(root / "trace_0.json", num_tasks);
+    UTST_ASSERT_EQUAL(serial.rfind("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [", 0), size_t(0));
+    UTST_ASSERT_EQUAL(count(serial, "\"name\": \"session\", \"ph\": \"B\""), size_t(1));
+    UTST_ASSERT_EQUAL(count(serial, "\"name\": \"session\", \"ph\": \"E\""), size_t(1));
+    UTST_ASSERT_EQUAL(count(serial, "\"name\": \"task\", \"ph\": \"B\""), num_tasks);
+    UTST_ASSERT_EQUAL(count(serial, "\"name\": \"task\", \"ph\": \"E\""), num_tasks);
+
+    // A share per worker
+    const std::string suap = trace_session<SUAP_POOL>(root / "trace_1.json", num_tasks);
+    UTST_ASSERT_EQUAL(count(suap, "\"name\": \"task\", \"ph\": \"B\""), size_t(4));
+    UTST_ASSERT_EQUAL(count(suap, "\"name\": \"idle\", \"ph\": \"B\""), count(suap, "\"name\": \"idle\", \"ph\": \"E\""));
+
+    const std::string wspdr = trace_session<WSPDR_POOL>(root / "trace_2.json", num_tasks);
+    UTST_ASSERT_EQUAL(count(wspdr, "\"name\": \"task\", \"ph\": \"B\""), num_tasks);
+    UTST_ASSERT_EQUAL(count(wspdr, "\"name\": \"task\", \"ph\": \"E\""), num_tasks);
+    UTST_ASSERT_EQUAL(count(wspdr, "\"name\": \"steal_request\""), count(wspdr, "\"name\": \"steal_grant\"") + count(wspdr, "\"name\": \"steal_deny\""));
+    UTST_ASSERT(count(wspdr, "\"args\": {\"name\": \"worker 3\"}") > 0);
+
+    const std::string wspds = trace_session<WSPDS_POOL>(root / "trace_3.json", num_tasks);
+    UTST_ASSERT_EQUAL(count(wspds, "\"name\": \"task\", \"ph\": \"E\""), num_tasks);
+    const std::string wscl = trace_session<WSCL_POOL>(root / "trace_4.json", num_tasks);
+    UTST_ASSERT_EQUAL(count(wscl, "\"name\": \"task\", \"ph\": \"E\""), num_tasks);
+    UTST_ASSERT_EQUAL(wscl.substr(wscl.size() - 4), std::string("\n]}\n"));
+
+    fs::remove_all(root);
+}
+
+UTST_TEST(ring_buffer)
+{
+    TRACER::instance().dump_json();
+    constexpr size_t num_events = 3000;
+    for (size_t i = 0; i < num_events; i++)
+    {
+        ERT_TRACE(TASK_BEGIN, -1, i);
+    }
+    // Only the latest events are kept
+    const std::string json = TRACER::instance().dump_json();
+    UTST_ASSERT_EQUAL(count(json, "\"name\": \"task\""), size_t(ERT_TRACE_CAPACITY));
+    UTST_ASSERT(json.find("\"count\": 2999}") != std::string::npos);
+    UTST_ASSERT(json.find("\"count\": 1975}") == std::string::npos);
+    UTST_ASSERT(json.find("\"count\": 1976}") != std::string::npos);
+
+    // Drained once dumped
+    UTST_ASSERT_EQUAL(count(TRACER::instance().dump_json(), "\"name\": \"task\""), size_t(0));
+}
+
+UTST_TEST(drain_while_appending)
+{
+    // A thread keeps wrapping around its ring while it is drained, every event carrying its index twice
+    std::unique_ptr<TRACE_BUFFER> writer_buffer;
+    std::atomic<TRACE_BUFFER *> created_buffer = nullptr;
+    std::atomic<bool> is_done = false;
+    std::thread writer([&]()
+                       {
+                           writer_buffer = std::make_unique<TRACE_BUFFER>(0); // Owned by the writer thread
+                           created_buffer = writer_buffer.get();
+                           for (uint32_t i = 0; i < 200 * ERT_TRACE_CAPACITY; i++)
+                           {
+                               writer_buffer->append(TRACE_EVENT{i, TRACE_KIND::TASK_BEGIN, -1, i});
+                           }
+                           is_done = true; });
+    while (!created_buffer)
+    {
+        std::this_thread::yield();
+    }
+    TRACE_BUFFER &buffer = *created_buffer;
+    uint64_t last_time = 0;
+    bool is_first = true;
+    bool is_consistent = true;
+    auto check = [&](const TRACE_EVENT &event)
+    {
+        // Never torn, and oldest first
+        is_consistent = is_consistent && event.time == event.count && event.kind == TRACE_KIND::TASK_BEGIN && event.peer == -1 &&
+                        (is_first || event.time > last_time);
+        last_time = event.time;
+        is_first = false;
+    };
+    while (!is_done)
+    {
+        buffer.drain(check);
+    }
+    writer.join();
+    buffer.drain(check); // Up to the last event
+    UTST_ASSERT(is_consistent);
+    UTST_ASSERT_EQUAL(last_time, uint64_t(200 * ERT_TRACE_CAPACITY - 1));
+}
@@ -0,0 +1,176 @@
+#define MESSAGE_LEVEL 0
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "serial_pool.hpp"
+#include "tests_helper.hpp"
+#include "tests_kernels.hpp"
+#include "timer.hpp"
+#include "utst.hpp"
+#include "wscl_pool.hpp"
+
+using namespace ERT;
+
+UTST_MAIN();
+
+UTST_TEST(last_item_race)
+{
+    // The owner pops while a thief steals the only item: exactly one of them gets it.
+    // Every other round, the owner lets the thief go first, so that both sides win some.
+    constexpr int num_rounds = 20000;
+    CHASE_LEV_DEQUE<int> deque;
+    std::vector<int> items(num_rounds);
+    std::atomic<int> pushed_round = -1;
+    std::atomic<int> stolen_round = -1;
+    std::atomic<int> num_stolen = 0;
+    std::thread thief([&]()
+                      {
+                          for (int round = 0; round < num_rounds; round++)
+                          {
+                              while (pushed_round.load() < round)
+                              {
+                                  std::this_thread::yield();
+                              }
+                              if (int *item = deque.steal())
+                              {
+                                  UTST_ASSERT(item == &items[round]);
+                                  num_stolen++;
+                              }
+                              stolen_round = round;
+                          } });
+    int num_popped = 0;
+    for (int round = 0; round < num_rounds; round++)
+    {
+        deque.push(&items[round]);
+        pushed_round = round;
+        while (round % 2 == 1 && stolen_round.load() < round)
+        {
+            std::this_thread::yield();
+        }
+        if (int *item = deque.pop())
+        {
+            UTST_ASSERT(item == &items[round]);
+            num_popped++;
+        }
+        while (stolen_round.load() < round)
+        {
+            std::this_thread::yield();
+        }
+        UTST_ASSERT(deque.empty());
+    }
+    thief.join();
+    printf("popped=%d, stolen=%d\n", num_popped, num_stolen.load());
+    UTST_ASSERT_EQUAL(num_popped + num_stolen.load(), num_rounds);
+    UTST_ASSERT(num_stolen.load() >= num_rounds / 2);
+}
+
+UTST_TEST(ring_growth)
+{
+    // Past the initial capacity of 4, the owner pops newest first and thieves steal oldest first
+    constexpr int num_items = 1000;
+    std::vector<int> items(num_items);
+    CHASE_LEV_DEQUE<int> deque(2);
+    for (int i = 0; i < num_items; i++)
+    {
+        deque.push(&items[i]);
+    }
+    UTST_ASSERT_EQUAL(deque.size(), size_t(num_items));
+    UTST_ASSERT(deque.steal() == &items[0]);
+    UTST_ASSERT(deque.steal() == &items[1]);
+    UTST_ASSERT(deque.pop() == &items[num_items - 1]);
+    for (int i = num_items - 2; i >= 2; i--)
+    {
+        UTST_ASSERT(deque.pop() == &items[i]);
+    }
+    UTST_ASSERT(deque.pop() == nullptr);
+    UTST_ASSERT(deque.steal() == nullptr);
+
+    // Growing while a thief keeps stealing, every item is taken exactly once
+    std::vector<std::atomic<int>> num_takes(num_items);
+    CHASE_LEV_DEQUE<int> growing_deque(1);
+    std::atomic<bool> is_pushed = false;
+    std::thread thief([&]()
+                      {
+                          while (!is_pushed || !growing_deque.empty())
+                          {
+                              if (int *item = growing_deque.steal())
+                              {
+                                  num_takes[item - items.data()]++;
+                              }
+                          } });
+    for (int i = 0; i < num_items; i++)
+    {
+        growing_deque.push(&items[i]);
+        if (i % 64 == 0)
+        {
+            std::this_thread::yield(); // Let the thief in, also on a single core
+        }
+        if (i % 3 == 0)
+        {
+            if (int *item = growing_deque.pop())
+            {
+                num_takes[item - items.data()]++;
+            }
+        }
+    }
+    is_pushed = true;
+    while (int *item = growing_deque.pop())
+    {
+        num_takes[item - items.data()]++;
+    }
+    thief.join();
+    for (int i = 0; i < num_items; i++)
+    {
+        UTST_ASSERT_EQUAL(num_takes[i].load(), 1);
+    }
+}
+
+UTST_TEST(collatz_conjecture)
+{
+    auto [serial_task, tasks, result_ptr] = TESTS::generate_collatz_conjecture_tasks();
+
+    // Serial execution result
+    TIMER timer("serial");
+    size_t serial_result = serial_task();
+    printf("serial total_num_steps=%lu\n", serial_result);
+    timer.elapsed_start();
+
+    // Serial chunk execution result
+    *result_ptr = 0;
+    TESTS::quick_launch<SERIAL_POOL>(1, tasks);
+    size_t serial_chunk_result = *result_ptr;
+    printf("serial chunk total_num_steps=%lu\n", serial_chunk_result);
+
+    // Pool execution result
+    *result_ptr = 0;
+    TESTS::quick_launch<WSCL_POOL>(4, tasks);
+    size_t pool_result = *result_ptr;
+    printf("pool total_num_steps=%lu\n", pool_result);
+
+    UTST_ASSERT_EQUAL(serial_result, serial_chunk_result);
+    UTST_ASSERT_EQUAL(serial_result, pool_result);
+}
+
+UTST_TEST(parallel_for)
+{
+    TESTS::check_parallel_for<WSCL_POOL>(4, 0, 100000, 0);
+    TESTS::check_parallel_for<WSCL_POOL>(4, 7, 100000, 1);
+    TESTS::check_parallel_for<WSCL_POOL>(4, 0, 3, 1000);
+    TESTS::check_parallel_for<WSCL_POOL>(1, 0, 1000, 10);
+}
+
+UTST_TEST(task_group)
+{
+    TESTS::check_task_group<WSCL_POOL>(4);
+    TESTS::check_task_group<WSCL_POOL>(1);
+}
+
+UTST_TEST(task_graph)
+{
+    TESTS::check_task_graph<WSCL_POOL>(4);
+    TESTS::check_task_graph<WSCL_POOL>(1);
+}
@@ -2,7 +2,9 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <vector>
 
+#include "affinity.hpp"
 #include "serial_pool.hpp"
 #include "tests_helper.hpp"
 #include "tests_kernels.hpp"
@@ -61,4 +63,168 @@ UTST_TEST(collatz_conjecture)
 
     UTST_ASSERT_EQUAL(serial_result, serial_chunk_result);
     UTST_ASSERT_EQUAL(serial_result, pool_result);
-}
\ No newline at end of file
+}
+
+UTST_TEST(parallel_for)
+{
+    TESTS::check_parallel_for<WSPDR_POOL>(4, 0, 100000, 0);
+    TESTS::check_parallel_for<WSPDR_POOL>(4, 7, 100000, 1);
+    TESTS::check_parallel_for<WSPDR_POOL>(4, 0, 3, 1000);
+    TESTS::check_parallel_for<WSPDR_POOL>(1, 0, 1000, 10);
+}
+
+UTST_TEST(task_group)
+{
+    TESTS::check_task_group<WSPDR_POOL>(4);
+    TESTS::check_task_group<WSPDR_POOL>(1);
+}
+
+UTST_TEST(span)
+{
+    constexpr size_t num_tasks = 1000;
+    constexpr size_t span_begin = 100;
+    constexpr size_t span_size = 500;
+
+    std::vector<int> num_runs(num_tasks, 0);
+    std::vector<RAW_TASK> tasks = TESTS::generate_n_tasks(num_tasks, [&num_runs](size_t i)
+                                                          { num_runs[i]++; });
+
+    WSPDR_POOL pool(4);
+    pool.start();
+    pool.execute(tasks.data() + span_begin, span_size);
+    for (size_t i = 0; i < num_tasks; i++)
+    {
+        UTST_ASSERT_EQUAL(num_runs[i], (i >= span_begin && i < span_begin + span_size) ? 1 : 0);
+    }
+}
+
+UTST_TEST(task_graph)
+{
+    TESTS::check_task_graph<WSPDR_POOL>(4);
+    TESTS::check_task_graph<WSPDR_POOL>(1);
+}
+
+UTST_TEST(victim_selection)
+{
+    // The same seed gives the same sequence of picks
+    XORSHIFT rng(42), same_rng(42), other_rng(43);
+    bool is_other_same = true;
+    for (int i = 0; i < 100; i++)
+    {
+        const uint64_t pick = rng();
+        const uint64_t same_pick = same_rng();
+        UTST_ASSERT_EQUAL(pick, same_pick);
+        is_other_same = is_other_same && pick == other_rng();
+    }
+    UTST_ASSERT(!is_other_same);
+    for (int i = 0; i < 100; i++)
+    {
+        UTST_ASSERT(rng.below(7) < 7);
+    }
+
+    // Tiers of victims from the placement, with a fixed seed
+    auto [serial_task, tasks, result_ptr] = TESTS::generate_collatz_conjecture_tasks();
+    const size_t serial_result = serial_task();
+    for (PLACEMENT placement : {PLACEMENT::none(), PLACEMENT::compact(), PLACEMENT::scatter()})
+    {
+        *result_ptr = 0;
+        WSPDR_POOL pool(8);
+        pool.set_placement(placement);
+        pool.set_seed(2024);
+        pool.start();
+        pool.execute(tasks);
+        UTST_ASSERT_EQUAL(serial_result, result_ptr->load());
+    }
+}
+
+UTST_TEST(victim_order)
+{
+    // Worker i on CPU i: 0 and 1 share a core, 0-3 an LLC, 0-5 a package, 6 and 7 are on the other package
+    const TOPOLOGY topology({{0, 0, 0, 0, 0}, {1, 0, 0, 0, 0}, {2, 1, 0, 0, 0}, {3, 1, 0, 0, 0},
+                             {4, 2, 1, 0, 0}, {5, 2, 1, 0, 0}, {6, 3, 2, 1, 1}, {7, 3, 2, 1, 1}});
+    const std::vector<int> worker_cpus = {0, 1, 2, 3, 4, 5, 6, 7};
+    const std::vector<std::vector<int>> tiers = topology.group_by_distance(worker_cpus, worker_cpus.size(), 0);
+    UTST_ASSERT(tiers == std::vector<std::vector<int>>({{1}, {2, 3}, {4, 5}, {6, 7}}));
+
+    VICTIM_SELECTOR selector;
+    selector.init(tiers, 2024);
+    std::vector<bool> has_tasks(worker_cpus.size(), true);
+    const auto select = [&selector, &has_tasks]()
+    { return selector.select([&has_tasks](int worker_id)
+                             { return static_cast<bool>(has_tasks[worker_id]); }); };
+
+    // Nearest first, moving further while the picks have nothing to steal
+    for (int i = 0; i < 100; i++)
+    {
+        UTST_ASSERT_EQUAL(select(), 1);
+    }
+    has_tasks = {false, false, true, true, true, true, true, true};
+    std::vector<int> num_picks(worker_cpus.size(), 0);
+    for (int i = 0; i < 100; i++)
+    {
+        num_picks[select()]++;
+    }
+    UTST_ASSERT(num_picks[2] > 0 && num_picks[3] > 0);
+    UTST_ASSERT_EQUAL(num_picks[2] + num_picks[3], 100);
+    has_tasks = {false, false, false, false, false, false, true, true};
+    for (int i = 0; i < 100; i++)
+    {
+        const int victim = select();
+        UTST_ASSERT(victim == 6 || victim == 7);
+    }
+    has_tasks.assign(worker_cpus.size(), false);
+    UTST_ASSERT_EQUAL(select(), VICTIM_SELECTOR::NO_VICTIM);
+
+    // The last victim that sent tasks first, while it has some, even when nearer workers have too
+    has_tasks.assign(worker_cpus.size(), true);
+    selector.record(7, true);
+    for (int i = 0; i < 100; i++)
+    {
+        UTST_ASSERT_EQUAL(select(), 7);
+    }
+    has_tasks[7] = false;
+    UTST_ASSERT_EQUAL(select(), 1);
+    has_tasks[7] = true;
+    UTST_ASSERT_EQUAL(select(), 7);
+    selector.record(7, false);
+    UTST_ASSERT_EQUAL(select(), 1);
+    selector.record(5, true);
+    UTST_ASSERT_EQUAL(select(), 5);
+
+    // The same seed gives the same picks
+    VICTIM_SELECTOR same_selector;
+    selector.init(tiers, 2024);
+    same_selector.init(tiers, 2024);
+    has_tasks = {false, false, false, false, true, true, true, true};
+    for (int i = 0; i < 100; i++)
+    {
+        UTST_ASSERT_EQUAL(select(), same_selector.select([&has_tasks](int worker_id)
+                                                         { return static_cast<bool>(has_tasks[worker_id]); }));
+    }
+}
+
+UTST_TEST(policies)
+{
+    auto [serial_task, tasks, result_ptr] = TESTS::generate_collatz_conjecture_tasks();
+    const size_t serial_result = serial_task();
+    for (WSPDR_POLICY policy : {WSPDR_POLICY::STEAL_ONE, WSPDR_POLICY::STEAL_HALF, WSPDR_POLICY::ADAPTIVE})
+    {
+        *result_ptr = 0;
+        WSPDR_POOL pool(4, policy);
+        UTST_ASSERT(pool.policy() == policy);
+        pool.start();
+        pool.execute(tasks);
+        UTST_ASSERT_EQUAL(serial_result, result_ptr->load());
+    }
+    UTST_ASSERT(WSPDR_POOL(4).policy() == WSPDR_POLICY::DEFAULT);
+
+    // ADAPTIVE steals half when tasks are short next to a steal, or when the thief keeps failing,
+    // and a single task when tasks are long and the thief finds work
+    constexpr double steal_latency = 2e-6;
+    UTST_ASSERT_EQUAL(WSPDR_WORKER::num_adaptive_tasks_to_send(100, steal_latency, 0, 0), size_t(50));
+    UTST_ASSERT_EQUAL(WSPDR_WORKER::num_adaptive_tasks_to_send(100, steal_latency, 0, 1e-3), size_t(1));
+    UTST_ASSERT_EQUAL(WSPDR_WORKER::num_adaptive_tasks_to_send(100, steal_latency, 1, 1e-3), size_t(50));
+    const size_t num_in_between = WSPDR_WORKER::num_adaptive_tasks_to_send(100, steal_latency, 0, steal_latency);
+    UTST_ASSERT(num_in_between > 1 && num_in_between < 50);
+    UTST_ASSERT_EQUAL(WSPDR_WORKER::num_adaptive_tasks_to_send(1, steal_latency, 1, 0), size_t(1));
+}
@@ -0,0 +1,152 @@
+#define MESSAGE_LEVEL 0
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "serial_pool.hpp"
+#include "tests_helper.hpp"
+#include "tests_kernels.hpp"
+#include "timer.hpp"
+#include "utst.hpp"
+#include "wspds_pool.hpp"
+
+using namespace ERT;
+
+UTST_MAIN();
+
+UTST_TEST(idle_bitmap)
+{
+    // Three words, claimed across word boundaries
+    IDLE_BITMAP idle_workers(130);
+    UTST_ASSERT_EQUAL(idle_workers.try_claim_any(0), -1);
+    UTST_ASSERT(!idle_workers.try_clear(64));
+
+    // Withdrawing an advertisement
+    idle_workers.set(64);
+    UTST_ASSERT(idle_workers.try_clear(64));
+    UTST_ASSERT(!idle_workers.try_clear(64));
+
+    // Never claiming self, other idle workers from the word of self onwards
+    idle_workers.set(3);
+    idle_workers.set(64);
+    idle_workers.set(129);
+    UTST_ASSERT_EQUAL(idle_workers.try_claim_any(64), 129);
+    UTST_ASSERT_EQUAL(idle_workers.try_claim_any(64), 3);
+    UTST_ASSERT_EQUAL(idle_workers.try_claim_any(64), -1);
+    UTST_ASSERT_EQUAL(idle_workers.try_claim_any(0), 64);
+    UTST_ASSERT_EQUAL(idle_workers.try_claim_any(0), -1);
+
+    // A claimed worker cannot withdraw
+    idle_workers.set(100);
+    UTST_ASSERT_EQUAL(idle_workers.try_claim_any(1), 100);
+    UTST_ASSERT(!idle_workers.try_clear(100));
+}
+
+UTST_TEST(idle_bitmap_contention)
+{
+    // Senders race to claim an idle worker that races to withdraw: exactly one side wins every round
+    constexpr int num_rounds = 2000;
+    constexpr int num_senders = 3;
+    constexpr int idle_worker_id = 70;
+    IDLE_BITMAP idle_workers(72);
+    std::atomic<int> round = -1;
+    std::atomic<int> num_done = 0;
+    std::atomic<int> num_claims = 0;
+    std::vector<std::thread> senders;
+    for (int sender_id = 0; sender_id < num_senders; sender_id++)
+    {
+        senders.emplace_back([&, sender_id]()
+                             {
+                                 for (int r = 0; r < num_rounds; r++)
+                                 {
+                                     while (round.load() < r)
+                                     {
+                                         std::this_thread::yield();
+                                     }
+                                     const int claimed = idle_workers.try_claim_any(sender_id);
+                                     UTST_ASSERT(claimed == -1 || claimed == idle_worker_id);
+                                     num_claims += claimed == idle_worker_id;
+                                     num_done++;
+                                 } });
+    }
+    int num_withdrawals = 0;
+    for (int r = 0; r < num_rounds; r++)
+    {
+        idle_workers.set(idle_worker_id);
+        round = r;
+        if (r % 2 == 0)
+        {
+            std::this_thread::yield();
+        }
+        num_withdrawals += idle_workers.try_clear(idle_worker_id);
+        while (num_done.load() < (r + 1) * num_senders)
+        {
+            std::this_thread::yield();
+        }
+    }
+    for (auto &sender : senders)
+    {
+        sender.join();
+    }
+    UTST_ASSERT_EQUAL(num_claims.load() + num_withdrawals, num_rounds);
+}
+
+UTST_TEST(many_workers)
+{
+    // Workers past the first word of the bitmap advertise and get tasks pushed as well
+    auto [serial_task, tasks, result_ptr] = TESTS::generate_collatz_conjecture_tasks();
+    const size_t serial_result = serial_task();
+    WSPDS_POOL pool(66);
+    pool.start();
+    pool.execute(tasks);
+    UTST_ASSERT_EQUAL(serial_result, result_ptr->load());
+}
+
+UTST_TEST(collatz_conjecture)
+{
+    auto [serial_task, tasks, result_ptr] = TESTS::generate_collatz_conjecture_tasks();
+
+    // Serial execution result
+    TIMER timer("serial");
+    size_t serial_result = serial_task();
+    printf("serial total_num_steps=%lu\n", serial_result);
+    timer.elapsed_start();
+
+    // Serial chunk execution result
+    *result_ptr = 0;
+    TESTS::quick_launch<SERIAL_POOL>(1, tasks);
+    size_t serial_chunk_result = *result_ptr;
+    printf("serial chunk total_num_steps=%lu\n", serial_chunk_result);
+
+    // Pool execution result
+    *result_ptr = 0;
+    TESTS::quick_launch<WSPDS_POOL>(4, tasks);
+    size_t pool_result = *result_ptr;
+    printf("pool total_num_steps=%lu\n", pool_result);
+
+    UTST_ASSERT_EQUAL(serial_result, serial_chunk_result);
+    UTST_ASSERT_EQUAL(serial_result, pool_result);
+}
+
+UTST_TEST(parallel_for)
+{
+    TESTS::check_parallel_for<WSPDS_POOL>(4, 0, 100000, 0);
+    TESTS::check_parallel_for<WSPDS_POOL>(4, 7, 100000, 1);
+    TESTS::check_parallel_for<WSPDS_POOL>(4, 0, 3, 1000);
+    TESTS::check_parallel_for<WSPDS_POOL>(1, 0, 1000, 10);
+}
+
+UTST_TEST(task_group)
+{
+    TESTS::check_task_group<WSPDS_POOL>(4);
+    TESTS::check_task_group<WSPDS_POOL>(1);
+}
+
+UTST_TEST(task_graph)
+{
+    TESTS::check_task_graph<WSPDS_POOL>(4);
+    TESTS::check_task_graph<WSPDS_POOL>(1);
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Timeline of the scheduling events of the workers, in the Chrome trace_event format, e.g. for Perfetto.
+/// Opt-in: compiled out completely unless ERT_ENABLE_TRACE is defined to 1 before including ERT.
+/// Each thread appends fixed-size events to its own ring buffer, without locks,
+/// and every pool dumps the events recorded so far when torn down,
+/// to $ERT_TRACE_FILE_<n>.json, ert_trace_<n>.json by default.
+
+// Set a default ERT_ENABLE_TRACE if undefined
+#ifndef ERT_ENABLE_TRACE
+#define ERT_ENABLE_TRACE 0
+#endif
+
+// Events per thread, the oldest events being overwritten once full
+#ifndef ERT_TRACE_CAPACITY
+#define ERT_TRACE_CAPACITY (1 << 16)
+#endif
+
+#if ERT_ENABLE_TRACE
+// ERT_TRACE(kind[, peer worker[, count]])
+#define ERT_TRACE(kind, ...) ::ERT::TRACER::record(::ERT::TRACE_KIND::kind, ##__VA_ARGS__)
+#define ERT_TRACE_NAME_THREAD(worker_index) ::ERT::TRACER::name_thread(worker_index)
+#define ERT_TRACE_DUMP() ::ERT::TRACER::instance().dump()
+#else
+#define ERT_TRACE(...)
+#define ERT_TRACE_NAME_THREAD(...)
+#define ERT_TRACE_DUMP()
+#endif
+
+namespace ERT
+{
+    enum class TRACE_KIND : uint16_t
+    {
+        SESSION_BEGIN, // count: tasks of the session
+        SESSION_END,
+        TASK_BEGIN, // count: tasks run as one, e.g. a static share or a chunk
+        TASK_END,
+        STEAL_REQUEST, // peer: victim, or -1 when advertising as idle
+        STEAL_GRANT,   // peer: the other side of the steal, count: tasks handed over
+        STEAL_DENY,    // peer: the other side of the steal
+        IDLE_BEGIN,
+        IDLE_END,
+    };
+
+    struct TRACE_EVENT
+    {
+        uint64_t time; // Nanoseconds, steady clock
+        TRACE_KIND kind;
+        int16_t peer;
+        uint32_t count;
+    };
+    static_assert(sizeof(TRACE_EVENT) == 16);
+
+    /// The ring buffer of a thread, written by that thread only, and read when dumping.
+    /// Slots are relaxed atomics, so that a dump can read them while the thread keeps appending,
+    /// dropping the events that may have been overwritten during the read, as a seqlock would.
+    class TRACE_BUFFER
+    {
+    public:
+        explicit TRACE_BUFFER(size_t serial) : events_(std::make_unique<SLOT[]>(ERT_TRACE_CAPACITY)), serial_(serial) {}
+
+        void append(const TRACE_EVENT &event);
+        size_t serial() const { return this->serial_; }
+        void set_worker_index(size_t worker_index) { this->worker_index_.store(worker_index, std::memory_order_relaxed); }
+        size_t worker_index() const { return this->worker_index_.load(std::memory_order_relaxed); }
+        void retire() { this->is_retired_.store(true, std::memory_order_release); }
+        bool is_retired() const { return this->is_retired_.load(std::memory_order_acquire); }
+        // Calls f on each event appended since the previous call, oldest first
+        template <typename F>
+        void drain(F &&f);
+
+    private:
+        struct SLOT
+        {
+            std::atomic<uint64_t> time;
+            std::atomic<uint64_t> fields; // kind, peer and count
+        };
+
+    private:
+        static_assert((ERT_TRACE_CAPACITY & (ERT_TRACE_CAPACITY - 1)) == 0, "ERT_TRACE_CAPACITY must be a power of 2");
+        std::unique_ptr<SLOT[]> events_;
+        std::atomic<uint64_t> head_ = 0; // Events appended
+        uint64_t drained_ = 0;           // Events already dumped
+        size_t serial_;
+        std::thread::id thread_id_ = std::this_thread::get_id(); // The only writer, creating the buffer
+        std::atomic<size_t> worker_index_ = 0;
+        std::atomic<bool> is_retired_ = false; // The thread has exited
+    };
+
+    /// Owns the buffers of all threads, so that they outlive the executors of a pool until dumped
+    class TRACER
+    {
+    public:
+        static TRACER &instance();
+
+        static void record(TRACE_KIND kind, int peer = -1, size_t count = 0);
+        static void name_thread(size_t worker_index) { thread_buffer().set_worker_index(worker_index); }
+
+        void set_file_prefix(std::string prefix);
+        // The events recorded since the previous dump, as trace_event JSON
+        std::string dump_json();
+        void dump(); // To the next file
+
+    private:
+        TRACER();
+        static TRACE_BUFFER &thread_buffer();
+        TRACE_BUFFER *add_buffer();
+
+    private:
+        std::mutex mutex_; // Only taken to add a thread, and to dump
+        std::vector<std::unique_ptr<TRACE_BUFFER>> buffers_;
+        std::chrono::steady_clock::time_point epoch_;
+        std::string file_prefix_;
+        size_t num_buffers_added_ = 0;
+        size_t num_dumps_ = 0;
+    };
+}
+
+namespace ERT
+{
+    inline void TRACE_BUFFER::append(const TRACE_EVENT &event)
+    {
+        const uint64_t head = this->head_.load(std::memory_order_relaxed);
+        // A drain() reading this slot and seeing the new event then sees the previous head at least
+        std::atomic_thread_fence(std::memory_order_release);
+        SLOT &slot = this->events_[head & (ERT_TRACE_CAPACITY - 1)];
+        slot.time.store(event.time, std::memory_order_relaxed);
+        slot.fields.store(static_cast<uint64_t>(event.kind) | static_cast<uint64_t>(static_cast<uint16_t>(event.peer)) << 16 |
+                              static_cast<uint64_t>(event.count) << 32,
+                          std::memory_order_relaxed);
+        this->head_.store(head + 1, std::memory_order_release);
+    }
+
+    template <typename F>
+    void TRACE_BUFFER::drain(F &&f)
+    {
+        const uint64_t head = this->head_.load(std::memory_order_acquire);
+        // Overwritten events are lost
+        const uint64_t tail = head - this->drained_ > ERT_TRACE_CAPACITY ? head - ERT_TRACE_CAPACITY : this->drained_;
+        std::vector<TRACE_EVENT> events;
+        events.reserve(head - tail);
+        for (uint64_t i = tail; i < head; i++)
+        {
+            const SLOT &slot = this->events_[i & (ERT_TRACE_CAPACITY - 1)];
+            const uint64_t fields = slot.fields.load(std::memory_order_relaxed);
+            events.push_back(TRACE_EVENT{slot.time.load(std::memory_order_relaxed), static_cast<TRACE_KIND>(fields & 0xffff),
+                                         static_cast<int16_t>(static_cast<uint16_t>(fields >> 16)), static_cast<uint32_t>(fields >> 32)});
+        }
+        // Unless drained by its own thread or after it exited, the thread may have kept appending meanwhile,
+        // up to the event at the latest head, which it may be writing still.
+        // Events sharing a slot with any of them may be torn, and are lost as well.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const bool is_quiescent = this->is_retired() || this->thread_id_ == std::this_thread::get_id();
+        const uint64_t latest_head = this->head_.load(std::memory_order_relaxed) + (is_quiescent ? 0 : 1);
+        const uint64_t valid_tail = latest_head > ERT_TRACE_CAPACITY ? std::max(tail, latest_head - ERT_TRACE_CAPACITY) : tail;
+        for (uint64_t i = std::min(valid_tail, head); i < head; i++)
+        {
+            f(events[i - tail]);
+        }
+        this->drained_ = head;
+    }
+
+    inline TRACER::TRACER() : epoch_(std::chrono::steady_clock::now())
+    {
+        const char *prefix = std::getenv("ERT_TRACE_FILE");
+        this->file_prefix_ = prefix ? prefix : "ert_trace";
+    }
+
+    inline TRACER &TRACER::instance()
+    {
+        static TRACER tracer;
+        return tracer;
+    }
+
+    inline TRACE_BUFFER &TRACER::thread_buffer()
+    {
+        // Retires the buffer when the thread exits, the tracer frees it once dumped
+        struct HANDLE
+        {
+            TRACE_BUFFER *buffer = TRACER::instance().add_buffer();
+            ~HANDLE() { this->buffer->retire(); }
+        };
+        thread_local HANDLE handle;
+        return *handle.buffer;
+    }
+
+    inline TRACE_BUFFER *TRACER::add_buffer()
+    {
+        std::lock_guard<std::mutex> lock_guard(this->mutex_);
+        this->buffers_.emplace_back(std::make_unique<TRACE_BUFFER>(this->num_buffers_added_++));
+        return this->buffers_.back().get();
+    }
+
+    inline void TRACER::record(TRACE_KIND kind, int peer, size_t count)
+    {
+        const uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        thread_buffer().append(TRACE_EVENT{time, kind, static_cast<int16_t>(peer), static_cast<uint32_t>(count)});
+    }
+
+    inline void TRACER::set_file_prefix(std::string prefix)
+    {
+        std::lock_guard<std::mutex> lock_guard(this->mutex_);
+        this->file_prefix_ = std::move(prefix);
+    }
+
+    inline std::string TRACER::dump_json()
+    {
+        std::lock_guard<std::mutex> lock_guard(this->mutex_);
+        const uint64_t epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(this->epoch_.time_since_epoch()).count();
+        char buffer[256];
+        std::string json = "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+        const char *separator = "\n";
+        for (auto &trace_buffer : this->buffers_)
+        {
+            // Once its thread has exited, a buffer is done after this dump
+            const bool is_retired = trace_buffer->is_retired();
+            const size_t tid = trace_buffer->serial();
+            snprintf(buffer, sizeof(buffer), "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %lu, \"args\": {\"name\": \"worker %lu\"}}",
+                     separator, tid, trace_buffer->worker_index());
+            json += buffer;
+            separator = ",\n";
+            trace_buffer->drain([&](const TRACE_EVENT &event)
+                                {
+                                    static const char *const names[] = {"session", "session", "task", "task", "steal_request",
+                                                                        "steal_grant", "steal_deny", "idle", "idle"};
+                                    static const char *const phases[] = {"B", "E", "B", "E", "i", "i", "i", "B", "E"};
+                                    const size_t kind = static_cast<size_t>(event.kind);
+                                    const double ts = (static_cast<int64_t>(event.time - epoch)) / 1e3; // Microseconds
+                                    snprintf(buffer, sizeof(buffer), ",\n{\"name\": \"%s\", \"ph\": \"%s\", \"s\": \"t\", \"pid\": 1, \"tid\": %lu, \"ts\": %.3f, \"args\": {\"peer\": %d, \"count\": %u}}",
+                                             names[kind], phases[kind], tid, ts, event.peer, event.count);
+                                    json += buffer; });
+            if (is_retired)
+            {
+                trace_buffer.reset();
+            }
+        }
+        json += "\n]}\n";
+
+        this->buffers_.erase(std::remove(this->buffers_.begin(), this->buffers_.end(), nullptr), this->buffers_.end());
+        return json;
+    }
+
+    inline void TRACER::dump()
+    {
+        const std::string json = this->dump_json();
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock_guard(this->mutex_);
+            path = this->file_prefix_ + "_" + std::to_string(this->num_dumps_++) + ".json";
+        }
+        if (FILE *file = fopen(path.c_str(), "w"))
+        {
+            fwrite(json.data(), 1, json.size(), file);
+            fclose(file);
+        }
+    }
+}
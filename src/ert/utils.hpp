@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <thread>
 #include <sstream>
 
@@ -16,4 +17,33 @@ namespace ERT
         ss << id;
         return ss.str();
     }
+
+    /// Marsaglia's xorshift64, a fast PRNG for a single thread with no shared state
+    class XORSHIFT
+    {
+    public:
+        explicit XORSHIFT(uint64_t seed = 0) { this->seed(seed); }
+
+        // Nearby seeds, e.g. a base seed plus a worker id, give unrelated sequences
+        void seed(uint64_t seed)
+        {
+            this->state_ = (seed + 1) * 0x9E3779B97F4A7C15ull;
+            if (this->state_ == 0)
+            {
+                this->state_ = 0x9E3779B97F4A7C15ull;
+            }
+        }
+        uint64_t operator()()
+        {
+            this->state_ ^= this->state_ << 13;
+            this->state_ ^= this->state_ >> 7;
+            this->state_ ^= this->state_ << 17;
+            return this->state_;
+        }
+        // In [0, n)
+        size_t below(size_t n) { return (*this)() % n; }
+
+    private:
+        uint64_t state_;
+    };
 }
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include "macros.hpp"
+#include "pool.hpp"
+
+/// Storage private to each worker of a pool
+
+namespace ERT
+{
+    constexpr size_t CACHE_LINE_SIZE = 64;
+
+    /// A value per worker, each on its own cache line, indexed by WORKER_INDEX::current().
+    /// A task only touches the value of the worker running it, so no locking is needed,
+    /// and the values are visited after the session, e.g. to combine them.
+    template <typename T>
+    class WORKER_LOCAL
+    {
+    public:
+        explicit WORKER_LOCAL(size_t num_workers, const T &value = T()) : slots_(num_workers, SLOT{value}) {}
+        explicit WORKER_LOCAL(const POOL &pool, const T &value = T()) : WORKER_LOCAL(pool.num_workers(), value) {}
+
+        T &local();
+        T &operator[](size_t worker_index) { return this->slots_[worker_index].value; }
+        const T &operator[](size_t worker_index) const { return this->slots_[worker_index].value; }
+        size_t size() const { return this->slots_.size(); }
+
+        template <typename F>
+        void for_each(F f);
+        template <typename F>
+        void for_each(F f) const;
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) SLOT
+        {
+            T value;
+        };
+
+    private:
+        std::vector<SLOT> slots_;
+    };
+}
+
+namespace ERT
+{
+    template <typename T>
+    T &WORKER_LOCAL<T>::local()
+    {
+        const size_t worker_index = WORKER_INDEX::current();
+        ASSERT(worker_index < this->slots_.size());
+        return this->slots_[worker_index].value;
+    }
+
+    template <typename T>
+    template <typename F>
+    void WORKER_LOCAL<T>::for_each(F f)
+    {
+        for (auto &slot : this->slots_)
+        {
+            f(slot.value);
+        }
+    }
+
+    template <typename T>
+    template <typename F>
+    void WORKER_LOCAL<T>::for_each(F f) const
+    {
+        for (const auto &slot : this->slots_)
+        {
+            f(slot.value);
+        }
+    }
+}
@@ -0,0 +1,650 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "arena.hpp"
+#include "completion.hpp"
+#include "idle.hpp"
+#include "macros.hpp"
+#include "message.hpp"
+#include "pool.hpp"
+#include "range_task.hpp"
+#include "task.hpp"
+#include "task_graph.hpp"
+#include "task_group.hpp"
+#include "utils.hpp"
+
+/// Work Stealing Chase-Lev POOL - Thief driven
+/// Each worker owns a lock-free Chase-Lev deque: the owner pushes and pops at the bottom,
+/// thieves take from the top with a CAS, without waiting for the owner to respond.
+/// The calling thread of execute() joins the session as worker 0,
+/// so a pool of N workers runs N-1 executor threads.
+
+namespace ERT
+{
+    class WSCL_WORKER;
+    class WSCL_POOL : public POOL
+    {
+    public:
+        explicit WSCL_POOL(size_t num_workers, IDLE_POLICY idle_policy = IDLE_POLICY()) : POOL(num_workers), idle_policy_(idle_policy) {}
+        virtual ~WSCL_POOL();
+
+        virtual void start() override;
+        virtual void terminate() override;
+        // A single session of execution, blocking until completed
+        virtual void execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation) override;
+        using POOL::execute;
+        virtual void execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body) override;
+        virtual void execute_graph(const TASK_GRAPH &graph) override;
+        virtual void status() const override;
+
+    protected:
+        virtual void wake_helpers() override;
+
+    private:
+        // seed(caller_worker) adds the initial tasks of the session, returning how many were added
+        template <typename SEED>
+        void run_session(const SEED &seed, COMPLETION &completion);
+
+    private:
+        std::vector<std::unique_ptr<WSCL_WORKER>> workers_;
+        std::vector<std::thread> executors_;
+        IDLE_POLICY idle_policy_;
+        PARKER parker_;
+        std::atomic<uint64_t> session_clock_ = 0;
+    };
+
+    /// Dynamic circular work-stealing deque
+    /// "Dynamic Circular Work-Stealing Deque", Chase and Lev, SPAA 2005
+    /// "Correct and Efficient Work-Stealing for Weak Memory Models", Le et al., PPoPP 2013
+    /// push() and pop() must only be called by the owner; steal() can be called by any thread.
+    /// Items are owned elsewhere, the deque only holds pointers to them.
+    template <typename T>
+    class CHASE_LEV_DEQUE
+    {
+    public:
+        explicit CHASE_LEV_DEQUE(size_t log_capacity = 8);
+
+        void push(T *item);
+        T *pop();   // nullptr if empty
+        T *steal(); // nullptr if empty or lost the race to another thread
+        bool empty() const;
+        size_t size() const;
+
+    private:
+        struct RING
+        {
+            explicit RING(size_t log_capacity) : capacity(size_t(1) << log_capacity), mask(capacity - 1), items(new std::atomic<T *>[capacity]) {}
+
+            T *get(int64_t i) const { return this->items[i & this->mask].load(std::memory_order_relaxed); }
+            void put(int64_t i, T *item) { this->items[i & this->mask].store(item, std::memory_order_relaxed); }
+
+            const size_t capacity;
+            const size_t mask;
+            std::unique_ptr<std::atomic<T *>[]> items;
+        };
+
+        RING *grow(RING *ring, int64_t top, int64_t bottom);
+
+    private:
+        std::atomic<int64_t> top_ = 0;
+        std::atomic<int64_t> bottom_ = 0;
+        std::atomic<RING *> ring_;
+        std::vector<std::unique_ptr<RING>> rings_; // Retired rings may still be read by thieves, reclaimed at destruction
+    };
+
+    class WSCL_WORKER : public WORKER_CONTEXT
+    {
+    public:
+        void init(int worker_id, std::vector<WSCL_WORKER *> workers, PARKER *parker, INJECTION_QUEUE *injection_queue,
+                  const std::atomic<uint64_t> *session_clock,
+                  STATS_RECORDER *stats, IDLE_POLICY idle_policy = IDLE_POLICY())
+        {
+            this->worker_id_ = worker_id;
+            this->workers_ = std::move(workers);
+            this->parker_ = parker;
+            this->injection_queue_ = injection_queue;
+            this->session_clock_ = session_clock;
+            this->arena_.bind(session_clock);
+            this->stats_ = stats;
+            this->idle_policy_ = idle_policy;
+            this->rng_.seed(worker_id + 1);
+        }
+        void run();                                                      // Running on an executor thread until terminated
+        void run_until(COMPLETION &completion, IDLE_POLICY wait_policy); // Running on the calling thread of a session
+        void enter();                                                    // Bind to the calling thread
+        void leave();                                                    // Unbind from the calling thread, only when task deque is empty (with assert)
+        void add_task(TASK task);                                        // Must not be used cross thread (with assert)
+        void spawn(TASK task) override;                                  // From a task running on this worker
+        bool try_run_one() override;                                     // From a task running on this worker
+        void terminate();
+        void status() const;
+
+    private:
+        void run_task(TASK *task);
+        TASK *try_acquire_once();
+        void idle(BACKOFF &backoff);
+        bool should_wake_up() const;
+
+    private:
+        CHASE_LEV_DEQUE<TASK> tasks_;
+        SESSION_ARENA arena_; // Nodes of the tasks pushed by this worker
+        WORKER_PROXY worker_proxy_;
+        std::vector<WSCL_WORKER *> workers_;
+        PARKER *parker_ = nullptr;
+        INJECTION_QUEUE *injection_queue_ = nullptr; // Helped when there is nothing to steal
+        const std::atomic<uint64_t> *session_clock_ = nullptr;
+        STATS_RECORDER *stats_ = nullptr; // Thieves take tasks unnoticed, so no task is counted as given
+        IDLE_POLICY idle_policy_;
+        std::minstd_rand rng_;
+        std::thread::id thread_id_;
+        int worker_id_ = -1;
+        std::atomic<bool> terminate_notify_ = false;
+    };
+}
+
+namespace ERT
+{
+    inline WSCL_POOL::~WSCL_POOL()
+    {
+        this->terminate();
+    }
+
+    inline void WSCL_POOL::start()
+    {
+        ASSERT(this->workers_.empty());
+        ASSERT(this->executors_.empty());
+
+        const size_t n_workers = this->num_workers();
+
+        // Construct workers
+        this->workers_.reserve(n_workers);
+        std::generate_n(std::back_inserter(this->workers_), n_workers, []()
+                        { return std::make_unique<WSCL_WORKER>(); });
+
+        // Initialize workers
+        std::vector<WSCL_WORKER *> worker_ptrs;
+        worker_ptrs.reserve(n_workers);
+        std::transform(this->workers_.begin(), this->workers_.end(), std::back_inserter(worker_ptrs), [](const auto &p)
+                       { return p.get(); });
+        for (size_t worker_id = 0; worker_id < n_workers; worker_id++)
+        {
+            this->workers_[worker_id]->init(worker_id, worker_ptrs, &this->parker_, &this->injection_queue(), &this->session_clock_, &this->stats_recorder(worker_id), this->idle_policy_);
+        }
+
+        // Initialize executors, worker 0 belongs to the calling thread of execute()
+        this->executors_.reserve(n_workers - 1);
+        for (auto worker_it = std::next(this->workers_.begin()); worker_it != this->workers_.end(); worker_it++)
+        {
+            this->executors_.emplace_back(&WSCL_WORKER::run, worker_it->get());
+        }
+        this->place_executors(this->executors_);
+    }
+
+    inline void WSCL_POOL::terminate()
+    {
+        for (const auto &worker : this->workers_)
+        {
+            worker->terminate();
+        }
+        this->parker_.unpark_all();
+        for (auto &executor : this->executors_)
+        {
+            executor.join();
+        }
+        this->workers_.clear();
+        this->executors_.clear();
+    }
+
+    inline void WSCL_POOL::execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation)
+    {
+        ASSERT(num_tasks > 0);
+
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
+        {
+            // Worker 0 and its deque serve the session holding the pool, nested or concurrent ones are injected
+            this->inject(tasks, num_tasks, cancellation);
+            return;
+        }
+
+        // Workers and executors must be launched already
+        ASSERT(!this->workers_.empty());
+        ASSERT(this->executors_.size() + 1 == this->workers_.size());
+
+        // For synchronization
+        COMPLETION completion(num_tasks);
+
+        // Integrate synchronization into argument tasks, seeded straight into the caller's deque.
+        // Each one refers to the caller's task, which outlives the session.
+        // Once cancelled, the tasks left in the deques are dropped as they are popped or stolen, still counting down.
+        this->run_session([tasks, num_tasks, &cancellation, &completion](WSCL_WORKER &caller_worker)
+                          {
+                              for (size_t itask = 0; itask < num_tasks; itask++)
+                              {
+                                  caller_worker.add_task([task = &tasks[itask], itask, &cancellation, &completion](WORKER_PROXY &)
+                                                         {
+                                                             if (!cancellation.is_cancelled(itask))
+                                                             {
+                                                                 (*task)();
+                                                             }
+                                                             completion.count_down(); });
+                              }
+                              return num_tasks; },
+                          completion);
+    }
+
+    inline void WSCL_POOL::execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body)
+    {
+        ASSERT(begin < end);
+        ASSERT(grain > 0);
+
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
+        {
+            this->inject(begin, end, grain, body);
+            return;
+        }
+
+        // Workers and executors must be launched already
+        ASSERT(!this->workers_.empty());
+        ASSERT(this->executors_.size() + 1 == this->workers_.size());
+
+        // Counting down iterations instead of tasks, the range task splits itself while running
+        COMPLETION completion(end - begin);
+        this->run_session([&](WSCL_WORKER &caller_worker)
+                          {
+                              caller_worker.add_task(to_range_task(begin, end, grain, body, completion));
+                              return size_t(1); },
+                          completion);
+    }
+
+    inline void WSCL_POOL::execute_graph(const TASK_GRAPH &graph)
+    {
+        ASSERT(graph.size() > 0);
+
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
+        {
+            // Injecting level by level
+            POOL::execute_graph(graph);
+            return;
+        }
+
+        // Workers and executors must be launched already
+        ASSERT(!this->workers_.empty());
+        ASSERT(this->executors_.size() + 1 == this->workers_.size());
+
+        // Counting down nodes, each task handing its released successors back to the worker running it
+        COMPLETION completion(graph.size());
+        GRAPH_SESSION graph_session(graph, completion);
+        this->run_session([&graph_session](WSCL_WORKER &caller_worker)
+                          {
+                              for (TASK_GRAPH::NODE root : graph_session.roots())
+                              {
+                                  caller_worker.add_task(graph_session.task(root));
+                              }
+                              return graph_session.roots().size(); },
+                          completion);
+    }
+
+    template <typename SEED>
+    void WSCL_POOL::run_session(const SEED &seed, COMPLETION &completion)
+    {
+        // The calling thread joins as worker 0, seeding its own deque
+        WORKER_INDEX::SCOPE worker_index(0);
+        WSCL_WORKER &caller_worker = *this->workers_.front();
+        this->session_clock_++;
+        caller_worker.enter();
+        [[maybe_unused]] const size_t num_tasks_added = seed(caller_worker);
+        info("[WSCL_POOL] session seeded @thread=%s, num_tasks_added=%lu\n", to_string(std::this_thread::get_id()).c_str(), num_tasks_added);
+        ERT_TRACE(SESSION_BEGIN, -1, num_tasks_added);
+        this->stats_recorder(0).begin_perf_counting();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        this->parker_.unpark_all();
+
+        // Work on, and steal for, the session until all tasks are done
+        caller_worker.run_until(completion, this->wait_policy());
+        caller_worker.leave();
+        this->stats_recorder(0).end_perf_counting();
+        ERT_TRACE(SESSION_END);
+    }
+
+    inline void WSCL_POOL::wake_helpers()
+    {
+        this->parker_.unpark_all();
+    }
+
+    inline void WSCL_POOL::status() const
+    {
+        warn("===================\n");
+        warn("[WSCL_POOL] workers=%lu, executors=%lu]\n", this->workers_.size(), this->executors_.size());
+        for (const auto &worker : this->workers_)
+        {
+            worker->status();
+        }
+        warn("===================\n");
+    }
+
+    template <typename T>
+    CHASE_LEV_DEQUE<T>::CHASE_LEV_DEQUE(size_t log_capacity)
+    {
+        this->rings_.emplace_back(std::make_unique<RING>(log_capacity));
+        this->ring_.store(this->rings_.back().get(), std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    void CHASE_LEV_DEQUE<T>::push(T *item)
+    {
+        const int64_t bottom = this->bottom_.load(std::memory_order_relaxed);
+        const int64_t top = this->top_.load(std::memory_order_acquire);
+        RING *ring = this->ring_.load(std::memory_order_relaxed);
+        if (bottom - top > static_cast<int64_t>(ring->capacity) - 1)
+        {
+            ring = this->grow(ring, top, bottom);
+        }
+        ring->put(bottom, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        this->bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    T *CHASE_LEV_DEQUE<T>::pop()
+    {
+        const int64_t bottom = this->bottom_.load(std::memory_order_relaxed) - 1;
+        RING *ring = this->ring_.load(std::memory_order_relaxed);
+        this->bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = this->top_.load(std::memory_order_relaxed);
+
+        T *item = nullptr;
+        if (top <= bottom)
+        {
+            item = ring->get(bottom);
+            if (top == bottom)
+            {
+                // The last item, race against thieves
+                if (!this->top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    item = nullptr;
+                }
+                this->bottom_.store(bottom + 1, std::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            this->bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    template <typename T>
+    T *CHASE_LEV_DEQUE<T>::steal()
+    {
+        int64_t top = this->top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = this->bottom_.load(std::memory_order_acquire);
+
+        if (top < bottom)
+        {
+            RING *ring = this->ring_.load(std::memory_order_acquire);
+            T *item = ring->get(top);
+            if (this->top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                return item;
+            }
+        }
+        return nullptr;
+    }
+
+    template <typename T>
+    bool CHASE_LEV_DEQUE<T>::empty() const
+    {
+        return this->size() == 0;
+    }
+
+    template <typename T>
+    size_t CHASE_LEV_DEQUE<T>::size() const
+    {
+        const int64_t bottom = this->bottom_.load();
+        const int64_t top = this->top_.load();
+        return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+    }
+
+    template <typename T>
+    typename CHASE_LEV_DEQUE<T>::RING *CHASE_LEV_DEQUE<T>::grow(RING *ring, int64_t top, int64_t bottom)
+    {
+        auto new_ring = std::make_unique<RING>(__builtin_ctzll(ring->capacity) + 1);
+        for (int64_t i = top; i < bottom; i++)
+        {
+            new_ring->put(i, ring->get(i));
+        }
+        this->rings_.emplace_back(std::move(new_ring));
+        RING *new_ring_ptr = this->rings_.back().get();
+        this->ring_.store(new_ring_ptr, std::memory_order_release);
+        return new_ring_ptr;
+    }
+
+    inline void WSCL_WORKER::run()
+    {
+        WORKER_INDEX::SCOPE worker_index(this->worker_id_);
+        this->stats_->begin_perf_counting();
+        this->thread_id_ = std::this_thread::get_id();
+        WORKER_CONTEXT::bind(this);
+        info("[Worker %d] running @thread=%s\n", this->worker_id_, to_string(this->thread_id_).c_str());
+        BACKOFF backoff(this->idle_policy_);
+        // Worker event loop
+        while (true)
+        {
+            if (TASK *task = this->tasks_.pop())
+            {
+                this->run_task(task);
+                continue;
+            }
+            if (this->terminate_notify_)
+            {
+                this->terminate_notify_ = false; // Reset
+                WORKER_CONTEXT::bind(nullptr);
+                info("[Worker %d] terminated\n", this->worker_id_);
+                this->stats_->end_perf_counting(true);
+                return;
+            }
+            if (TASK *task = this->try_acquire_once())
+            {
+                backoff.reset();
+                this->run_task(task);
+            }
+            else if (this->injection_queue_->try_help())
+            {
+                backoff.reset();
+            }
+            else
+            {
+                this->idle(backoff);
+            }
+        }
+    }
+
+    inline void WSCL_WORKER::run_until(COMPLETION &completion, IDLE_POLICY wait_policy)
+    {
+        BACKOFF backoff(wait_policy);
+        while (true)
+        {
+            if (TASK *task = this->tasks_.pop())
+            {
+                this->run_task(task);
+                continue;
+            }
+            if (completion.is_done())
+            {
+                completion.wait(wait_policy); // Synchronize with the last count_down()
+                return;
+            }
+            if (TASK *task = this->try_acquire_once())
+            {
+                backoff.reset();
+                this->run_task(task);
+            }
+            else if (backoff.pause())
+            {
+                // Nothing left to steal, block until the rest of the session is done elsewhere
+                const STATS_RECORDER::CLOCK::time_point wait_start = this->stats_->now();
+                ERT_TRACE(IDLE_BEGIN);
+                completion.wait(IDLE_POLICY{0, 0});
+                ERT_TRACE(IDLE_END);
+                this->stats_->add_idle_time(wait_start);
+                return;
+            }
+        }
+    }
+
+    inline void WSCL_WORKER::enter()
+    {
+        ASSERT(this->tasks_.empty());
+        this->thread_id_ = std::this_thread::get_id();
+        WORKER_CONTEXT::bind(this);
+    }
+
+    inline void WSCL_WORKER::leave()
+    {
+        ASSERT(this->tasks_.empty());
+        WORKER_CONTEXT::bind(nullptr);
+    }
+
+    inline void WSCL_WORKER::add_task(TASK task)
+    {
+        ASSERT(std::this_thread::get_id() == this->thread_id_);
+        this->tasks_.push(this->arena_.get().create<TASK>(std::move(task)));
+    }
+
+    inline void WSCL_WORKER::terminate()
+    {
+        debug("[Worker %d] terminate\n", this->worker_id_);
+
+        this->terminate_notify_ = true;
+    }
+
+    inline void WSCL_WORKER::status() const
+    {
+        std::string threda_id_str = to_string(this->thread_id_);
+        [[maybe_unused]] const WORKER_STATS stats = this->stats_->snapshot();
+        warn("[Worker %d] @thread=%s, workers=%lu, tasks=%lu, tasks_done=%lu, tasks_stolen=%lu, terminate_notify=%s\n",
+             this->worker_id_,
+             threda_id_str.c_str(), this->workers_.size(), this->tasks_.size(), stats.num_tasks, stats.num_steals,
+             bool_to_cstr(this->terminate_notify_));
+    }
+
+    inline void WSCL_WORKER::run_task(TASK *task)
+    {
+        debug("[Worker %d] going to run task, %lu tasks in the deque\n", this->worker_id_, this->tasks_.size());
+
+        // Move the task off its node before running it, the node is reclaimed once the session is done
+        TASK t = std::move(*task);
+        task->~TASK();
+        // Reusing the capacity of the proxy, run_task() nests under TASK_GROUP::wait()
+        WORKER_PROXY worker_proxy{std::move(this->worker_proxy_.tasks)};
+        this->stats_->join_session(this->session_clock_->load(std::memory_order_relaxed));
+        ERT_TRACE(TASK_BEGIN);
+        this->stats_->run_busy([&t, &worker_proxy]()
+                               { t(worker_proxy); });
+        ERT_TRACE(TASK_END);
+        this->stats_->count_tasks();
+        for (auto &new_task : worker_proxy.tasks)
+        {
+            this->add_task(std::move(new_task));
+        }
+        if (!worker_proxy.tasks.empty())
+        {
+            // New tasks to steal, wake up the parked workers
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            this->parker_->unpark_all();
+        }
+        worker_proxy.tasks.clear();
+        this->worker_proxy_ = std::move(worker_proxy);
+        debug("[Worker %d] task done, %lu tasks in the deque\n", this->worker_id_, this->tasks_.size());
+    }
+
+    inline void WSCL_WORKER::spawn(TASK task)
+    {
+        this->add_task(std::move(task));
+        // New task to steal, wake up the parked workers
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        this->parker_->unpark_all();
+    }
+
+    inline bool WSCL_WORKER::try_run_one()
+    {
+        TASK *task = this->tasks_.pop();
+        if (!task)
+        {
+            task = this->try_acquire_once();
+        }
+        if (task)
+        {
+            this->run_task(task);
+            return true;
+        }
+        return false;
+    }
+
+    inline TASK *WSCL_WORKER::try_acquire_once()
+    {
+        const int target_worker_id = this->rng_() % this->workers_.size();
+        // Does not support self-steal
+        if (target_worker_id == this->worker_id_)
+        {
+            return nullptr;
+        }
+        TASK *task = this->workers_[target_worker_id]->tasks_.steal();
+        this->stats_->count_steal_attempt(task != nullptr);
+        ERT_TRACE(STEAL_REQUEST, target_worker_id);
+        if (task)
+        {
+            ERT_TRACE(STEAL_GRANT, target_worker_id, 1);
+            debug("[Worker %d] stole a task from worker %d\n", this->worker_id_, target_worker_id);
+        }
+        else
+        {
+            ERT_TRACE(STEAL_DENY, target_worker_id);
+        }
+        return task;
+    }
+
+    inline void WSCL_WORKER::idle(BACKOFF &backoff)
+    {
+        if (!backoff.pause())
+        {
+            return;
+        }
+
+        const uint64_t ticket = this->parker_->prepare_park();
+        if (this->should_wake_up())
+        {
+            this->parker_->cancel_park();
+        }
+        else
+        {
+            debug("[Worker %d] parking\n", this->worker_id_);
+            const STATS_RECORDER::CLOCK::time_point park_start = this->stats_->now();
+            ERT_TRACE(IDLE_BEGIN);
+            this->parker_->park(ticket);
+            ERT_TRACE(IDLE_END);
+            this->stats_->add_idle_time(park_start);
+            debug("[Worker %d] unparked\n", this->worker_id_);
+        }
+        backoff.reset();
+    }
+
+    inline bool WSCL_WORKER::should_wake_up() const
+    {
+        return this->terminate_notify_ || !this->injection_queue_->empty() ||
+               std::any_of(this->workers_.begin(), this->workers_.end(), [](const WSCL_WORKER *worker)
+                           { return !worker->tasks_.empty(); });
+    }
+}
@@ -2,87 +2,175 @@
 
 #include <algorithm>
 #include <atomic>
-#include <cstdlib>
-#include <deque>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <thread>
 #include <vector>
 
+#include "arena.hpp"
+#include "completion.hpp"
+#include "idle.hpp"
 #include "macros.hpp"
 #include "message.hpp"
 #include "pool.hpp"
+#include "private_deque.hpp"
+#include "range_task.hpp"
 #include "task.hpp"
+#include "task_graph.hpp"
+#include "task_group.hpp"
 #include "utils.hpp"
 
 /// Work Stealing Private Deque POOL - Receiver initiated
+/// The calling thread of execute() joins the session as worker 0,
+/// so a pool of N workers runs N-1 executor threads.
 
 namespace ERT
 {
+    /// How many tasks a victim hands over to a thief
+    enum class WSPDR_POLICY
+    {
+        STEAL_ONE = 0,
+        STEAL_HALF = 1,
+        ADAPTIVE = 2, // From one up to half, by the deque length, the thief's recent steal failures and latencies, and the task duration
+        DEFAULT = STEAL_HALF
+    };
+
+    /// Picks the worker a thief sends its next steal request to: the last victim that sent tasks, while it still has some,
+    /// else a random worker per tier of distance, nearest first, moving further while the pick has nothing to steal
+    class VICTIM_SELECTOR
+    {
+    public:
+        static constexpr int NO_VICTIM = -1;
+
+        // victim_tiers are the other workers grouped by distance, nearest first, see TOPOLOGY::group_by_distance()
+        void init(std::vector<std::vector<int>> victim_tiers, uint64_t seed);
+        // has_tasks(worker_id) tells whether the worker has tasks to steal; NO_VICTIM if none of the picks has
+        template <typename HAS_TASKS>
+        int select(const HAS_TASKS &has_tasks);
+        void record(int victim, bool is_stolen); // The response of victim to a steal request
+
+    private:
+        XORSHIFT rng_;
+        std::vector<std::vector<int>> victim_tiers_; // Other workers, nearest first
+        int last_victim_ = NO_VICTIM;                // Last victim that sent tasks
+    };
+
     class WSPDR_WORKER;
     class WSPDR_POOL : public POOL
     {
     public:
-        explicit WSPDR_POOL(size_t num_workers) : POOL(num_workers) {}
+        explicit WSPDR_POOL(size_t num_workers, IDLE_POLICY idle_policy = IDLE_POLICY()) : POOL(num_workers), idle_policy_(idle_policy) {}
+        WSPDR_POOL(size_t num_workers, WSPDR_POLICY policy, IDLE_POLICY idle_policy = IDLE_POLICY())
+            : POOL(num_workers), idle_policy_(idle_policy), policy_(policy) {}
         virtual ~WSPDR_POOL();
 
         virtual void start() override;
         virtual void terminate() override;
         // A single session of execution, blocking until completed
-        virtual void execute(const std::vector<RAW_TASK> &tasks) override;
+        virtual void execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation) override;
+        using POOL::execute;
+        virtual void execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body) override;
+        virtual void execute_graph(const TASK_GRAPH &graph) override;
         virtual void status() const override;
 
+        // Seed of the victim selection of the workers, set before start() for reproducible runs
+        void set_seed(uint64_t seed) { this->seed_ = seed; }
+        WSPDR_POLICY policy() const { return this->policy_; }
+
+    protected:
+        virtual void wake_helpers() override;
+
+    private:
+        // seed(caller_worker) adds the initial tasks of the session, returning how many were added
+        template <typename SEED>
+        void run_session(const SEED &seed, COMPLETION &completion);
+
     private:
         std::vector<std::unique_ptr<WSPDR_WORKER>> workers_;
         std::vector<std::thread> executors_;
+        IDLE_POLICY idle_policy_;
+        WSPDR_POLICY policy_ = WSPDR_POLICY::DEFAULT;
+        PARKER parker_;
+        std::atomic<uint64_t> session_clock_ = 0;
+        uint64_t seed_ = 0;
     };
 
-    enum class WSPDR_POLICY
-    {
-        STEAL_ONE = 0,
-        STEAL_HALF = 1,
-        DEFAULT = STEAL_HALF
-    };
-
-    class WSPDR_WORKER
+    class WSPDR_WORKER : public WORKER_CONTEXT
     {
     public:
-        void init(int worker_id, std::vector<WSPDR_WORKER *> workers, WSPDR_POLICY policy = WSPDR_POLICY::DEFAULT)
+        void init(int worker_id, std::vector<WSPDR_WORKER *> workers, PARKER *parker, INJECTION_QUEUE *injection_queue,
+                  const std::atomic<uint64_t> *session_clock,
+                  STATS_RECORDER *stats, std::vector<std::vector<int>> victim_tiers, uint64_t seed,
+                  IDLE_POLICY idle_policy = IDLE_POLICY(), WSPDR_POLICY policy = WSPDR_POLICY::DEFAULT)
         {
             this->worker_id_ = worker_id;
             this->workers_ = std::move(workers);
+            this->parker_ = parker;
+            this->injection_queue_ = injection_queue;
+            this->session_clock_ = session_clock;
+            this->arena_.bind(session_clock);
+            this->stats_ = stats;
+            this->victim_selector_.init(std::move(victim_tiers), seed + worker_id);
+            this->idle_policy_ = idle_policy;
             this->policy_ = policy;
         }
-        void run();                                  // Running on a thread
-        void send_task(TASK task, bool is_anchored); // Can be used cross thread, but only when task deque is empty (with assert)
+        void run();                                                      // Running on an executor thread until terminated
+        void run_until(COMPLETION &completion, IDLE_POLICY wait_policy); // Running on the calling thread of a session
+        void enter();                                                    // Bind to the calling thread and accept steal requests
+        void leave();                                                    // Stop accepting steal requests, only when task deque is empty (with assert)
+        void add_task(TASK task);                                        // Must not be used cross thread (with assert)
+        void spawn(TASK task) override;                                  // From a task running on this worker
+        bool try_run_one() override;                                     // From a task running on this worker
         void terminate();
         void status() const;
 
+        // How many of num_tasks tasks WSPDR_POLICY::ADAPTIVE hands over to a thief, from the thief's steal latency
+        // and failure rate, and the victim's time per task
+        static size_t num_adaptive_tasks_to_send(size_t num_tasks, double steal_latency, double steal_failure_rate, double task_time);
+
     private:
-        void add_task(TASK task); // Must not be used cross thread (with assert)
+        void run_task();
+        void open_mailbox();
+        void close_mailbox();
         bool try_send_steal_request(int requester_worker_id);
-        void distribute_task(std::vector<TASK> task);
+        void distribute_task(TASK_BUFFER tasks);
         void communicate();
         bool try_acquire_once();
+        int select_victim();
+        size_t num_tasks_to_send(int requester_worker_id) const;
+        void idle(BACKOFF &backoff);
+        bool should_wake_up() const;
         void update_tasks_status();
         bool is_alive() const { return this->is_alive_; }
 
     private:
         static constexpr int NO_REQUEST = -1;
-        struct TASK_HOLDER
-        {
-            TASK task;
-            bool is_anchored;
-        };
+        // For WSPDR_POLICY::ADAPTIVE
+        static constexpr float INITIAL_STEAL_LATENCY = 2e-6f; // Seconds, about a steal request and response
+        static constexpr float EMA_WEIGHT = 0.125f;           // Of the latest sample in the moving averages
+        static constexpr size_t TASK_TIME_PERIOD = 16;        // Tasks per timed task, keeping the clock off most of them
 
     private:
-        std::deque<TASK_HOLDER> tasks_;
+        PRIVATE_DEQUE tasks_;
         std::vector<WSPDR_WORKER *> workers_; // back when using by self, front when using by other
-        std::vector<TASK> received_tasks_;
+        TASK_BUFFER received_tasks_;
+        SESSION_ARENA arena_; // Steal buffers sent by this worker
+        WORKER_PROXY worker_proxy_;
+        PARKER *parker_ = nullptr;
+        INJECTION_QUEUE *injection_queue_ = nullptr; // Helped when there is nothing to steal
+        const std::atomic<uint64_t> *session_clock_ = nullptr;
+        STATS_RECORDER *stats_ = nullptr;
+        IDLE_POLICY idle_policy_;
+        VICTIM_SELECTOR victim_selector_;
         std::thread::id thread_id_;
         int worker_id_ = -1;
-        int num_tasks_done_ = 0;
+        double task_time_ema_ = 0; // Seconds per task, for WSPDR_POLICY::ADAPTIVE
+        size_t num_tasks_run_ = 0;
         WSPDR_POLICY policy_ = WSPDR_POLICY::DEFAULT;
         std::atomic<int> request_ = NO_REQUEST;
+        std::atomic<float> steal_failure_rate_ = 0; // Moving averages over the responses to the steal requests of this worker
+        std::atomic<float> steal_latency_ema_ = INITIAL_STEAL_LATENCY;
         std::atomic<bool> has_tasks_ = false;
         std::atomic<bool> received_tasks_notify_ = false;
         std::atomic<bool> terminate_notify_ = false;
@@ -92,6 +180,37 @@ namespace ERT
 
 namespace ERT
 {
+    inline void VICTIM_SELECTOR::init(std::vector<std::vector<int>> victim_tiers, uint64_t seed)
+    {
+        this->victim_tiers_ = std::move(victim_tiers);
+        this->rng_.seed(seed);
+        this->last_victim_ = NO_VICTIM;
+    }
+
+    template <typename HAS_TASKS>
+    int VICTIM_SELECTOR::select(const HAS_TASKS &has_tasks)
+    {
+        // The last victim likely still has surplus tasks
+        if (this->last_victim_ != NO_VICTIM && has_tasks(this->last_victim_))
+        {
+            return this->last_victim_;
+        }
+        for (const auto &tier : this->victim_tiers_)
+        {
+            const int victim = tier[this->rng_.below(tier.size())];
+            if (has_tasks(victim))
+            {
+                return victim;
+            }
+        }
+        return NO_VICTIM;
+    }
+
+    inline void VICTIM_SELECTOR::record(int victim, bool is_stolen)
+    {
+        this->last_victim_ = is_stolen ? victim : NO_VICTIM;
+    }
+
     inline WSPDR_POOL::~WSPDR_POOL()
     {
         this->terminate();
@@ -114,17 +233,25 @@ namespace ERT
         worker_ptrs.reserve(n_workers);
         std::transform(this->workers_.begin(), this->workers_.end(), std::back_inserter(worker_ptrs), [](const auto &p)
                        { return p.get(); });
+        // Victims are tried nearest first, by the CPUs of their placement, all in a single tier when not placed
+        const TOPOLOGY topology = this->is_placed() ? TOPOLOGY::current() : TOPOLOGY();
+        const std::vector<int> worker_cpus = this->worker_cpus(topology);
         for (size_t worker_id = 0; worker_id < n_workers; worker_id++)
         {
-            this->workers_[worker_id]->init(worker_id, worker_ptrs);
+            this->workers_[worker_id]->init(worker_id, worker_ptrs, &this->parker_, &this->injection_queue(), &this->session_clock_, &this->stats_recorder(worker_id),
+                                            topology.group_by_distance(worker_cpus, n_workers, worker_id), this->seed_, this->idle_policy_, this->policy_);
         }
 
+        // Worker 0 belongs to the calling thread of execute(), and only accepts steal requests during a session
+        this->workers_.front()->leave();
+
         // Initialize executors
-        this->executors_.reserve(n_workers);
-        for (const auto &worker : this->workers_)
+        this->executors_.reserve(n_workers - 1);
+        for (auto worker_it = std::next(this->workers_.begin()); worker_it != this->workers_.end(); worker_it++)
         {
-            this->executors_.emplace_back(&WSPDR_WORKER::run, worker.get());
+            this->executors_.emplace_back(&WSPDR_WORKER::run, worker_it->get());
         }
+        this->place_executors(this->executors_, worker_cpus);
     }
 
     inline void WSPDR_POOL::terminate()
@@ -133,6 +260,7 @@ namespace ERT
         {
             worker->terminate();
         }
+        this->parker_.unpark_all();
         for (auto &executor : this->executors_)
         {
             executor.join();
@@ -141,44 +269,122 @@ namespace ERT
         this->executors_.clear();
     }
 
-    inline void WSPDR_POOL::execute(const std::vector<RAW_TASK> &tasks)
+    inline void WSPDR_POOL::execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation)
     {
-        ASSERT(!tasks.empty());
+        ASSERT(num_tasks > 0);
+
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
+        {
+            // Worker 0 and its deque serve the session holding the pool, nested or concurrent ones are injected
+            this->inject(tasks, num_tasks, cancellation);
+            return;
+        }
 
         // Workers and executors must be launched already
         ASSERT(!this->workers_.empty());
-        ASSERT(!this->executors_.empty());
+        ASSERT(this->executors_.size() + 1 == this->workers_.size());
 
         // For synchronization
-        const size_t total_num_tasks = tasks.size();
-        std::atomic<size_t> num_tasks_done = 0;
+        COMPLETION completion(num_tasks);
+
+        // Integrate synchronization into argument tasks, seeded straight into the caller's deque.
+        // Each one refers to the caller's task, which outlives the session.
+        // Once cancelled, the tasks left in the deques are dropped as they are popped or stolen, still counting down.
+        this->run_session([tasks, num_tasks, &cancellation, &completion](WSPDR_WORKER &caller_worker)
+                          {
+                              for (size_t itask = 0; itask < num_tasks; itask++)
+                              {
+                                  caller_worker.add_task([task = &tasks[itask], itask, &cancellation, &completion](WORKER_PROXY &)
+                                                         {
+                                                             if (!cancellation.is_cancelled(itask))
+                                                             {
+                                                                 (*task)();
+                                                             }
+                                                             completion.count_down(); });
+                              }
+                              return num_tasks; },
+                          completion);
+    }
+
+    inline void WSPDR_POOL::execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body)
+    {
+        ASSERT(begin < end);
+        ASSERT(grain > 0);
 
-        // Integrate synchronization into argument tasks
-        std::vector<TASK> synced_tasks;
-        synced_tasks.reserve(total_num_tasks);
-        for (const auto &task : tasks)
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
         {
-            auto synced_task = [task, &num_tasks_done](WORKER_PROXY &)
-            {
-                task();
-                num_tasks_done++;
-            };
-            synced_tasks.emplace_back(std::move(synced_task));
+            this->inject(begin, end, grain, body);
+            return;
         }
 
-        // Create a scheduler task to do worker->add_task
-        auto scheduler_task = [synced_tasks = std::move(synced_tasks)](WORKER_PROXY &worker_proxy)
-        {
-            worker_proxy.tasks = std::move(synced_tasks);
-            info("scheduler_task done @thread=%s, num_tasks_added=%lu\n", to_string(std::this_thread::get_id()).c_str(), worker_proxy.tasks.size());
-        };
-        // Scheduler task must be anchored to add_task to sheduler_worker
-        this->workers_.front()->send_task(std::move(scheduler_task), true);
-
-        // Wait for all tasks do be done
-        while (num_tasks_done.load() != total_num_tasks)
+        // Workers and executors must be launched already
+        ASSERT(!this->workers_.empty());
+        ASSERT(this->executors_.size() + 1 == this->workers_.size());
+
+        // Counting down iterations instead of tasks, the range task splits itself while running
+        COMPLETION completion(end - begin);
+        this->run_session([&](WSPDR_WORKER &caller_worker)
+                          {
+                              caller_worker.add_task(to_range_task(begin, end, grain, body, completion));
+                              return size_t(1); },
+                          completion);
+    }
+
+    inline void WSPDR_POOL::execute_graph(const TASK_GRAPH &graph)
+    {
+        ASSERT(graph.size() > 0);
+
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
         {
+            // Injecting level by level
+            POOL::execute_graph(graph);
+            return;
         }
+
+        // Workers and executors must be launched already
+        ASSERT(!this->workers_.empty());
+        ASSERT(this->executors_.size() + 1 == this->workers_.size());
+
+        // Counting down nodes, each task handing its released successors back to the worker running it
+        COMPLETION completion(graph.size());
+        GRAPH_SESSION graph_session(graph, completion);
+        this->run_session([&graph_session](WSPDR_WORKER &caller_worker)
+                          {
+                              for (TASK_GRAPH::NODE root : graph_session.roots())
+                              {
+                                  caller_worker.add_task(graph_session.task(root));
+                              }
+                              return graph_session.roots().size(); },
+                          completion);
+    }
+
+    template <typename SEED>
+    void WSPDR_POOL::run_session(const SEED &seed, COMPLETION &completion)
+    {
+        // The calling thread joins as worker 0, seeding its own deque
+        WORKER_INDEX::SCOPE worker_index(0);
+        WSPDR_WORKER &caller_worker = *this->workers_.front();
+        this->session_clock_++;
+        caller_worker.enter();
+        [[maybe_unused]] const size_t num_tasks_added = seed(caller_worker);
+        info("[WSPDR_POOL] session seeded @thread=%s, num_tasks_added=%lu\n", to_string(std::this_thread::get_id()).c_str(), num_tasks_added);
+        ERT_TRACE(SESSION_BEGIN, -1, num_tasks_added);
+        this->stats_recorder(0).begin_perf_counting();
+        this->parker_.unpark_all();
+
+        // Work on, and steal for, the session until all tasks are done
+        caller_worker.run_until(completion, this->wait_policy());
+        caller_worker.leave();
+        this->stats_recorder(0).end_perf_counting();
+        ERT_TRACE(SESSION_END);
+    }
+
+    inline void WSPDR_POOL::wake_helpers()
+    {
+        this->parker_.unpark_all();
     }
 
     inline void WSPDR_POOL::status() const
@@ -194,9 +400,13 @@ namespace ERT
 
     inline void WSPDR_WORKER::run()
     {
+        WORKER_INDEX::SCOPE worker_index(this->worker_id_);
+        this->stats_->begin_perf_counting();
         this->is_alive_ = true;
         this->thread_id_ = std::this_thread::get_id();
+        WORKER_CONTEXT::bind(this);
         info("[Worker %d] running @thread=%s\n", this->worker_id_, to_string(this->thread_id_).c_str());
+        BACKOFF backoff(this->idle_policy_);
         // Worker event loop
         while (true)
         {
@@ -207,50 +417,136 @@ namespace ERT
                 {
                     this->is_alive_ = false;
                     this->terminate_notify_ = false; // Reset
-
-                    while (true)
-                    {
-                        int no_request = NO_REQUEST;
-                        if (this->request_.compare_exchange_strong(no_request, this->worker_id_))
-                        {
-                            break;
-                        }
-                        this->communicate();
-                    }
-
-                    ASSERT(this->request_ == this->worker_id_);
+                    this->close_mailbox();
+                    WORKER_CONTEXT::bind(nullptr);
                     info("[Worker %d] terminated\n", this->worker_id_);
+                    this->stats_->end_perf_counting(true);
                     return;
                 }
-                this->try_acquire_once();
+                if (this->try_acquire_once() || this->injection_queue_->try_help())
+                {
+                    backoff.reset();
+                }
+                else
+                {
+                    this->idle(backoff);
+                }
             }
 
-            TASK t = this->tasks_.back().task;
-            this->tasks_.pop_back();
-            this->update_tasks_status();
-            this->communicate(); // wip
-            debug("[Worker %d] going to run task, %lu tasks in the deque\n", this->worker_id_, this->tasks_.size());
+            this->run_task();
+        }
+    }
 
-            WORKER_PROXY worker_proxy;
-            t(worker_proxy);
-            for (const auto &new_task : worker_proxy.tasks)
+    inline void WSPDR_WORKER::run_until(COMPLETION &completion, IDLE_POLICY wait_policy)
+    {
+        BACKOFF backoff(wait_policy);
+        while (true)
+        {
+            if (!this->tasks_.empty())
             {
-                this->add_task(new_task);
+                this->run_task();
+                continue;
+            }
+            if (completion.is_done())
+            {
+                completion.wait(wait_policy); // Synchronize with the last count_down()
+                return;
+            }
+            if (this->try_acquire_once())
+            {
+                backoff.reset();
+            }
+            else if (backoff.pause())
+            {
+                // Nothing left to steal, block until the rest of the session is done elsewhere
+                this->close_mailbox();
+                const STATS_RECORDER::CLOCK::time_point wait_start = this->stats_->now();
+                ERT_TRACE(IDLE_BEGIN);
+                completion.wait(IDLE_POLICY{0, 0});
+                ERT_TRACE(IDLE_END);
+                this->stats_->add_idle_time(wait_start);
+                this->open_mailbox();
+                return;
             }
-
-            this->num_tasks_done_++;
-            debug("[Worker %d] task done, %lu tasks in the deque\n", this->worker_id_, this->tasks_.size());
         }
     }
 
-    inline void WSPDR_WORKER::send_task(TASK task, bool is_anchored)
+    inline void WSPDR_WORKER::enter()
     {
         ASSERT(this->tasks_.empty());
-        info("[Worker %d] send_task from @thread=%s to @thread=%s with is_anchored=%s\n",
-             this->worker_id_, to_string(std::this_thread::get_id()).c_str(),
-             to_string(this->thread_id_).c_str(), bool_to_cstr(is_anchored));
-        this->tasks_.emplace_back(TASK_HOLDER{std::move(task), is_anchored});
+        this->thread_id_ = std::this_thread::get_id();
+        this->is_alive_ = true;
+        this->open_mailbox();
+        WORKER_CONTEXT::bind(this);
+    }
+
+    inline void WSPDR_WORKER::leave()
+    {
+        ASSERT(this->tasks_.empty());
+        this->is_alive_ = false;
+        this->close_mailbox();
+        WORKER_CONTEXT::bind(nullptr);
+    }
+
+    inline void WSPDR_WORKER::run_task()
+    {
+        TASK t = this->tasks_.pop_back();
         this->update_tasks_status();
+        this->communicate(); // wip
+        debug("[Worker %d] going to run task, %lu tasks in the deque\n", this->worker_id_, this->tasks_.size());
+
+        // Reusing the capacity of the proxy, run_task() nests under TASK_GROUP::wait()
+        WORKER_PROXY worker_proxy{std::move(this->worker_proxy_.tasks)};
+        this->stats_->join_session(this->session_clock_->load(std::memory_order_relaxed));
+        ERT_TRACE(TASK_BEGIN);
+        this->stats_->run_busy([this, &t, &worker_proxy]()
+                               {
+                                   if (this->policy_ == WSPDR_POLICY::ADAPTIVE && this->num_tasks_run_++ % TASK_TIME_PERIOD == 0)
+                                   {
+                                       const auto start_time = std::chrono::steady_clock::now();
+                                       t(worker_proxy);
+                                       const double task_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+                                       this->task_time_ema_ += EMA_WEIGHT * (task_time - this->task_time_ema_);
+                                   }
+                                   else
+                                   {
+                                       t(worker_proxy);
+                                   } });
+        ERT_TRACE(TASK_END);
+        this->stats_->count_tasks();
+        for (auto &new_task : worker_proxy.tasks)
+        {
+            this->add_task(std::move(new_task));
+        }
+        worker_proxy.tasks.clear();
+        this->worker_proxy_ = std::move(worker_proxy);
+        if (this->tasks_.size() > 1)
+        {
+            // Surplus tasks to steal, wake up the parked workers
+            this->parker_->unpark_all();
+        }
+
+        debug("[Worker %d] task done, %lu tasks in the deque\n", this->worker_id_, this->tasks_.size());
+    }
+
+    inline void WSPDR_WORKER::open_mailbox()
+    {
+        ASSERT(this->request_ == this->worker_id_);
+        this->request_ = NO_REQUEST;
+    }
+
+    inline void WSPDR_WORKER::close_mailbox()
+    {
+        while (true)
+        {
+            int no_request = NO_REQUEST;
+            if (this->request_.compare_exchange_strong(no_request, this->worker_id_))
+            {
+                break;
+            }
+            this->communicate();
+        }
+        ASSERT(this->request_ == this->worker_id_);
     }
 
     inline void WSPDR_WORKER::terminate()
@@ -264,9 +560,12 @@ namespace ERT
     {
         std::string threda_id_str = to_string(this->thread_id_);
         std::string received_tasks_str = this->received_tasks_notify_ ? std::to_string(this->received_tasks_.size()) : "nullopt";
-        warn("[Worker %d] @thread=%s, policy=%d, workers=%lu, tasks=%lu, tasks_done=%d, received_tasks=%s, request=%d, has_tasks=%s, terminate_notify=%s, is_alive=%s\n",
+        const WORKER_STATS stats = this->stats_->snapshot();
+        [[maybe_unused]] const double steal_latency = stats.num_steal_attempts > 0 ? stats.steal_wait_time / stats.num_steal_attempts : 0;
+        warn("[Worker %d] @thread=%s, policy=%d, workers=%lu, tasks=%lu, tasks_done=%lu, steals=%lu/%lu, steal_latency=%fus, received_tasks=%s, request=%d, has_tasks=%s, terminate_notify=%s, is_alive=%s\n",
              this->worker_id_,
-             threda_id_str.c_str(), static_cast<int>(this->policy_), this->workers_.size(), this->tasks_.size(), this->num_tasks_done_,
+             threda_id_str.c_str(), static_cast<int>(this->policy_), this->workers_.size(), this->tasks_.size(), stats.num_tasks,
+             stats.num_steals, stats.num_steal_attempts, steal_latency * 1e6,
              received_tasks_str.c_str(), this->request_.load(),
              bool_to_cstr(this->has_tasks_), bool_to_cstr(this->terminate_notify_), bool_to_cstr(this->is_alive_));
     }
@@ -274,10 +573,31 @@ namespace ERT
     inline void WSPDR_WORKER::add_task(TASK task)
     {
         ASSERT(std::this_thread::get_id() == this->thread_id_);
-        this->tasks_.emplace_back(TASK_HOLDER{std::move(task), false});
+        this->tasks_.push_back(std::move(task));
         this->update_tasks_status();
     }
 
+    inline void WSPDR_WORKER::spawn(TASK task)
+    {
+        this->add_task(std::move(task));
+        if (this->tasks_.size() > 1)
+        {
+            // Surplus tasks to steal, wake up the parked workers
+            this->parker_->unpark_all();
+        }
+    }
+
+    inline bool WSPDR_WORKER::try_run_one()
+    {
+        if (!this->tasks_.empty())
+        {
+            this->run_task();
+            return true;
+        }
+        // Acquired tasks land in the deque, to run at the next call
+        return this->try_acquire_once();
+    }
+
     inline bool WSPDR_WORKER::try_send_steal_request(int requester_worker_id)
     {
         if (this->has_tasks_)
@@ -289,7 +609,7 @@ namespace ERT
         return false;
     }
 
-    inline void WSPDR_WORKER::distribute_task(std::vector<TASK> tasks)
+    inline void WSPDR_WORKER::distribute_task(TASK_BUFFER tasks)
     {
         ASSERT(!this->received_tasks_notify_);
         ASSERT(this->received_tasks_.empty());
@@ -300,35 +620,20 @@ namespace ERT
     inline void WSPDR_WORKER::communicate()
     {
         int requester = this->request_;
-        if (requester != NO_REQUEST)
+        // A worker holding its own id has closed its mailbox
+        if (requester != NO_REQUEST && requester != this->worker_id_)
         {
             if (this->tasks_.empty())
             {
+                ERT_TRACE(STEAL_DENY, requester);
                 this->workers_[requester]->distribute_task({});
             }
             else
             {
-                size_t num_tasks_to_send = 1;
-                if (this->policy_ == WSPDR_POLICY::STEAL_HALF)
-                {
-                    num_tasks_to_send = this->tasks_.size() / 2;
-                }
-                std::vector<TASK> tasks_to_send;
-                tasks_to_send.reserve(num_tasks_to_send);
-                for (size_t itask = 0; itask < num_tasks_to_send; itask++)
-                {
-                    auto [t, is_anchored] = this->tasks_.front();
-                    if (is_anchored)
-                    {
-                        break; // Stop right at the anchored task
-                    }
-                    else
-                    {
-                        this->tasks_.pop_front();
-                        tasks_to_send.emplace_back(std::move(t));
-                    }
-                }
-                this->workers_[requester]->distribute_task(std::move(tasks_to_send));
+                TASK_BUFFER tasks = this->tasks_.take_front(this->num_tasks_to_send(requester), this->arena_.get());
+                this->stats_->count_tasks_given(tasks.size());
+                ERT_TRACE(STEAL_GRANT, requester, tasks.size());
+                this->workers_[requester]->distribute_task(std::move(tasks));
             }
             this->request_ = NO_REQUEST;
             this->update_tasks_status();
@@ -337,32 +642,47 @@ namespace ERT
 
     inline bool WSPDR_WORKER::try_acquire_once()
     {
-        int target_worker_id = std::rand() / ((RAND_MAX + 1u) / this->workers_.size());
-        // Does not support self-steal
-        if (target_worker_id != this->worker_id_)
+        const int target_worker_id = this->select_victim();
+        if (target_worker_id != VICTIM_SELECTOR::NO_VICTIM)
         {
             if (this->workers_[target_worker_id]->is_alive() && this->workers_[target_worker_id]->try_send_steal_request(this->worker_id_))
             {
                 // Request sent, now waiting for a response
+                ERT_TRACE(STEAL_REQUEST, target_worker_id);
+                const auto request_time = std::chrono::steady_clock::now();
                 while (!this->received_tasks_notify_)
                 {
                     // While waiting, still respond to other worker who has sent request to this worker
                     this->communicate();
                 }
-                std::vector<TASK> received_tasks = std::move(this->received_tasks_);
+                const float steal_failure_rate = this->steal_failure_rate_.load(std::memory_order_relaxed);
+                const float steal_failure = this->received_tasks_.empty() ? 1.0f : 0.0f;
+                this->steal_failure_rate_.store(steal_failure_rate + EMA_WEIGHT * (steal_failure - steal_failure_rate), std::memory_order_relaxed);
+                const float steal_latency = std::chrono::duration<float>(std::chrono::steady_clock::now() - request_time).count();
+                const float steal_latency_ema = this->steal_latency_ema_.load(std::memory_order_relaxed);
+                this->steal_latency_ema_.store(steal_latency_ema + EMA_WEIGHT * (steal_latency - steal_latency_ema), std::memory_order_relaxed);
+                this->stats_->add_steal_wait_time(request_time);
+                TASK_BUFFER received_tasks = std::move(this->received_tasks_);
                 this->received_tasks_.clear();
                 this->received_tasks_notify_ = false;
+                this->stats_->count_steal_attempt(!received_tasks.empty());
                 // Check whether the target worker sent real tasks to this worker
                 if (!received_tasks.empty())
                 {
-                    for (const auto &received_task : received_tasks)
+                    this->victim_selector_.record(target_worker_id, true);
+                    for (auto &received_task : received_tasks)
+                    {
+                        this->add_task(std::move(received_task));
+                    }
+                    if (this->tasks_.size() > 1)
                     {
-                        this->add_task(received_task);
+                        this->parker_->unpark_all();
                     }
                     debug("[Worker %d] acquired %lu task from worker %d, %lu tasks in the deque\n",
                           this->worker_id_, received_tasks.size(), target_worker_id, this->tasks_.size());
                     return true;
                 }
+                this->victim_selector_.record(target_worker_id, false);
             }
         }
         // While looking for target worker to steal from, still respond to other worker who has sent request to this worker
@@ -370,6 +690,83 @@ namespace ERT
         return false;
     }
 
+    inline size_t WSPDR_WORKER::num_tasks_to_send(int requester_worker_id) const
+    {
+        const size_t num_tasks = this->tasks_.size();
+        switch (this->policy_)
+        {
+        case WSPDR_POLICY::STEAL_ONE:
+            return 1;
+        case WSPDR_POLICY::STEAL_HALF:
+            return num_tasks / 2;
+        case WSPDR_POLICY::ADAPTIVE:
+        {
+            const WSPDR_WORKER &requester = *this->workers_[requester_worker_id];
+            return WSPDR_WORKER::num_adaptive_tasks_to_send(num_tasks, requester.steal_latency_ema_.load(std::memory_order_relaxed),
+                                                            requester.steal_failure_rate_.load(std::memory_order_relaxed), this->task_time_ema_);
+        }
+        }
+        return 1;
+    }
+
+    inline size_t WSPDR_WORKER::num_adaptive_tasks_to_send(size_t num_tasks, double steal_latency, double steal_failure_rate, double task_time)
+    {
+        // Hand over more when tasks are short next to what a steal costs the thief, so that the steal pays off,
+        // or when the thief keeps failing to find work, so that the work spreads out in fewer steals
+        const double short_task_weight = steal_latency / (steal_latency + task_time);
+        const double weight = std::min(1.0, std::max(short_task_weight, steal_failure_rate));
+        return std::max<size_t>(1, static_cast<size_t>(weight * (num_tasks / 2)));
+    }
+
+    inline int WSPDR_WORKER::select_victim()
+    {
+        return this->victim_selector_.select([this](int worker_id)
+                                             { return this->workers_[worker_id]->has_tasks_.load(); });
+    }
+
+    inline void WSPDR_WORKER::idle(BACKOFF &backoff)
+    {
+        if (!backoff.pause())
+        {
+            return;
+        }
+
+        // Close the request mailbox so that no thief waits on this worker while parking
+        int no_request = NO_REQUEST;
+        if (!this->request_.compare_exchange_strong(no_request, this->worker_id_))
+        {
+            // A thief got in first, respond to it and retry acquiring
+            this->communicate();
+            return;
+        }
+
+        const uint64_t ticket = this->parker_->prepare_park();
+        if (this->should_wake_up())
+        {
+            this->parker_->cancel_park();
+        }
+        else
+        {
+            debug("[Worker %d] parking\n", this->worker_id_);
+            const STATS_RECORDER::CLOCK::time_point park_start = this->stats_->now();
+            ERT_TRACE(IDLE_BEGIN);
+            this->parker_->park(ticket);
+            ERT_TRACE(IDLE_END);
+            this->stats_->add_idle_time(park_start);
+            debug("[Worker %d] unparked\n", this->worker_id_);
+        }
+
+        this->open_mailbox();
+        backoff.reset();
+    }
+
+    inline bool WSPDR_WORKER::should_wake_up() const
+    {
+        return this->terminate_notify_ || !this->injection_queue_->empty() ||
+               std::any_of(this->workers_.begin(), this->workers_.end(), [](const WSPDR_WORKER *worker)
+                           { return worker->has_tasks_.load(); });
+    }
+
     inline void WSPDR_WORKER::update_tasks_status()
     {
         bool b = !this->tasks_.empty();
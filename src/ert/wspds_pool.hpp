@@ -0,0 +1,623 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "arena.hpp"
+#include "completion.hpp"
+#include "idle.hpp"
+#include "macros.hpp"
+#include "message.hpp"
+#include "pool.hpp"
+#include "private_deque.hpp"
+#include "range_task.hpp"
+#include "task.hpp"
+#include "task_graph.hpp"
+#include "task_group.hpp"
+#include "utils.hpp"
+
+/// Work Stealing Private Deque POOL - Sender initiated
+/// Idle workers advertise themselves in an IDLE_BITMAP, and busy workers push
+/// half of their surplus tasks to a claimed idle worker between tasks.
+/// The calling thread of execute() joins the session as worker 0,
+/// so a pool of N workers runs N-1 executor threads.
+
+namespace ERT
+{
+    class IDLE_BITMAP;
+    class WSPDS_WORKER;
+    class WSPDS_POOL : public POOL
+    {
+    public:
+        explicit WSPDS_POOL(size_t num_workers, IDLE_POLICY idle_policy = IDLE_POLICY()) : POOL(num_workers), idle_policy_(idle_policy) {}
+        virtual ~WSPDS_POOL();
+
+        virtual void start() override;
+        virtual void terminate() override;
+        // A single session of execution, blocking until completed
+        virtual void execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation) override;
+        using POOL::execute;
+        virtual void execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body) override;
+        virtual void execute_graph(const TASK_GRAPH &graph) override;
+        virtual void status() const override;
+
+    protected:
+        virtual void wake_helpers() override;
+
+    private:
+        // seed(caller_worker) adds the initial tasks of the session, returning how many were added
+        template <typename SEED>
+        void run_session(const SEED &seed, COMPLETION &completion);
+
+    private:
+        std::vector<std::unique_ptr<WSPDS_WORKER>> workers_;
+        std::vector<std::thread> executors_;
+        std::unique_ptr<IDLE_BITMAP> idle_workers_;
+        IDLE_POLICY idle_policy_;
+        std::atomic<uint64_t> session_clock_ = 0;
+    };
+
+    /// One bit per worker, set while the worker is idle and waiting for tasks
+    class IDLE_BITMAP
+    {
+    public:
+        explicit IDLE_BITMAP(size_t num_workers);
+
+        void set(int worker_id);
+        bool try_clear(int worker_id); // True if the bit was set, i.e., the caller claimed the worker
+        int try_claim_any(int self_id); // Claim an idle worker other than self_id; -1 if none is idle
+
+    private:
+        static uint64_t mask(int worker_id) { return uint64_t(1) << (worker_id % 64); }
+
+    private:
+        size_t num_words_;
+        std::unique_ptr<std::atomic<uint64_t>[]> words_;
+    };
+
+    class WSPDS_WORKER : public WORKER_CONTEXT
+    {
+    public:
+        void init(int worker_id, std::vector<WSPDS_WORKER *> workers, IDLE_BITMAP *idle_workers, INJECTION_QUEUE *injection_queue,
+                  const std::atomic<uint64_t> *session_clock, STATS_RECORDER *stats, IDLE_POLICY idle_policy = IDLE_POLICY())
+        {
+            this->worker_id_ = worker_id;
+            this->workers_ = std::move(workers);
+            this->idle_workers_ = idle_workers;
+            this->injection_queue_ = injection_queue;
+            this->session_clock_ = session_clock;
+            this->arena_.bind(session_clock);
+            this->stats_ = stats;
+            this->idle_policy_ = idle_policy;
+        }
+        void run();                                                      // Running on an executor thread until terminated
+        void run_until(COMPLETION &completion, IDLE_POLICY wait_policy); // Running on the calling thread of a session
+        void enter();                                                    // Bind to the calling thread
+        void leave();                                                    // Unbind from the calling thread, only when task deque is empty (with assert)
+        void add_task(TASK task);                                        // Must not be used cross thread (with assert)
+        void spawn(TASK task) override;                                  // From a task running on this worker
+        bool try_run_one() override;                                     // From a task running on this worker
+        void wake();                                                     // To help the injected sessions
+        void terminate();
+        void status() const;
+
+    private:
+        void run_task();
+        void share();
+        void distribute_task(TASK_BUFFER tasks);
+        void receive();
+        bool withdraw(); // False if a sender claimed this worker first, the tasks are on their way
+
+    private:
+        PRIVATE_DEQUE tasks_;
+        std::vector<WSPDS_WORKER *> workers_;
+        TASK_BUFFER received_tasks_;
+        SESSION_ARENA arena_; // Buffers of the tasks shared by this worker
+        WORKER_PROXY worker_proxy_;
+        IDLE_BITMAP *idle_workers_ = nullptr;
+        INJECTION_QUEUE *injection_queue_ = nullptr; // Helped while no task is pushed to this worker
+        const std::atomic<uint64_t> *session_clock_ = nullptr;
+        STATS_RECORDER *stats_ = nullptr; // An advertisement as idle counts as a steal attempt
+        IDLE_POLICY idle_policy_;
+        PARKER parker_;
+        std::thread::id thread_id_;
+        int worker_id_ = -1;
+        std::atomic<bool> received_tasks_notify_ = false;
+        std::atomic<bool> terminate_notify_ = false;
+    };
+}
+
+namespace ERT
+{
+    inline WSPDS_POOL::~WSPDS_POOL()
+    {
+        this->terminate();
+    }
+
+    inline void WSPDS_POOL::start()
+    {
+        ASSERT(this->workers_.empty());
+        ASSERT(this->executors_.empty());
+
+        const size_t n_workers = this->num_workers();
+        this->idle_workers_ = std::make_unique<IDLE_BITMAP>(n_workers);
+
+        // Construct workers
+        this->workers_.reserve(n_workers);
+        std::generate_n(std::back_inserter(this->workers_), n_workers, []()
+                        { return std::make_unique<WSPDS_WORKER>(); });
+
+        // Initialize workers
+        std::vector<WSPDS_WORKER *> worker_ptrs;
+        worker_ptrs.reserve(n_workers);
+        std::transform(this->workers_.begin(), this->workers_.end(), std::back_inserter(worker_ptrs), [](const auto &p)
+                       { return p.get(); });
+        for (size_t worker_id = 0; worker_id < n_workers; worker_id++)
+        {
+            this->workers_[worker_id]->init(worker_id, worker_ptrs, this->idle_workers_.get(), &this->injection_queue(), &this->session_clock_, &this->stats_recorder(worker_id), this->idle_policy_);
+        }
+
+        // Initialize executors, worker 0 belongs to the calling thread of execute()
+        this->executors_.reserve(n_workers - 1);
+        for (auto worker_it = std::next(this->workers_.begin()); worker_it != this->workers_.end(); worker_it++)
+        {
+            this->executors_.emplace_back(&WSPDS_WORKER::run, worker_it->get());
+        }
+        this->place_executors(this->executors_);
+    }
+
+    inline void WSPDS_POOL::terminate()
+    {
+        for (const auto &worker : this->workers_)
+        {
+            worker->terminate();
+        }
+        for (auto &executor : this->executors_)
+        {
+            executor.join();
+        }
+        this->workers_.clear();
+        this->executors_.clear();
+        this->idle_workers_.reset();
+    }
+
+    inline void WSPDS_POOL::execute(const RAW_TASK *tasks, size_t num_tasks, const CANCELLATION &cancellation)
+    {
+        ASSERT(num_tasks > 0);
+
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
+        {
+            // Worker 0 and its deque serve the session holding the pool, nested or concurrent ones are injected
+            this->inject(tasks, num_tasks, cancellation);
+            return;
+        }
+
+        // Workers and executors must be launched already
+        ASSERT(!this->workers_.empty());
+        ASSERT(this->executors_.size() + 1 == this->workers_.size());
+
+        // For synchronization
+        COMPLETION completion(num_tasks);
+
+        // Integrate synchronization into argument tasks, seeded straight into the caller's deque.
+        // Each one refers to the caller's task, which outlives the session.
+        // Once cancelled, the tasks left in the deques are dropped as they are popped or stolen, still counting down.
+        this->run_session([tasks, num_tasks, &cancellation, &completion](WSPDS_WORKER &caller_worker)
+                          {
+                              for (size_t itask = 0; itask < num_tasks; itask++)
+                              {
+                                  caller_worker.add_task([task = &tasks[itask], itask, &cancellation, &completion](WORKER_PROXY &)
+                                                         {
+                                                             if (!cancellation.is_cancelled(itask))
+                                                             {
+                                                                 (*task)();
+                                                             }
+                                                             completion.count_down(); });
+                              }
+                              return num_tasks; },
+                          completion);
+    }
+
+    inline void WSPDS_POOL::execute_range(size_t begin, size_t end, size_t grain, const RANGE_BODY &body)
+    {
+        ASSERT(begin < end);
+        ASSERT(grain > 0);
+
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
+        {
+            this->inject(begin, end, grain, body);
+            return;
+        }
+
+        // Workers and executors must be launched already
+        ASSERT(!this->workers_.empty());
+        ASSERT(this->executors_.size() + 1 == this->workers_.size());
+
+        // Counting down iterations instead of tasks, the range task splits itself while running
+        COMPLETION completion(end - begin);
+        this->run_session([&](WSPDS_WORKER &caller_worker)
+                          {
+                              caller_worker.add_task(to_range_task(begin, end, grain, body, completion));
+                              return size_t(1); },
+                          completion);
+    }
+
+    inline void WSPDS_POOL::execute_graph(const TASK_GRAPH &graph)
+    {
+        ASSERT(graph.size() > 0);
+
+        SESSION_HOLD hold(*this);
+        if (!hold.is_held())
+        {
+            // Injecting level by level
+            POOL::execute_graph(graph);
+            return;
+        }
+
+        // Workers and executors must be launched already
+        ASSERT(!this->workers_.empty());
+        ASSERT(this->executors_.size() + 1 == this->workers_.size());
+
+        // Counting down nodes, each task handing its released successors back to the worker running it
+        COMPLETION completion(graph.size());
+        GRAPH_SESSION graph_session(graph, completion);
+        this->run_session([&graph_session](WSPDS_WORKER &caller_worker)
+                          {
+                              for (TASK_GRAPH::NODE root : graph_session.roots())
+                              {
+                                  caller_worker.add_task(graph_session.task(root));
+                              }
+                              return graph_session.roots().size(); },
+                          completion);
+    }
+
+    template <typename SEED>
+    void WSPDS_POOL::run_session(const SEED &seed, COMPLETION &completion)
+    {
+        // The calling thread joins as worker 0, seeding its own deque
+        WORKER_INDEX::SCOPE worker_index(0);
+        WSPDS_WORKER &caller_worker = *this->workers_.front();
+        this->session_clock_++;
+        caller_worker.enter();
+        [[maybe_unused]] const size_t num_tasks_added = seed(caller_worker);
+        info("[WSPDS_POOL] session seeded @thread=%s, num_tasks_added=%lu\n", to_string(std::this_thread::get_id()).c_str(), num_tasks_added);
+        ERT_TRACE(SESSION_BEGIN, -1, num_tasks_added);
+        this->stats_recorder(0).begin_perf_counting();
+
+        // Work on, and share surplus of, the session until all tasks are done
+        caller_worker.run_until(completion, this->wait_policy());
+        caller_worker.leave();
+        this->stats_recorder(0).end_perf_counting();
+        ERT_TRACE(SESSION_END);
+    }
+
+    inline void WSPDS_POOL::wake_helpers()
+    {
+        for (const auto &worker : this->workers_)
+        {
+            worker->wake();
+        }
+    }
+
+    inline void WSPDS_POOL::status() const
+    {
+        warn("===================\n");
+        warn("[WSPDS_POOL] workers=%lu, executors=%lu]\n", this->workers_.size(), this->executors_.size());
+        for (const auto &worker : this->workers_)
+        {
+            worker->status();
+        }
+        warn("===================\n");
+    }
+
+    inline IDLE_BITMAP::IDLE_BITMAP(size_t num_workers) : num_words_((num_workers + 63) / 64), words_(new std::atomic<uint64_t>[num_words_])
+    {
+        for (size_t iword = 0; iword < this->num_words_; iword++)
+        {
+            this->words_[iword] = 0;
+        }
+    }
+
+    inline void IDLE_BITMAP::set(int worker_id)
+    {
+        this->words_[worker_id / 64].fetch_or(mask(worker_id));
+    }
+
+    inline bool IDLE_BITMAP::try_clear(int worker_id)
+    {
+        return this->words_[worker_id / 64].fetch_and(~mask(worker_id)) & mask(worker_id);
+    }
+
+    inline int IDLE_BITMAP::try_claim_any(int self_id)
+    {
+        // Start from the word of self_id to spread the claims of different senders
+        for (size_t i = 0; i < this->num_words_; i++)
+        {
+            const size_t iword = (self_id / 64 + i) % this->num_words_;
+            uint64_t word = this->words_[iword].load() & ~(iword == size_t(self_id / 64) ? mask(self_id) : 0);
+            while (word != 0)
+            {
+                const int worker_id = iword * 64 + __builtin_ctzll(word);
+                if (this->try_clear(worker_id))
+                {
+                    return worker_id;
+                }
+                word &= word - 1;
+            }
+        }
+        return -1;
+    }
+
+    inline void WSPDS_WORKER::run()
+    {
+        WORKER_INDEX::SCOPE worker_index(this->worker_id_);
+        this->stats_->begin_perf_counting();
+        this->thread_id_ = std::this_thread::get_id();
+        WORKER_CONTEXT::bind(this);
+        info("[Worker %d] running @thread=%s\n", this->worker_id_, to_string(this->thread_id_).c_str());
+        BACKOFF backoff(this->idle_policy_);
+        bool is_advertised = false;
+        // Worker event loop
+        while (true)
+        {
+            if (!this->tasks_.empty())
+            {
+                this->run_task();
+                continue;
+            }
+            if (this->received_tasks_notify_)
+            {
+                this->receive();
+                is_advertised = false;
+                backoff.reset();
+                continue;
+            }
+            // Withdrawn while helping, so that no sender pushes tasks that would wait behind a chunk
+            if (!this->injection_queue_->empty() && (!is_advertised || this->withdraw()))
+            {
+                is_advertised = false;
+                this->injection_queue_->try_help();
+                backoff.reset();
+                continue;
+            }
+            if (!is_advertised)
+            {
+                this->idle_workers_->set(this->worker_id_);
+                ERT_TRACE(STEAL_REQUEST);
+                is_advertised = true;
+            }
+            if (this->terminate_notify_)
+            {
+                if (this->withdraw())
+                {
+                    this->terminate_notify_ = false; // Reset
+                    WORKER_CONTEXT::bind(nullptr);
+                    info("[Worker %d] terminated\n", this->worker_id_);
+                    this->stats_->end_perf_counting(true);
+                    return;
+                }
+                continue;
+            }
+            if (backoff.pause())
+            {
+                const uint64_t ticket = this->parker_.prepare_park();
+                if (this->received_tasks_notify_ || this->terminate_notify_ || !this->injection_queue_->empty())
+                {
+                    this->parker_.cancel_park();
+                }
+                else
+                {
+                    debug("[Worker %d] parking\n", this->worker_id_);
+                    const STATS_RECORDER::CLOCK::time_point park_start = this->stats_->now();
+                    ERT_TRACE(IDLE_BEGIN);
+                    this->parker_.park(ticket);
+                    ERT_TRACE(IDLE_END);
+                    this->stats_->add_idle_time(park_start);
+                    debug("[Worker %d] unparked\n", this->worker_id_);
+                }
+            }
+        }
+    }
+
+    inline void WSPDS_WORKER::run_until(COMPLETION &completion, IDLE_POLICY wait_policy)
+    {
+        BACKOFF backoff(wait_policy);
+        bool is_advertised = false;
+        while (true)
+        {
+            if (!this->tasks_.empty())
+            {
+                this->run_task();
+                continue;
+            }
+            if (this->received_tasks_notify_)
+            {
+                this->receive();
+                is_advertised = false;
+                backoff.reset();
+                continue;
+            }
+            if (!is_advertised)
+            {
+                this->idle_workers_->set(this->worker_id_);
+                ERT_TRACE(STEAL_REQUEST);
+                is_advertised = true;
+            }
+            if (completion.is_done() || backoff.pause())
+            {
+                if (this->withdraw())
+                {
+                    // Nothing was pushed to this worker, block until the rest of the session is done elsewhere
+                    const STATS_RECORDER::CLOCK::time_point wait_start = this->stats_->now();
+                    ERT_TRACE(IDLE_BEGIN);
+                    completion.wait(completion.is_done() ? wait_policy : IDLE_POLICY{0, 0});
+                    ERT_TRACE(IDLE_END);
+                    this->stats_->add_idle_time(wait_start);
+                    return;
+                }
+            }
+        }
+    }
+
+    inline void WSPDS_WORKER::enter()
+    {
+        ASSERT(this->tasks_.empty());
+        this->thread_id_ = std::this_thread::get_id();
+        WORKER_CONTEXT::bind(this);
+    }
+
+    inline void WSPDS_WORKER::leave()
+    {
+        ASSERT(this->tasks_.empty());
+        WORKER_CONTEXT::bind(nullptr);
+    }
+
+    inline void WSPDS_WORKER::add_task(TASK task)
+    {
+        ASSERT(std::this_thread::get_id() == this->thread_id_);
+        this->tasks_.push_back(std::move(task));
+    }
+
+    inline void WSPDS_WORKER::wake()
+    {
+        this->parker_.unpark_all();
+    }
+
+    inline void WSPDS_WORKER::terminate()
+    {
+        debug("[Worker %d] terminate\n", this->worker_id_);
+
+        this->terminate_notify_ = true;
+        this->parker_.unpark_all();
+    }
+
+    inline void WSPDS_WORKER::status() const
+    {
+        std::string threda_id_str = to_string(this->thread_id_);
+        std::string received_tasks_str = this->received_tasks_notify_ ? std::to_string(this->received_tasks_.size()) : "nullopt";
+        [[maybe_unused]] const WORKER_STATS stats = this->stats_->snapshot();
+        warn("[Worker %d] @thread=%s, workers=%lu, tasks=%lu, tasks_done=%lu, tasks_shared=%lu, received_tasks=%s, terminate_notify=%s\n",
+             this->worker_id_,
+             threda_id_str.c_str(), this->workers_.size(), this->tasks_.size(), stats.num_tasks, stats.num_tasks_given,
+             received_tasks_str.c_str(), bool_to_cstr(this->terminate_notify_));
+    }
+
+    inline void WSPDS_WORKER::run_task()
+    {
+        TASK t = this->tasks_.pop_back();
+        this->share();
+        debug("[Worker %d] going to run task, %lu tasks in the deque\n", this->worker_id_, this->tasks_.size());
+
+        // Reusing the capacity of the proxy, run_task() nests under TASK_GROUP::wait()
+        WORKER_PROXY worker_proxy{std::move(this->worker_proxy_.tasks)};
+        this->stats_->join_session(this->session_clock_->load(std::memory_order_relaxed));
+        ERT_TRACE(TASK_BEGIN);
+        this->stats_->run_busy([&t, &worker_proxy]()
+                               { t(worker_proxy); });
+        ERT_TRACE(TASK_END);
+        this->stats_->count_tasks();
+        for (auto &new_task : worker_proxy.tasks)
+        {
+            this->add_task(std::move(new_task));
+        }
+        worker_proxy.tasks.clear();
+        this->worker_proxy_ = std::move(worker_proxy);
+        debug("[Worker %d] task done, %lu tasks in the deque\n", this->worker_id_, this->tasks_.size());
+    }
+
+    inline void WSPDS_WORKER::spawn(TASK task)
+    {
+        this->add_task(std::move(task));
+        this->share();
+    }
+
+    inline bool WSPDS_WORKER::try_run_one()
+    {
+        if (!this->tasks_.empty())
+        {
+            this->run_task();
+            return true;
+        }
+        if (this->received_tasks_notify_)
+        {
+            this->receive();
+            return true;
+        }
+        return false;
+    }
+
+    inline void WSPDS_WORKER::share()
+    {
+        // Keep the next task for self, push half of the surplus to each idle worker found
+        while (this->tasks_.size() > 1)
+        {
+            const int idle_worker_id = this->idle_workers_->try_claim_any(this->worker_id_);
+            if (idle_worker_id < 0)
+            {
+                return;
+            }
+            TASK_BUFFER tasks_to_send = this->tasks_.take_front(this->tasks_.size() / 2, this->arena_.get());
+            const size_t num_tasks_sent = tasks_to_send.size();
+            this->stats_->count_tasks_given(num_tasks_sent);
+            ERT_TRACE(STEAL_GRANT, idle_worker_id, num_tasks_sent);
+            debug("[Worker %d] pushing %lu tasks to worker %d\n", this->worker_id_, num_tasks_sent, idle_worker_id);
+            this->workers_[idle_worker_id]->distribute_task(std::move(tasks_to_send));
+        }
+    }
+
+    inline void WSPDS_WORKER::distribute_task(TASK_BUFFER tasks)
+    {
+        ASSERT(!this->received_tasks_notify_);
+        ASSERT(this->received_tasks_.empty());
+        this->received_tasks_ = std::move(tasks);
+        this->received_tasks_notify_ = true;
+        this->parker_.unpark_all();
+    }
+
+    inline void WSPDS_WORKER::receive()
+    {
+        TASK_BUFFER received_tasks = std::move(this->received_tasks_);
+        this->received_tasks_.clear();
+        this->received_tasks_notify_ = false;
+        this->stats_->count_steal_attempt(!received_tasks.empty());
+        for (auto &received_task : received_tasks)
+        {
+            this->add_task(std::move(received_task));
+        }
+        debug("[Worker %d] received %lu tasks, %lu tasks in the deque\n", this->worker_id_, received_tasks.size(), this->tasks_.size());
+    }
+
+    inline bool WSPDS_WORKER::withdraw()
+    {
+        if (this->idle_workers_->try_clear(this->worker_id_))
+        {
+            this->stats_->count_steal_attempt(false);
+            ERT_TRACE(STEAL_DENY);
+            return true;
+        }
+        // The sender delivers right after claiming, unless it is preempted in between
+        BACKOFF backoff(this->idle_policy_);
+        while (!this->received_tasks_notify_)
+        {
+            if (backoff.pause())
+            {
+                const uint64_t ticket = this->parker_.prepare_park();
+                if (this->received_tasks_notify_)
+                {
+                    this->parker_.cancel_park();
+                }
+                else
+                {
+                    this->parker_.park(ticket);
+                }
+            }
+        }
+        return false;
+    }
+}